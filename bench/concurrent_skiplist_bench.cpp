@@ -0,0 +1,146 @@
+#include "ConcurrentSkipList.hpp"
+#include "ShardedMap.hpp"
+#include "SkipList.hpp"
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+
+using wijagels::concurrent_skiplist;
+using wijagels::skiplist;
+
+namespace {
+constexpr int KEY_RANGE = 1 << 20;
+
+/**
+ * Baseline, a plain skiplist behind a reader-writer lock
+ */
+class locked_skiplist {
+ public:
+  bool insert(int value) {
+    std::unique_lock<std::shared_mutex> lock{d_mutex};
+    return d_list.insert(value).second;
+  }
+
+  bool erase(int value) {
+    std::unique_lock<std::shared_mutex> lock{d_mutex};
+    return d_list.erase(value);
+  }
+
+  bool contains(int value) {
+    std::shared_lock<std::shared_mutex> lock{d_mutex};
+    return d_list.find(value) != d_list.end();
+  }
+
+ private:
+  std::shared_mutex d_mutex;
+  skiplist<int> d_list;
+};
+
+/**
+ * Set interface over sharded_map
+ */
+class sharded_set {
+ public:
+  bool insert(int value) { return d_map.try_emplace(value); }
+  bool erase(int value) { return d_map.erase(value); }
+  bool contains(int value) { return d_map.contains(value); }
+
+ private:
+  wijagels::sharded_map<int, char> d_map;
+};
+
+/**
+ * One half full instance shared by every thread of every run, inserts and
+ * erases are balanced so it stays that way
+ */
+template <class List>
+List &shared_list() {
+  static List *list = [] {
+    auto l = new List;
+    std::mt19937 gen{};
+    std::uniform_int_distribution<> dis{0, KEY_RANGE - 1};
+    for (int i = 0; i < KEY_RANGE / 2; i++) l->insert(dis(gen));
+    return l;
+  }();
+  return *list;
+}
+}  // namespace
+
+/**
+ * range(0) is the percentage of operations that are lookups, the rest are
+ * split evenly between inserts and erases
+ */
+template <class List>
+static void BM_Mixed(benchmark::State &state) {
+  auto &list = shared_list<List>();
+  std::mt19937 gen{std::random_device{}()};
+  std::uniform_int_distribution<> key{0, KEY_RANGE - 1};
+  std::uniform_int_distribution<> op{0, 99};
+  auto reads = state.range(0);
+  for (auto _ : state) {
+    auto k = key(gen);
+    auto o = op(gen);
+    if (o < reads) {
+      benchmark::DoNotOptimize(list.contains(k));
+    } else if (o % 2) {
+      benchmark::DoNotOptimize(list.insert(k));
+    } else {
+      benchmark::DoNotOptimize(list.erase(k));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Mixed, concurrent_skiplist<int>)
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Mixed, locked_skiplist)
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Mixed, sharded_set)
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
+/**
+ * Writers only, each thread inserting and erasing in its own slice of the key
+ * range. Nothing is shared between threads but the container, so this is the
+ * case where throughput should grow with the thread count.
+ */
+template <class List>
+static void BM_Writers(benchmark::State &state) {
+  auto &list = shared_list<List>();
+  auto slice = KEY_RANGE / state.threads();
+  auto base = state.thread_index() * slice;
+  std::mt19937 gen{static_cast<unsigned>(state.thread_index())};
+  std::uniform_int_distribution<> key{base, base + slice - 1};
+  for (auto _ : state) {
+    auto k = key(gen);
+    if (gen() % 2) {
+      benchmark::DoNotOptimize(list.insert(k));
+    } else {
+      benchmark::DoNotOptimize(list.erase(k));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Writers, concurrent_skiplist<int>)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Writers, locked_skiplist)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Writers, sharded_set)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
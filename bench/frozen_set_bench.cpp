@@ -0,0 +1,69 @@
+#include "FrozenSet.hpp"
+#include "SkipList.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using wijagels::frozen_set;
+using wijagels::skiplist;
+
+namespace {
+std::vector<int> random_keys(size_t size) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  std::vector<int> keys(size);
+  for (auto &k : keys) k = dis(gen);
+  return keys;
+}
+}  // namespace
+
+/**
+ * Random hits and misses against range(0) elements
+ */
+template <typename T>
+void BM_Find(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  T set(keys.begin(), keys.end());
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{1});
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.lower_bound(keys[i++ % keys.size()] ^ 1));
+  }
+}
+BENCHMARK_TEMPLATE(BM_Find, skiplist<int>)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Find, frozen_set<int>)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_Find, std::set<int>)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 22);
+
+/**
+ * Plain binary search over the same sorted array, without the accelerator
+ */
+static void BM_Find_Sorted_Vector(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  std::vector<int> sorted{keys};
+  std::sort(sorted.begin(), sorted.end());
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{1});
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::lower_bound(sorted.begin(), sorted.end(),
+                                              keys[i++ % keys.size()] ^ 1));
+  }
+}
+BENCHMARK(BM_Find_Sorted_Vector)->RangeMultiplier(8)->Range(1 << 10, 1 << 22);
+
+static void BM_Freeze(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  skiplist<int> list(keys.begin(), keys.end());
+  for (auto _ : state) benchmark::DoNotOptimize(wijagels::freeze(list));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Freeze)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
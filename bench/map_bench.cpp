@@ -0,0 +1,203 @@
+#include "FlatMap.hpp"
+#include "IndexedMap.hpp"
+#include "Map.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using wijagels::flat_map;
+using wijagels::indexed_map;
+using wijagels::map;
+
+namespace {
+/* range(0) updates over keys drawn from range(0) / 4, so most of them hit */
+std::vector<int> counter_keys(size_t updates) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{0, static_cast<int>(updates / 4)};
+  std::vector<int> keys(updates);
+  for (auto &k : keys) k = dis(gen);
+  return keys;
+}
+}  // namespace
+
+/**
+ * Counting map, every update is a try_emplace of zero and an increment
+ */
+template <typename T>
+void BM_Try_Emplace(benchmark::State &state) {
+  auto keys = counter_keys(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    T counts;
+    for (auto k : keys) ++counts.try_emplace(k, 0).first->second;
+    benchmark::DoNotOptimize(counts);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Try_Emplace, map<int, long>)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Try_Emplace, std::map<int, long>)
+    ->Range(1 << 10, 1 << 18);
+
+/**
+ * Same updates through operator[]
+ */
+template <typename T>
+void BM_Subscript(benchmark::State &state) {
+  auto keys = counter_keys(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    T counts;
+    for (auto k : keys) ++counts[k];
+    benchmark::DoNotOptimize(counts);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Subscript, map<int, long>)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Subscript, std::map<int, long>)->Range(1 << 10, 1 << 18);
+
+/**
+ * Last write wins over string keys, where a wasted key copy costs an
+ * allocation
+ */
+template <typename T>
+void BM_Insert_Or_Assign(benchmark::State &state) {
+  auto ids = counter_keys(static_cast<size_t>(state.range(0)));
+  std::vector<std::string> keys;
+  for (auto id : ids) keys.push_back("sensor/" + std::to_string(id) + "/value");
+  for (auto _ : state) {
+    T latest;
+    long i = 0;
+    for (const auto &k : keys) latest.insert_or_assign(k, i++);
+    benchmark::DoNotOptimize(latest);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Insert_Or_Assign, map<std::string, long>)
+    ->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Insert_Or_Assign, std::map<std::string, long>)
+    ->Range(1 << 10, 1 << 16);
+
+/**
+ * Point lookups of present keys in a map of range(0) random pairs
+ */
+template <typename T>
+void BM_Find(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::vector<std::pair<int, int>> pairs(static_cast<size_t>(state.range(0)));
+  for (auto &p : pairs) p = {static_cast<int>(gen()), 0};
+  T m{pairs.begin(), pairs.end()};
+  std::shuffle(pairs.begin(), pairs.end(), gen);
+  for (auto _ : state) {
+    for (const auto &p : pairs) benchmark::DoNotOptimize(m.find(p.first));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Find, flat_map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Find, indexed_map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Find, map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Find, std::map<int, int>)->Range(1 << 10, 1 << 20);
+
+/**
+ * Build from range(0) unsorted pairs
+ */
+template <typename T>
+void BM_Bulk_Load(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::vector<std::pair<int, int>> pairs(static_cast<size_t>(state.range(0)));
+  for (auto &p : pairs) p = {static_cast<int>(gen()), 0};
+  for (auto _ : state) {
+    T m{pairs.begin(), pairs.end()};
+    benchmark::DoNotOptimize(m);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Bulk_Load, flat_map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Bulk_Load, indexed_map<int, int>)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Bulk_Load, map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Bulk_Load, std::map<int, int>)->Range(1 << 10, 1 << 20);
+
+/**
+ * Grow a map by batches of range(0) random pairs up to 64 batches, through
+ * one range insert each
+ */
+template <typename T>
+void BM_Insert_Range(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::vector<std::pair<int, int>> pairs(
+      static_cast<size_t>(state.range(0) * 64));
+  for (auto &p : pairs) p = {static_cast<int>(gen()), 0};
+  for (auto _ : state) {
+    T m;
+    for (auto it = pairs.begin(); it != pairs.end(); it += state.range(0)) {
+      m.insert(it, it + state.range(0));
+    }
+    benchmark::DoNotOptimize(m);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 64);
+}
+BENCHMARK_TEMPLATE(BM_Insert_Range, flat_map<int, int>)
+    ->Range(1 << 6, 1 << 12);
+BENCHMARK_TEMPLATE(BM_Insert_Range, map<int, int>)->Range(1 << 6, 1 << 12);
+
+/**
+ * Order book mix over range(0) random pairs, 19 point lookups for every
+ * scan of the 16 elements from a lower bound
+ */
+template <typename T>
+void BM_Lookup_Scan(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::vector<std::pair<int, int>> pairs(static_cast<size_t>(state.range(0)));
+  for (auto &p : pairs) p = {static_cast<int>(gen()), 1};
+  T m{pairs.begin(), pairs.end()};
+  std::shuffle(pairs.begin(), pairs.end(), gen);
+  for (auto _ : state) {
+    long sum = 0;
+    for (size_t i = 0; i < pairs.size(); i++) {
+      if (i % 20) {
+        sum += m.find(pairs[i].first)->second;
+        continue;
+      }
+      auto it = m.lower_bound(pairs[i].first);
+      for (int n = 0; n < 16 && it != m.end(); n++, ++it) sum += it->second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Lookup_Scan, indexed_map<int, int>)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Lookup_Scan, map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Lookup_Scan, std::map<int, int>)
+    ->Range(1 << 10, 1 << 20);
+
+/**
+ * Erase a present key by value and insert a new one, at a steady size of
+ * range(0)
+ */
+template <typename T>
+void BM_Erase_Insert(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::vector<int> keys(static_cast<size_t>(state.range(0)) * 2);
+  for (auto &k : keys) k = static_cast<int>(gen());
+  for (auto _ : state) {
+    state.PauseTiming();
+    T m;
+    for (size_t i = 0; i < keys.size() / 2; i++) m.emplace(keys[i], 0);
+    state.ResumeTiming();
+    for (size_t i = keys.size() / 2; i < keys.size(); i++) {
+      m.erase(keys[i - keys.size() / 2]);
+      m.emplace(keys[i], 0);
+    }
+    benchmark::DoNotOptimize(m);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Erase_Insert, indexed_map<int, int>)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Erase_Insert, map<int, int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Erase_Insert, std::map<int, int>)
+    ->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
@@ -1,12 +1,37 @@
 #include "SkipList.hpp"
+#include "Allocator.hpp"
+#include "BlockSkipList.hpp"
 #include <benchmark/benchmark.h>
 #include <boost/pool/pool_alloc.hpp>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
 
 // template <typename T>
 // using skiplist = typename wijagels::skiplist<T, std::less<T>,
 // boost::fast_pool_allocator<T>>;
+using wijagels::block_skiplist;
 using wijagels::skiplist;
 
+template <typename T, class Allocator = std::allocator<T>>
+using forward_skiplist =
+    skiplist<T, std::less<>, Allocator, wijagels::forward_links>;
+
+template <typename T>
+using quarter_skiplist =
+    skiplist<T, std::less<T>, std::allocator<T>, wijagels::bidirectional_links,
+             wijagels::geometric_levels<2>>;
+
+template <typename T>
+using prefetch_skiplist =
+    skiplist<T, std::less<T>, std::allocator<T>, wijagels::bidirectional_links,
+             wijagels::geometric_levels<>, wijagels::prefetch_nodes<>>;
+
+template <typename T>
+using arena_skiplist = skiplist<T, std::less<T>, wijagels::arena_allocator<T>>;
+
 static void BM_Default_Constructor(benchmark::State &state) {
   for (auto _ : state) {
     skiplist<int> dest;
@@ -16,7 +41,7 @@ static void BM_Default_Constructor(benchmark::State &state) {
 BENCHMARK(BM_Default_Constructor);
 
 /**
- * Demonstrate the efficiency of the copy constructor due to hinting
+ * The copy constructor links the already sorted source in a single sweep
  */
 static void BM_Copy_Constructor(benchmark::State &state) {
   std::mt19937 gen{};
@@ -76,11 +101,140 @@ BENCHMARK_TEMPLATE(BM_Insert, skiplist<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
+BENCHMARK_TEMPLATE(BM_Insert, forward_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
+BENCHMARK_TEMPLATE(BM_Insert, quarter_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
+BENCHMARK_TEMPLATE(BM_Insert, block_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
 BENCHMARK_TEMPLATE(BM_Insert, std::set<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
 
+/**
+ * A batch of random keys into a list that already holds as many, one
+ * insert(first, last) call against a loop of single inserts
+ */
+template <typename T, bool Batched>
+void BM_Insert_Batch(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  std::vector<int> base;
+  std::vector<int> batch;
+  for (int i = 0; i < state.range(0); i++) {
+    base.push_back(dis(gen));
+    batch.push_back(dis(gen));
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    T dest(base.begin(), base.end());
+    state.ResumeTiming();
+    if constexpr (Batched) {
+      dest.insert(batch.begin(), batch.end());
+    } else {
+      for (const auto &e : batch) dest.insert(e);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Insert_Batch, skiplist<int>, true)
+    ->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Insert_Batch, skiplist<int>, false)
+    ->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Insert_Batch, forward_skiplist<int>, true)
+    ->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Insert_Batch, std::set<int>, false)
+    ->Range(1 << 10, 1 << 17);
+
+/**
+ * Strictly increasing keys inserted with an end hint, the way a time series
+ * is appended to
+ */
+template <typename T>
+void BM_Append(benchmark::State &state) {
+  for (auto _ : state) {
+    T dest;
+    for (int i = 0; i < state.range(0); i++) {
+      dest.insert(dest.end(), i);
+    }
+    benchmark::DoNotOptimize(dest);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Append, skiplist<int>)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Append, forward_skiplist<int>)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Append, std::set<int>)->Range(1 << 10, 1 << 18);
+
+/**
+ * Fill a list with range(0) random keys, then throw it away. The fill and
+ * the teardown are timed separately.
+ */
+template <typename T, bool Teardown>
+void BM_Fill(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  std::vector<int> keys;
+  for (int i = 0; i < state.range(0); i++) keys.push_back(dis(gen));
+  for (auto _ : state) {
+    if constexpr (Teardown) state.PauseTiming();
+    auto list = std::make_unique<T>();
+    for (auto k : keys) list->insert(k);
+    if constexpr (Teardown) {
+      state.ResumeTiming();
+    } else {
+      state.PauseTiming();
+    }
+    list.reset();
+    if constexpr (!Teardown) state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Fill, skiplist<int>, false)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Fill, arena_skiplist<int>, false)
+    ->Range(1 << 10, 1 << 18);
+// An arena teardown takes next to no time, fix the count so the untimed
+// fills do not run forever
+BENCHMARK_TEMPLATE(BM_Fill, skiplist<int>, true)
+    ->Range(1 << 10, 1 << 18)
+    ->Iterations(32);
+BENCHMARK_TEMPLATE(BM_Fill, arena_skiplist<int>, true)
+    ->Range(1 << 10, 1 << 18)
+    ->Iterations(32);
+
+/**
+ * Merge two lists of range(0) random keys each
+ */
+template <typename T>
+void BM_Merge(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  std::vector<int> left;
+  std::vector<int> right;
+  for (int i = 0; i < state.range(0); i++) {
+    left.push_back(dis(gen));
+    right.push_back(dis(gen));
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    T dest(left.begin(), left.end());
+    T source(right.begin(), right.end());
+    state.ResumeTiming();
+    dest.merge(source);
+    benchmark::DoNotOptimize(dest.size());
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Merge, skiplist<int>)->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Merge, forward_skiplist<int>)->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Merge, std::set<int>)->Range(1 << 10, 1 << 17);
+
 template <typename T>
 void BM_Find(benchmark::State &state) {
   std::mt19937 gen{};
@@ -103,11 +257,70 @@ BENCHMARK_TEMPLATE(BM_Find, skiplist<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
+BENCHMARK_TEMPLATE(BM_Find, forward_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
+BENCHMARK_TEMPLATE(BM_Find, quarter_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
+BENCHMARK_TEMPLATE(BM_Find, block_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
 BENCHMARK_TEMPLATE(BM_Find, std::set<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
 
+/**
+ * Lookups over 1 << 20 keys in a stream that moves forward by range(0) keys
+ * on average, jumping up to twice that either way and wrapping around at the
+ * end. 1 is a sequential scan.
+ */
+static std::vector<int> local_stream(int spread) {
+  constexpr int n = 1 << 20;
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> step{-spread, 3 * spread};
+  std::vector<int> keys;
+  for (int k = 0; keys.size() < (1 << 16);) {
+    k = (k + (spread == 1 ? 1 : step(gen)) + n) % n;
+    keys.push_back(2 * k);
+  }
+  return keys;
+}
+
+static skiplist<int> &local_list() {
+  static skiplist<int> list = [] {
+    std::vector<int> src(1 << 20);
+    for (int i = 0; i < (1 << 20); i++) src[i] = 2 * i;
+    return skiplist<int>{wijagels::sorted_unique, src.begin(), src.end()};
+  }();
+  return list;
+}
+
+static void BM_Find_Local(benchmark::State &state) {
+  auto &list = local_list();
+  auto keys = local_stream(state.range(0));
+  for (auto _ : state) {
+    for (auto k : keys) benchmark::DoNotOptimize(list.find(k));
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_Find_Local)->Arg(1)->Arg(16)->Arg(256);
+
+static void BM_Find_Cursor(benchmark::State &state) {
+  auto &list = local_list();
+  auto keys = local_stream(state.range(0));
+  skiplist<int>::cursor finger{list};
+  for (auto _ : state) {
+    for (auto k : keys) benchmark::DoNotOptimize(finger.find(k));
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_Find_Cursor)->Arg(1)->Arg(16)->Arg(256);
+
 template <typename T>
 void BM_Erase(benchmark::State &state) {
   std::mt19937 gen{};
@@ -133,9 +346,266 @@ BENCHMARK_TEMPLATE(BM_Erase, skiplist<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
+BENCHMARK_TEMPLATE(BM_Erase, forward_skiplist<int>)
+    ->RangeMultiplier(2)
+    ->Range(1 << 7, 1 << 14)
+    ->Complexity();
 BENCHMARK_TEMPLATE(BM_Erase, std::set<int>)
     ->RangeMultiplier(2)
     ->Range(1 << 7, 1 << 14)
     ->Complexity();
 
+/**
+ * Drop the oldest half of range(0) sequential keys, as when expiring
+ * everything below a watermark, with one range erase or key by key
+ */
+template <typename T, bool Ranged>
+void BM_Erase_Range(benchmark::State &state) {
+  std::vector<int> src(static_cast<size_t>(state.range(0)));
+  std::iota(src.begin(), src.end(), 0);
+  T list(src.begin(), src.end());
+  auto watermark = static_cast<int>(state.range(0) / 2);
+  for (auto _ : state) {
+    state.PauseTiming();
+    T copy{list};
+    state.ResumeTiming();
+    if constexpr (Ranged) {
+      copy.erase(copy.begin(), copy.lower_bound(watermark));
+    } else {
+      for (int k = 0; k < watermark; k++) copy.erase(k);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * watermark);
+}
+BENCHMARK_TEMPLATE(BM_Erase_Range, skiplist<int>, true)
+    ->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Erase_Range, skiplist<int>, false)
+    ->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_Erase_Range, std::set<int>, true)
+    ->Range(1 << 10, 1 << 17);
+
+/**
+ * Indexed access against walking the bottom level
+ */
+static skiplist<int> make_index_list(int64_t n) {
+  skiplist<int> list;
+  for (int i = 0; i < n; i++) {
+    list.insert(list.cend(), i);
+  }
+  return list;
+}
+
+static void BM_Nth(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<size_t> dis{0, list.size() - 1};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.nth(dis(gen)));
+  }
+}
+BENCHMARK(BM_Nth)->Arg(1 << 20);
+
+static void BM_Nth_Linear(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<size_t> dis{0, list.size() - 1};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::next(list.begin(), dis(gen)));
+  }
+}
+BENCHMARK(BM_Nth_Linear)->Arg(1 << 20);
+
+static void BM_Rank(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<int> dis{0, static_cast<int>(list.size())};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.rank(dis(gen)));
+  }
+}
+BENCHMARK(BM_Rank)->Arg(1 << 20);
+
+static void BM_Rank_Linear(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<int> dis{0, static_cast<int>(list.size())};
+  for (auto _ : state) {
+    auto key = dis(gen);
+    benchmark::DoNotOptimize(std::distance(
+        list.begin(), std::find_if(list.begin(), list.end(),
+                                   [key](int e) { return !(e < key); })));
+  }
+}
+BENCHMARK(BM_Rank_Linear)->Arg(1 << 20);
+
+static void BM_Distance(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<int> dis{0, static_cast<int>(list.size()) - 1};
+  for (auto _ : state) {
+    auto it = list.find(dis(gen));
+    benchmark::DoNotOptimize(distance(it, list.end()));
+  }
+}
+BENCHMARK(BM_Distance)->Arg(1 << 20);
+
+static void BM_Distance_Linear(benchmark::State &state) {
+  std::mt19937 gen{};
+  auto list = make_index_list(state.range(0));
+  std::uniform_int_distribution<int> dis{0, static_cast<int>(list.size()) - 1};
+  for (auto _ : state) {
+    auto it = list.find(dis(gen));
+    benchmark::DoNotOptimize(std::distance(it, list.end()));
+  }
+}
+BENCHMARK(BM_Distance_Linear)->Arg(1 << 20);
+
+/**
+ * Allocator that tallies the bytes it has handed out, for memory footprint
+ */
+static size_t g_allocated_bytes = 0;
+
+template <typename T>
+struct counting_allocator {
+  using value_type = T;
+
+  counting_allocator() = default;
+
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    g_allocated_bytes += n * sizeof(T);
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *ptr, size_t n) noexcept {
+    g_allocated_bytes -= n * sizeof(T);
+    std::allocator<T>{}.deallocate(ptr, n);
+  }
+
+  friend bool operator==(const counting_allocator &,
+                         const counting_allocator &) noexcept {
+    return true;
+  }
+
+  friend bool operator!=(const counting_allocator &,
+                         const counting_allocator &) noexcept {
+    return false;
+  }
+};
+
+template <typename T>
+void BM_Bytes_Per_Element(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  for (auto _ : state) {
+    g_allocated_bytes = 0;
+    T list;
+    for (int i = 0; i < state.range(0); i++) {
+      list.insert(dis(gen));
+    }
+    state.counters["bytes_per_element"] =
+        static_cast<double>(g_allocated_bytes) / list.size();
+  }
+}
+BENCHMARK_TEMPLATE(BM_Bytes_Per_Element,
+                   skiplist<int, std::less<>, counting_allocator<int>>)
+    ->Arg(1 << 20)
+    ->Iterations(1);
+BENCHMARK_TEMPLATE(BM_Bytes_Per_Element,
+                   forward_skiplist<int, counting_allocator<int>>)
+    ->Arg(1 << 20)
+    ->Iterations(1);
+BENCHMARK_TEMPLATE(BM_Bytes_Per_Element,
+                   std::set<int, std::less<>, counting_allocator<int>>)
+    ->Arg(1 << 20)
+    ->Iterations(1);
+
+/**
+ * Lists far larger than the caches, where nearly every hop of a descent
+ * misses. Built from random keys so neighbouring nodes are not neighbours in
+ * memory. The list for the current size is kept between runs.
+ */
+template <typename T>
+T &large_list(size_t size, std::vector<int> &keys) {
+  static std::unique_ptr<T> list;
+  static std::vector<int> list_keys;
+  if (!list || list->size() != size) {
+    list.reset();
+    std::mt19937 gen{};
+    std::uniform_int_distribution<> dis{};
+    list_keys.clear();
+    while (list_keys.size() < size) list_keys.push_back(dis(gen) & ~1);
+    list = std::make_unique<T>(list_keys.begin(), list_keys.end());
+    while (list->size() < size) list->insert(dis(gen) & ~1);
+  }
+  keys = list_keys;
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{});
+  keys.resize(1 << 14);
+  return *list;
+}
+
+template <typename T>
+void BM_Find_Large(benchmark::State &state) {
+  std::vector<int> keys;
+  auto &list = large_list<T>(state.range(0), keys);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.find(keys[i++ % keys.size()]));
+  }
+}
+BENCHMARK_TEMPLATE(BM_Find_Large, skiplist<int>)
+    ->RangeMultiplier(4)
+    ->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(BM_Find_Large, prefetch_skiplist<int>)
+    ->RangeMultiplier(4)
+    ->Range(1 << 16, 1 << 24);
+
+/**
+ * Odd keys are never in the list, each one is erased again outside the timed
+ * region so the size stays put
+ */
+template <typename T>
+void BM_Insert_Large(benchmark::State &state) {
+  std::vector<int> keys;
+  auto &list = large_list<T>(state.range(0), keys);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto key = keys[i++ % keys.size()] | 1;
+    benchmark::DoNotOptimize(list.insert(key));
+    state.PauseTiming();
+    list.erase(key);
+    state.ResumeTiming();
+  }
+}
+BENCHMARK_TEMPLATE(BM_Insert_Large, skiplist<int>)
+    ->RangeMultiplier(4)
+    ->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(BM_Insert_Large, prefetch_skiplist<int>)
+    ->RangeMultiplier(4)
+    ->Range(1 << 16, 1 << 24);
+
+/**
+ * Resolve range(0) random keys at once against 1 << 20 elements
+ */
+template <bool Batched>
+void BM_Find_Batch(benchmark::State &state) {
+  std::vector<int> keys;
+  auto &list = large_list<skiplist<int>>(1 << 20, keys);
+  keys.resize(state.range(0));
+  std::vector<skiplist<int>::iterator> found(keys.size());
+  for (auto _ : state) {
+    if constexpr (Batched) {
+      list.find_batch(keys.begin(), keys.end(), found.begin());
+    } else {
+      for (size_t i = 0; i < keys.size(); i++) found[i] = list.find(keys[i]);
+    }
+    benchmark::DoNotOptimize(found.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK_TEMPLATE(BM_Find_Batch, true)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_Find_Batch, false)->Range(64, 1024);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+#include "Map.hpp"
+#include "UnorderedMap.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+/* range(0) distinct random keys */
+std::vector<long> random_keys(size_t n) {
+  std::mt19937_64 gen{};
+  std::vector<long> keys(n);
+  for (auto &k : keys) k = static_cast<long>(gen() >> 1);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), gen);
+  return keys;
+}
+}  // namespace
+
+/**
+ * Point lookups of every key in a map of range(0) keys, in random order
+ */
+template <typename T>
+void BM_Find(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  T m;
+  for (auto k : keys) m.emplace(k, k);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64{1});
+  for (auto _ : state) {
+    for (auto k : keys) benchmark::DoNotOptimize(m.find(k));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+}
+BENCHMARK_TEMPLATE(BM_Find, wijagels::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(BM_Find, std::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(BM_Find, wijagels::map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+
+/**
+ * Lookups of keys that are absent from a map of range(0) keys
+ */
+template <typename T>
+void BM_Find_Miss(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  T m;
+  for (auto k : keys) m.emplace(k, k);
+  for (auto &k : keys) k = -k - 1;
+  for (auto _ : state) {
+    for (auto k : keys) benchmark::DoNotOptimize(m.find(k));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+}
+BENCHMARK_TEMPLATE(BM_Find_Miss, wijagels::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(BM_Find_Miss, std::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000);
+
+/**
+ * Erase and reinsert every key, the churn that fills other open addressing
+ * tables with tombstones
+ */
+template <typename T>
+void BM_Churn(benchmark::State &state) {
+  auto keys = random_keys(static_cast<size_t>(state.range(0)));
+  T m;
+  for (auto k : keys) m.emplace(k, k);
+  for (auto _ : state) {
+    for (auto k : keys) {
+      m.erase(k);
+      m.emplace(k + 1, k);
+      m.erase(k + 1);
+      m.emplace(k, k);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+}
+BENCHMARK_TEMPLATE(BM_Churn, wijagels::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_Churn, std::unordered_map<long, long>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000);
+
+BENCHMARK_MAIN();
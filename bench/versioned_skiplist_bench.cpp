@@ -0,0 +1,62 @@
+#include "SkipList.hpp"
+#include "VersionedSkipList.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using wijagels::skiplist;
+using wijagels::versioned_skiplist;
+
+/**
+ * Take a consistent view of range(0) elements, write 64 more while holding
+ * it, then scan the view. A versioned snapshot against copying a plain
+ * skiplist.
+ */
+template <typename T>
+void BM_Snapshot_Scan(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  T list;
+  for (int i = 0; i < state.range(0); i++) list.insert(dis(gen));
+  for (auto _ : state) {
+    int64_t sum = 0;
+    {
+      auto view = [&] {
+        if constexpr (std::is_same_v<T, skiplist<int>>) {
+          return T{list};
+        } else {
+          return list.snapshot();
+        }
+      }();
+      for (int i = 0; i < 64; i++) {
+        auto k = dis(gen);
+        list.insert(k);
+        list.erase(k);
+      }
+      for (auto e : view) sum += e;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Snapshot_Scan, skiplist<int>)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Snapshot_Scan, versioned_skiplist<int>)
+    ->Range(1 << 10, 1 << 18);
+
+template <typename T>
+void BM_Insert(benchmark::State &state) {
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> dis{};
+  std::vector<int> keys;
+  for (int i = 0; i < state.range(0); i++) keys.push_back(dis(gen));
+  for (auto _ : state) {
+    T list;
+    for (auto k : keys) list.insert(k);
+    benchmark::DoNotOptimize(list.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Insert, skiplist<int>)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Insert, versioned_skiplist<int>)->Range(1 << 10, 1 << 16);
+
+BENCHMARK_MAIN();
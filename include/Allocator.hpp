@@ -1,6 +1,11 @@
 // Copyright 2017 William Jagels
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <type_traits>
 
 namespace wijagels {
 template <typename T>
@@ -57,4 +62,146 @@ constexpr bool operator==(const BasicAllocator<T> &,
 template <typename T, typename U>
 constexpr bool operator!=(const BasicAllocator<T> &,
                           const BasicAllocator<U> &) noexcept;
+
+/*
+ * Hands out memory by bumping a pointer through large blocks.
+ * Nothing is reclaimed until release() or destruction, which free every
+ * block at once. Not thread safe.
+ */
+class arena {
+  struct block {
+    block *d_next;
+    std::size_t d_size;
+  };
+
+  static constexpr std::size_t HEADER =
+      (sizeof(block) + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  /* Start a block with room for at least bytes past its header */
+  void grow_(std::size_t bytes) {
+    auto size = std::max(d_block_size, bytes + HEADER);
+    auto raw = static_cast<block *>(::operator new(size));
+    raw->d_next = d_blocks;
+    raw->d_size = size;
+    d_blocks = raw;
+    d_cur = reinterpret_cast<unsigned char *>(raw) + HEADER;
+    d_end = reinterpret_cast<unsigned char *>(raw) + size;
+  }
+
+ public:
+  static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  explicit arena(std::size_t block_size = DEFAULT_BLOCK_SIZE) noexcept
+      : d_block_size{block_size} {}
+
+  arena(const arena &) = delete;
+  arena &operator=(const arena &) = delete;
+
+  ~arena() { release(); }
+
+  void *allocate(std::size_t bytes, std::size_t align) {
+    auto cur = reinterpret_cast<std::uintptr_t>(d_cur);
+    auto aligned = (cur + align - 1) & ~(std::uintptr_t{align} - 1);
+    if (!d_cur || aligned + bytes > reinterpret_cast<std::uintptr_t>(d_end)) {
+      grow_(bytes + align);
+      return allocate(bytes, align);
+    }
+    d_cur = reinterpret_cast<unsigned char *>(aligned + bytes);
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  /* Free every block, all memory handed out so far becomes invalid */
+  void release() noexcept {
+    while (d_blocks) {
+      auto next = d_blocks->d_next;
+      ::operator delete(d_blocks);
+      d_blocks = next;
+    }
+    d_cur = d_end = nullptr;
+  }
+
+  std::size_t block_size() const noexcept { return d_block_size; }
+
+  std::size_t block_count() const noexcept {
+    std::size_t count = 0;
+    for (auto b = d_blocks; b; b = b->d_next) ++count;
+    return count;
+  }
+
+ private:
+  std::size_t d_block_size;
+  block *d_blocks = nullptr;
+  unsigned char *d_cur = nullptr;
+  unsigned char *d_end = nullptr;
+};
+
+/*
+ * Monotonic allocator over a shared arena, deallocate is a no-op and the
+ * blocks are freed when the last allocator using the arena goes away.
+ * Containers that see is_monotonic skip per element deallocation and, when
+ * nothing else shares the arena, release its blocks in place on clear().
+ * Copies share the arena, containers copied from one another get an arena
+ * of their own.
+ */
+template <typename T>
+class arena_allocator {
+  template <typename>
+  friend class arena_allocator;
+
+ public:
+  using value_type = T;
+  using is_monotonic = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  arena_allocator() : arena_allocator{arena::DEFAULT_BLOCK_SIZE} {}
+
+  explicit arena_allocator(std::size_t block_size)
+      : d_arena{std::make_shared<arena>(block_size)} {}
+
+  arena_allocator(const arena_allocator &) noexcept = default;
+
+  arena_allocator &operator=(const arena_allocator &) noexcept = default;
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &other) noexcept
+      : d_arena{other.d_arena} {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(d_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *, std::size_t) noexcept {}
+
+  arena_allocator select_on_container_copy_construction() const {
+    return arena_allocator{d_arena->block_size()};
+  }
+
+  arena &resource() const noexcept { return *d_arena; }
+
+  /*
+   * Free every block of the arena if the held copies of this allocator are
+   * the only ones using it, returns whether it did
+   */
+  bool release_unshared(long held) const noexcept {
+    if (d_arena.use_count() > held) return false;
+    d_arena->release();
+    return true;
+  }
+
+  template <typename U>
+  bool operator==(const arena_allocator<U> &other) const noexcept {
+    return d_arena == other.d_arena;
+  }
+
+  template <typename U>
+  bool operator!=(const arena_allocator<U> &other) const noexcept {
+    return d_arena != other.d_arena;
+  }
+
+ private:
+  std::shared_ptr<arena> d_arena;
+};
 }  // namespace wijagels
@@ -0,0 +1,1414 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "SkipList.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wijagels {
+/*
+ * Block size policy for block_skiplist. A node holds as many elements as fit
+ * in Lines cache lines, but never fewer than four.
+ */
+template <size_t Lines = 2>
+struct block_lines {
+  static_assert(Lines > 0 && Lines <= 4, "blocks span one to four lines");
+  static constexpr size_t lines = Lines;
+};
+
+/*
+ * Unrolled skiplist: every node holds a sorted block of elements and the
+ * towers index the blocks by their first element. A search descends over the
+ * blocks and finishes with a linear count inside one of them, so a lookup
+ * touches a few times fewer nodes than in skiplist and reads each one a whole
+ * cache line at a time. Full blocks split in two, blocks that drop to a
+ * quarter full merge with a neighbour.
+ *
+ * The interface is the one skiplist has, so map can use either one as its
+ * container. Unlike skiplist, elements move between slots as their blocks
+ * change: every insert and erase invalidates all iterators, pointers and
+ * references into the list, not just those to the erased element, and
+ * extracted node handles own a copy of the element rather than the original.
+ * Only lookups and in place updates through a fresh iterator are safe to mix
+ * with a saved position.
+ */
+template <typename T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>, class Block = block_lines<>,
+          class Levels = geometric_levels<>>
+class block_skiplist {
+  template <typename, class, class, class, class>
+  friend class block_skiplist;
+
+ public:
+  static constexpr size_t MAX_LEVEL = 32;
+  static_assert(Levels::max_level <= MAX_LEVEL,
+                "the sentinel holds at most MAX_LEVEL levels");
+  /*
+   * Elements per block
+   */
+  static constexpr size_t CAPACITY =
+      std::max<size_t>(Block::lines * 64 / sizeof(T), 4);
+  static_assert(CAPACITY <= UINT16_MAX, "block counts are 16 bits");
+
+ private:
+  struct block_base;
+  struct block_node;
+  /*
+   * A link at one of the upper levels of a tower. width is the number of
+   * elements from the end of this block to the end of the block next points
+   * at.
+   */
+  struct block_link {
+    block_base *prev;
+    block_base *next;
+    size_t width;
+  };
+
+  /*
+   * Same layout as the nodes of skiplist, level 0 is linked through the block
+   * itself and the upper levels sit below it in the same allocation
+   */
+  struct block_base {
+    explicit block_base(size_t level, bool sentinel = false) noexcept
+        : d_prev{this},
+          d_next{this},
+          d_level{static_cast<uint8_t>(level)},
+          d_sentinel{sentinel} {}
+
+    block_base(const block_base &) = delete;
+    block_base &operator=(const block_base &) = delete;
+
+    size_t links() const noexcept { return d_level; }
+
+    block_link &upper(size_t level) noexcept {
+      assert(level > 0);
+      return *std::launder(reinterpret_cast<block_link *>(this) - level);
+    }
+
+    const block_link &upper(size_t level) const noexcept {
+      assert(level > 0);
+      return *std::launder(reinterpret_cast<const block_link *>(this) - level);
+    }
+
+    block_base *&next(size_t level) noexcept {
+      return level ? upper(level).next : d_next;
+    }
+
+    block_base *next(size_t level) const noexcept {
+      return level ? upper(level).next : d_next;
+    }
+
+    block_base *&prev(size_t level) noexcept {
+      return level ? upper(level).prev : d_prev;
+    }
+
+    block_base *prev(size_t level) const noexcept {
+      return level ? upper(level).prev : d_prev;
+    }
+
+    /*
+     * Level 0 widths are not stored, they are the size of the next block.
+     * The sentinel counts as an empty block.
+     */
+    size_t width(size_t level) const noexcept {
+      return level ? upper(level).width : d_next->d_count;
+    }
+
+    void expand(size_t size, size_t width) noexcept {
+      for (; d_level < size; ++d_level) {
+        upper(d_level) = block_link{this, this, width};
+      }
+    }
+
+    /*
+     * Number of elements from the start of this block to the end of the list
+     */
+    size_t distance_to_end() const noexcept {
+      size_t d = d_count;
+      for (auto node = this; !node->d_sentinel;) {
+        auto level = node->links() - 1;
+        d += node->width(level);
+        node = node->next(level);
+      }
+      return d;
+    }
+
+    T *items() noexcept { return static_cast<block_node *>(this)->items(); }
+
+    const T *items() const noexcept {
+      return static_cast<const block_node *>(this)->items();
+    }
+
+    const T &front() const noexcept { return items()[0]; }
+
+    block_base *d_prev;
+    block_base *d_next;
+    uint8_t d_level;
+    bool d_sentinel;
+    uint16_t d_count = 0;
+  };
+
+  struct block_node : block_base {
+    explicit block_node(size_t level) noexcept : block_base{level} {}
+
+    T *items() noexcept { return std::launder(reinterpret_cast<T *>(d_bytes)); }
+
+    const T *items() const noexcept {
+      return std::launder(reinterpret_cast<const T *>(d_bytes));
+    }
+
+    alignas(T) unsigned char d_bytes[sizeof(T) * CAPACITY];
+  };
+
+  struct block_head {
+    block_link d_tower[MAX_LEVEL - 1];
+    block_base d_base{1, true};
+  };
+  static_assert(offsetof(block_head, d_base) ==
+                    sizeof(block_link) * (MAX_LEVEL - 1),
+                "sentinel tower must sit directly below its links");
+
+  struct alignas(block_node) node_unit {
+    unsigned char d_bytes[alignof(block_node)];
+  };
+
+  /*
+   * Owner of an extracted element
+   */
+  struct value_node {
+    template <typename... Args>
+    explicit value_node(Args &&...args) : d_data{std::forward<Args>(args)...} {}
+
+    T d_data;
+  };
+
+ public:
+  class const_iterator;
+  class iterator {
+    friend block_skiplist;
+    block_base *d_block_p;
+    size_t d_index;
+
+   public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = size_t;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer =
+        typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    constexpr iterator() noexcept : d_block_p{nullptr}, d_index{0} {}
+
+   private:
+    constexpr iterator(block_base *block, size_t index) noexcept
+        : d_block_p{block}, d_index{index} {}
+    constexpr explicit iterator(const const_iterator &other)
+        : iterator{other.un_const()} {}
+
+   public:
+    iterator &operator++() {
+      if (++d_index == d_block_p->d_count) {
+        d_block_p = d_block_p->d_next;
+        d_index = 0;
+      }
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator ret{*this};
+      ++*this;
+      return ret;
+    }
+
+    iterator &operator--() {
+      if (d_index == 0) {
+        d_block_p = d_block_p->d_prev;
+        d_index = d_block_p->d_count;
+      }
+      --d_index;
+      return *this;
+    }
+
+    iterator operator--(int) {
+      iterator ret{*this};
+      --*this;
+      return ret;
+    }
+
+    reference operator*() const { return d_block_p->items()[d_index]; }
+
+    pointer operator->() const { return d_block_p->items() + d_index; }
+
+    constexpr friend bool operator==(const iterator &lhs, const iterator &rhs) {
+      return lhs.d_block_p == rhs.d_block_p && lhs.d_index == rhs.d_index;
+    }
+
+    constexpr friend bool operator!=(const iterator &lhs, const iterator &rhs) {
+      return !(lhs == rhs);
+    }
+
+    /*
+     * Logarithmic, both iterators must belong to the same list with lhs not
+     * after rhs
+     */
+    friend difference_type distance(const iterator &lhs, const iterator &rhs) {
+      return (lhs.d_block_p->distance_to_end() - lhs.d_index) -
+             (rhs.d_block_p->distance_to_end() - rhs.d_index);
+    }
+  };
+
+  class const_iterator {
+    friend block_skiplist;
+    friend iterator;
+    const block_base *d_block_p;
+    size_t d_index;
+
+   public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = size_t;
+    using reference = const value_type &;
+    using pointer = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    constexpr const_iterator() noexcept : d_block_p{nullptr}, d_index{0} {}
+
+    constexpr const_iterator(const iterator &other)
+        : d_block_p{other.d_block_p}, d_index{other.d_index} {}
+
+   private:
+    constexpr const_iterator(const block_base *block, size_t index) noexcept
+        : d_block_p{block}, d_index{index} {}
+
+   public:
+    const_iterator &operator++() {
+      if (++d_index == d_block_p->d_count) {
+        d_block_p = d_block_p->d_next;
+        d_index = 0;
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator ret{*this};
+      ++*this;
+      return ret;
+    }
+
+    const_iterator &operator--() {
+      if (d_index == 0) {
+        d_block_p = d_block_p->d_prev;
+        d_index = d_block_p->d_count;
+      }
+      --d_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator ret{*this};
+      --*this;
+      return ret;
+    }
+
+    reference operator*() const { return d_block_p->items()[d_index]; }
+
+    pointer operator->() const { return d_block_p->items() + d_index; }
+
+    constexpr friend bool operator==(const const_iterator &lhs,
+                                     const const_iterator &rhs) {
+      return lhs.d_block_p == rhs.d_block_p && lhs.d_index == rhs.d_index;
+    }
+
+    constexpr friend bool operator!=(const const_iterator &lhs,
+                                     const const_iterator &rhs) {
+      return !(lhs == rhs);
+    }
+
+    friend difference_type distance(const const_iterator &lhs,
+                                    const const_iterator &rhs) {
+      return lhs.remaining_() - rhs.remaining_();
+    }
+
+   private:
+    size_t remaining_() const noexcept {
+      return d_block_p->distance_to_end() - d_index;
+    }
+
+    constexpr iterator un_const() const {
+      return iterator{const_cast<block_base *>(d_block_p),  // NOLINT
+                      d_index};
+    }
+  };
+
+  using value_type = T;
+  using value_compare = Compare;
+  using allocator_type = Allocator;
+  using level_policy = Levels;
+  using size_type = size_t;
+  using difference_type = size_t;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = typename std::allocator_traits<allocator_type>::pointer;
+  using const_pointer =
+      typename std::allocator_traits<allocator_type>::const_pointer;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using node_ptr = value_node *;
+  using insert_type = std::pair<iterator, bool>;
+  using alloc_traits = std::allocator_traits<allocator_type>;
+  using node_allocator_type =
+      typename alloc_traits::template rebind_alloc<node_unit>;
+  using node_alloc_traits = std::allocator_traits<node_allocator_type>;
+  using value_allocator_type =
+      typename alloc_traits::template rebind_alloc<value_node>;
+  using value_alloc_traits = std::allocator_traits<value_allocator_type>;
+  class node_type;
+  using insert_return_type = detail::InsertReturnType<iterator, node_type>;
+
+  class node_type {
+   public:
+    using allocator_type = value_allocator_type;
+
+   protected:
+    friend block_skiplist;
+    node_ptr d_node_p;
+    allocator_type d_alloc;
+
+    void destroy_() {
+      if (!d_node_p) return;
+      value_alloc_traits::destroy(d_alloc, d_node_p);
+      value_alloc_traits::deallocate(d_alloc, d_node_p, 1);
+    }
+
+   public:
+    constexpr node_type() : node_type{nullptr} {}
+
+    node_type(node_ptr ptr, allocator_type alloc = allocator_type{})
+        : d_node_p{ptr}, d_alloc{std::move(alloc)} {}
+
+    node_type(const node_type &) = delete;
+
+    node_type(node_type &&other) noexcept
+        : node_type{other.d_node_p, std::move(other.d_alloc)} {
+      other.d_node_p = nullptr;
+    }
+
+    ~node_type() { destroy_(); }
+
+    node_type &operator=(const node_type &) = delete;
+
+    node_type &operator=(node_type &&other) noexcept {
+      destroy_();
+      d_node_p = std::exchange(other.d_node_p, nullptr);
+      if constexpr (value_alloc_traits::propagate_on_container_move_assignment::
+                        value) {
+        d_alloc = std::move(other.d_alloc);
+      }
+      return *this;
+    }
+
+    bool empty() const noexcept { return d_node_p == nullptr; }
+
+    explicit operator bool() const noexcept { return !empty(); }
+
+    allocator_type get_allocator() const noexcept { return d_alloc; }
+
+    void swap(node_type &nh) noexcept {
+      if constexpr (value_alloc_traits::propagate_on_container_swap::value) {
+        std::swap(d_alloc, nh.d_alloc);
+      }
+      std::swap(d_node_p, nh.d_node_p);
+    }
+
+    friend void swap(node_type &x, node_type &y) noexcept { x.swap(y); }
+  };
+
+ private:
+  static void link_(size_t level, block_base *first, block_base *last) {
+    first->next(level) = last;
+    last->prev(level) = first;
+  }
+
+  template <typename... Args>
+  static void link_(size_t level, block_base *first, block_base *second,
+                    Args... rest) {
+    link_(level, first, second);
+    link_(level, second, rest...);
+  }
+
+  /*
+   * Number of leading elements of block that satisfy before. The whole block
+   * is counted instead of stopping at the first miss, so there is no data
+   * dependent branch. Counting in fixed groups of eight lets the compiler turn
+   * each group into vector compares for arithmetic keys even at -O2.
+   */
+  template <class Pred>
+  static size_type count_(const block_base *block, Pred before) noexcept {
+    constexpr size_type GROUP = 8;
+    const T *items = block->items();
+    size_type count = block->d_count;
+    size_type n = 0;
+    size_type i = 0;
+    for (; i + GROUP <= count; i += GROUP) {
+      uint32_t hits = 0;
+      for (size_type j = 0; j < GROUP; j++) hits += before(items[i + j]);
+      n += hits;
+    }
+    for (; i < count; i++) n += before(items[i]);
+    return n;
+  }
+
+  /*
+   * The block a search lands in, the last one whose first element satisfies
+   * before (or the first block), and how many of its elements satisfy it.
+   * The position is the block's count when the answer is the first element of
+   * the next block. An empty list lands on the sentinel.
+   */
+  template <class Pred>
+  std::pair<const block_base *, size_type> descend_(Pred before) const {
+    const block_base *head = &head_();
+    const block_base *cur = head;
+    for (size_t level = head->links(); level-- > 0;) {
+      while (true) {
+        auto next = cur->next(level);
+        if (next == head || !before(next->front())) break;
+        cur = next;
+      }
+    }
+    if (cur == head) return {head->d_next, 0};
+    return {cur, count_(cur, before)};
+  }
+
+  /*
+   * Landing block for key, trying the block of the hint first, or the last
+   * block for end(). Sequential inserts never leave the block they go into.
+   */
+  template <class K>
+  std::pair<const block_base *, size_type> landing_(const_iterator hint,
+                                                    const K &key) const {
+    auto before = [&](const T &e) { return d_comp(e, key); };
+    auto block = hint.d_block_p;
+    if (block && block->d_sentinel) block = block->d_prev;
+    if (block && !block->d_sentinel && before(block->front()) &&
+        (block->d_next->d_sentinel || !before(block->d_next->front()))) {
+      return {block, count_(block, before)};
+    }
+    return descend_(before);
+  }
+
+  template <class Pred>
+  const_iterator partition_point_(Pred before) const {
+    auto [block, pos] = descend_(before);
+    if (pos == block->d_count) return const_iterator{block->d_next, 0};
+    return const_iterator{block, pos};
+  }
+
+  static iterator at_(block_base *block, size_type index) noexcept {
+    if (index == block->d_count) return iterator{block->d_next, 0};
+    return iterator{block, index};
+  }
+
+  /*
+   * Account for elements added to or removed from block. Every link that ends
+   * at the block or passes over it changes width by the same amount.
+   */
+  void resize_(block_base *block, size_type added, size_type removed) noexcept {
+    size_t lvl = block->links();
+    for (size_t i = 1; i < lvl; i++) {
+      auto &link = block->prev(i)->upper(i);
+      link.width = link.width + added - removed;
+    }
+    auto cur = block->prev(lvl - 1);
+    for (size_t i = lvl; i < head_().links(); i++) {
+      while (cur->links() <= i) cur = cur->prev(i - 1);
+      auto &link = cur->upper(i);
+      link.width = link.width + added - removed;
+    }
+    d_size = d_size + added - removed;
+  }
+
+  /*
+   * Link in block after pos, its elements are new to the list.
+   * Walks backwards from pos to find the predecessor at every level, counting
+   * how many elements behind the block each one ends.
+   */
+  void link_after_(block_base *pos, block_base *block) noexcept {
+    auto &head = head_();
+    size_t lvl = block->links();
+    size_type count = block->d_count;
+    head.expand(lvl, d_size);
+    auto cur = pos;
+    size_type dist = 0;
+    for (size_t i = 0; i < head.links(); i++) {
+      while (cur->links() <= i) {
+        cur = cur->prev(i - 1);
+        dist += cur->width(i - 1);
+      }
+      if (i >= lvl) {
+        cur->upper(i).width += count;
+        continue;
+      }
+      if (i > 0) {
+        block->upper(i).width = cur->upper(i).width - dist;
+        cur->upper(i).width = dist + count;
+      }
+      link_(i, cur, block, cur->next(i));
+    }
+    d_size += count;
+  }
+
+  /*
+   * Unlink block, its elements leave the list with it
+   */
+  void unlink_(block_base *block) noexcept {
+    size_t lvl = block->links();
+    size_type count = block->d_count;
+    for (size_t i = 0; i < lvl; i++) {
+      auto prev = block->prev(i);
+      if (i > 0) prev->upper(i).width += block->upper(i).width - count;
+      link_(i, prev, block->next(i));
+    }
+    auto cur = block->prev(lvl - 1);
+    for (size_t i = lvl; i < head_().links(); i++) {
+      while (cur->links() <= i) cur = cur->prev(i - 1);
+      cur->upper(i).width -= count;
+    }
+    d_size -= count;
+  }
+
+  block_base &head_() noexcept { return d_head.d_base; }
+
+  const block_base &head_() const noexcept { return d_head.d_base; }
+
+  void reset_head_() noexcept {
+    auto &head = head_();
+    head.d_level = 1;
+    head.d_prev = head.d_next = &head;
+    d_size = 0;
+  }
+
+  static void move_head_(block_base &from, block_base &to) noexcept {
+    to.d_level = from.d_level;
+    for (size_t i = 0; i < from.links(); i++) {
+      if (i > 0) to.upper(i).width = from.upper(i).width;
+      link_(i, from.prev(i), &to);
+      link_(i, &to, from.next(i));
+    }
+  }
+
+  size_t random_level_() {
+    return std::min<size_t>(d_levels(), Levels::max_level);
+  }
+
+  static constexpr size_t tower_offset_(size_t level) noexcept {
+    auto bytes = (level - 1) * sizeof(block_link);
+    return (bytes + alignof(block_node) - 1) / alignof(block_node) *
+           alignof(block_node);
+  }
+
+  static constexpr size_t node_units_(size_t level) noexcept {
+    return (tower_offset_(level) + sizeof(block_node) + sizeof(node_unit) -
+            1) /
+           sizeof(node_unit);
+  }
+
+  block_base *allocate_block_(size_t level) {
+    auto units = node_units_(level);
+    auto raw = node_alloc_traits::allocate(d_node_alloc, units);
+    auto bytes = reinterpret_cast<unsigned char *>(std::addressof(*raw));
+    auto block = reinterpret_cast<block_node *>(bytes + tower_offset_(level));
+    return ::new (block) block_node{level};
+  }
+
+  void destroy_block_(block_base *block) noexcept {
+    auto level = block->links();
+    T *items = block->items();
+    for (size_type i = 0; i < block->d_count; i++) {
+      alloc_traits::destroy(d_alloc, items + i);
+    }
+    static_cast<block_node *>(block)->~block_node();
+    auto bytes =
+        reinterpret_cast<unsigned char *>(block) - tower_offset_(level);
+    node_alloc_traits::deallocate(
+        d_node_alloc, reinterpret_cast<node_unit *>(bytes), node_units_(level));
+  }
+
+  void destroy_blocks_() noexcept {
+    auto &head = head_();
+    for (auto block = head.d_next; block != &head;) {
+      destroy_block_(std::exchange(block, block->d_next));
+    }
+  }
+
+  void relocate_(T *from, T *to) {
+    alloc_traits::construct(d_alloc, to, std::move(*from));
+    alloc_traits::destroy(d_alloc, from);
+  }
+
+  /*
+   * Construct an element at index pos of a block with room for it, moving up
+   * the ones after it
+   */
+  template <typename... Args>
+  void construct_at_(block_base *block, size_type pos, Args &&...args) {
+    T *items = block->items();
+    for (auto i = block->d_count; i > pos; i--) {
+      relocate_(items + i - 1, items + i);
+    }
+    try {
+      alloc_traits::construct(d_alloc, items + pos,
+                              std::forward<Args>(args)...);
+    } catch (...) {
+      for (auto i = pos; i < block->d_count; i++) {
+        relocate_(items + i + 1, items + i);
+      }
+      throw;
+    }
+    ++block->d_count;
+    resize_(block, 1, 0);
+  }
+
+  /*
+   * Destroy count elements starting at pos, moving down the ones after them
+   */
+  void destroy_at_(block_base *block, size_type pos, size_type count) {
+    T *items = block->items();
+    for (auto i = pos; i < pos + count; i++) {
+      alloc_traits::destroy(d_alloc, items + i);
+    }
+    for (auto i = pos + count; i < block->d_count; i++) {
+      relocate_(items + i, items + i - count);
+    }
+    block->d_count = static_cast<uint16_t>(block->d_count - count);
+    resize_(block, 0, count);
+  }
+
+  /*
+   * Make room in a full block for an element at pos by moving its upper half
+   * into a new block after it. Returns where the element now belongs.
+   * Appending to the last block starts an empty one instead, so ascending
+   * inserts leave full blocks behind them.
+   */
+  std::pair<block_base *, size_type> split_(block_base *block,
+                                            size_type pos) {
+    assert(block->d_count == CAPACITY);
+    auto next = allocate_block_(random_level_());
+    size_type keep = CAPACITY / 2;
+    if (pos == CAPACITY && block->d_next == &head_()) keep = CAPACITY;
+    T *from = block->items();
+    T *to = next->items();
+    for (auto i = keep; i < CAPACITY; i++) relocate_(from + i, to + i - keep);
+    next->d_count = static_cast<uint16_t>(CAPACITY - keep);
+    block->d_count = static_cast<uint16_t>(keep);
+    resize_(block, 0, next->d_count);
+    link_after_(block, next);
+    if (pos > keep || keep == CAPACITY) return {next, pos - keep};
+    return {block, pos};
+  }
+
+  /*
+   * Move every element of from onto the end of into, then free from
+   */
+  void absorb_(block_base *into, block_base *from) {
+    assert(into->d_count + from->d_count <= CAPACITY);
+    auto count = from->d_count;
+    unlink_(from);
+    T *items = from->items();
+    T *to = into->items() + into->d_count;
+    for (size_type i = 0; i < count; i++) relocate_(items + i, to + i);
+    from->d_count = 0;
+    into->d_count = static_cast<uint16_t>(into->d_count + count);
+    resize_(into, count, 0);
+    destroy_block_(from);
+  }
+
+  /*
+   * Called after elements were erased from block, drops it once empty and
+   * merges it into a neighbour once a quarter full. Returns the position of
+   * what was element index of block.
+   */
+  iterator rebalance_(block_base *block, size_type index) {
+    auto &head = head_();
+    if (block == &head) return end();
+    if (block->d_count > CAPACITY / 4) return at_(block, index);
+    if (block->d_count == 0) {
+      auto next = block->d_next;
+      unlink_(block);
+      destroy_block_(block);
+      return iterator{next, 0};
+    }
+    auto next = block->d_next;
+    if (next != &head && block->d_count + next->d_count <= CAPACITY) {
+      absorb_(block, next);
+      return iterator{block, index};
+    }
+    auto prev = block->d_prev;
+    if (prev != &head && prev->d_count + block->d_count <= CAPACITY) {
+      auto offset = prev->d_count;
+      absorb_(prev, block);
+      return at_(prev, offset + index);
+    }
+    return at_(block, index);
+  }
+
+  /*
+   * Find where key belongs and construct an element there from args if key
+   * is not already present
+   */
+  template <class K, typename... Args>
+  insert_type insert_unique_(const_iterator hint, const K &key,
+                             Args &&...args) {
+    auto &head = head_();
+    auto landing = landing_(hint, key);
+    auto block = const_cast<block_base *>(landing.first);  // NOLINT
+    auto pos = landing.second;
+    if (block == &head) {
+      block = allocate_block_(random_level_());
+      link_after_(&head, block);
+    } else if (pos < block->d_count) {
+      if (!d_comp(key, block->items()[pos])) {
+        return {iterator{block, pos}, false};
+      }
+    } else if (block->d_next != &head &&
+               !d_comp(key, block->d_next->front())) {
+      return {iterator{block->d_next, 0}, false};
+    }
+    if (block->d_count == CAPACITY) std::tie(block, pos) = split_(block, pos);
+    try {
+      construct_at_(block, pos, std::forward<Args>(args)...);
+    } catch (...) {
+      rebalance_(block, 0);
+      throw;
+    }
+    return {iterator{block, pos}, true};
+  }
+
+  /*
+   * Fills whole blocks at the back of the list from ascending elements that
+   * all sort after it. A block is linked in once it is full, so filling costs
+   * one walk back per block rather than per element. Whatever was pushed
+   * is linked in when the builder goes away, even by an exception.
+   */
+  class builder {
+   public:
+    explicit builder(block_skiplist &list) noexcept : d_list{list} {}
+
+    builder(const builder &) = delete;
+    builder &operator=(const builder &) = delete;
+
+    ~builder() { flush(); }
+
+    template <typename... Args>
+    void push(Args &&...args) {
+      if (!d_block) d_block = d_list.allocate_block_(d_list.random_level_());
+      T *items = d_block->items();
+      auto count = d_block->d_count;
+      alloc_traits::construct(d_list.d_alloc, items + count,
+                              std::forward<Args>(args)...);
+      assert(count == 0 || d_list.d_comp(items[count - 1], items[count]));
+      if (++d_block->d_count == CAPACITY) flush();
+    }
+
+    void flush() noexcept {
+      if (!d_block) return;
+      if (d_block->d_count == 0) {
+        d_list.destroy_block_(d_block);
+      } else {
+        d_list.link_after_(d_list.head_().d_prev, d_block);
+      }
+      d_block = nullptr;
+    }
+
+   private:
+    block_skiplist &d_list;
+    block_base *d_block = nullptr;
+  };
+
+  /*
+   * Rebuild the list keeping only the elements whose presence in other
+   * differs from drop_found
+   */
+  void filter_(const block_skiplist &other, bool drop_found) {
+    if (&other == this) return;
+    block_skiplist result{d_comp, d_alloc};
+    {
+      builder out{result};
+      auto b = other.begin();
+      for (auto &e : *this) {
+        while (b != other.end() && d_comp(*b, e)) ++b;
+        bool found = b != other.end() && !d_comp(e, *b);
+        if (found != drop_found) out.push(std::move_if_noexcept(e));
+      }
+    }
+    swap(result);
+  }
+
+ public:
+  block_skiplist() : block_skiplist{value_compare{}} {}
+
+  explicit block_skiplist(const value_compare &cmp,
+                          const allocator_type &alloc = allocator_type{},
+                          const level_policy &levels = level_policy{})
+      : d_comp{cmp}, d_alloc{alloc}, d_levels{levels} {}
+
+  block_skiplist(const block_skiplist &other)
+      : d_comp{other.d_comp},
+        d_alloc{alloc_traits::select_on_container_copy_construction(
+            other.d_alloc)},
+        d_levels{other.d_levels} {
+    insert(sorted_unique, other.begin(), other.end());
+  }
+
+  block_skiplist(block_skiplist &&other) noexcept(
+      std::is_nothrow_move_constructible_v<Compare>)
+      : d_comp{std::move(other.d_comp)},
+        d_alloc{std::move(other.d_alloc)},
+        d_node_alloc{std::move(other.d_node_alloc)},
+        d_size{other.d_size},
+        d_levels{std::move(other.d_levels)} {
+    move_head_(other.head_(), head_());
+    other.reset_head_();
+  }
+
+  template <class InputIt>
+  block_skiplist(InputIt first, InputIt last,
+                 const value_compare &cmp = value_compare(),
+                 const Allocator &alloc = Allocator(),
+                 const level_policy &levels = level_policy{})
+      : block_skiplist{cmp, alloc, levels} {
+    insert(first, last);
+  }
+
+  template <class InputIt>
+  block_skiplist(sorted_unique_t, InputIt first, InputIt last,
+                 const value_compare &cmp = value_compare(),
+                 const Allocator &alloc = Allocator(),
+                 const level_policy &levels = level_policy{})
+      : block_skiplist{cmp, alloc, levels} {
+    insert(sorted_unique, first, last);
+  }
+
+  block_skiplist(std::initializer_list<value_type> init,
+                 const value_compare &cmp = value_compare(),
+                 const Allocator &alloc = Allocator(),
+                 const level_policy &levels = level_policy{})
+      : block_skiplist{cmp, alloc, levels} {
+    insert(init);
+  }
+
+  ~block_skiplist() { destroy_blocks_(); }
+
+  block_skiplist &operator=(const block_skiplist &other) {
+    if (this == &other) return *this;
+    clear();
+    d_comp = other.d_comp;
+    d_levels = other.d_levels;
+    insert(sorted_unique, other.begin(), other.end());
+    return *this;
+  }
+
+  block_skiplist &operator=(block_skiplist &&other) noexcept(
+      alloc_traits::is_always_equal::value
+          &&std::is_nothrow_move_assignable_v<Compare>) {
+    clear();
+    d_comp = std::move(other.d_comp);
+    d_levels = std::move(other.d_levels);
+    if (typename alloc_traits::propagate_on_container_move_assignment()) {
+      d_alloc = other.d_alloc;
+      d_node_alloc = other.d_node_alloc;
+    }
+    if (d_node_alloc != other.d_node_alloc) {
+      insert(sorted_unique, std::make_move_iterator(other.begin()),
+             std::make_move_iterator(other.end()));
+      other.clear();
+    } else {
+      move_head_(other.head_(), head_());
+      d_size = other.d_size;
+      other.reset_head_();
+    }
+    return *this;
+  }
+
+  /* Iterators */
+  iterator begin() noexcept { return iterator{head_().d_next, 0}; }
+  iterator end() noexcept { return iterator{&head_(), 0}; }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cbegin() const noexcept {
+    return const_iterator{head_().d_next, 0};
+  }
+  const_iterator cend() const noexcept { return const_iterator{&head_(), 0}; }
+  reverse_iterator rbegin() noexcept { return reverse_iterator{end()}; }
+  reverse_iterator rend() noexcept { return reverse_iterator{begin()}; }
+  const_reverse_iterator rbegin() const noexcept { return crbegin(); }
+  const_reverse_iterator rend() const noexcept { return crend(); }
+  const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator{cend()};
+  }
+  const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator{cbegin()};
+  }
+
+  /* Capacity */
+  bool empty() const noexcept { return d_size == 0; }
+
+  size_type size() const noexcept { return d_size; }
+
+  size_type max_size() const noexcept {
+    return node_alloc_traits::max_size(d_node_alloc) / node_units_(1) *
+           CAPACITY;
+  }
+
+  /* Modifiers */
+  void clear() noexcept {
+    destroy_blocks_();
+    reset_head_();
+  }
+
+  insert_type insert(const_reference data) { return insert(cend(), data); }
+
+  insert_type insert(const_iterator hint, const_reference data) {
+    return insert_unique_(hint, data, data);
+  }
+
+  insert_type insert(value_type &&data) {
+    return insert(cend(), std::move(data));
+  }
+
+  insert_type insert(const_iterator hint, value_type &&data) {
+    return insert_unique_(hint, data, std::move(data));
+  }
+
+  insert_return_type insert(node_type &&nh) {
+    if (!nh) return {end(), false, {}};
+    auto pos = insert(std::move(nh.d_node_p->d_data));
+    if (!pos.second) return {pos.first, false, std::move(nh)};
+    node_type{std::move(nh)};
+    return {pos.first, true, {}};
+  }
+
+  iterator insert(const_iterator hint, node_type &&nh) {
+    if (!nh) return end();
+    auto pos = insert(hint, std::move(nh.d_node_p->d_data));
+    if (pos.second) node_type{std::move(nh)};
+    return pos.first;
+  }
+
+  /*
+   * Each element is tried against the last block before searching, so
+   * ascending ranges go in without any descents
+   */
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) insert(cend(), *first);
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  /*
+   * [first, last) must be ordered by value_comp() without duplicates.
+   * An empty list is filled a whole block at a time without comparisons.
+   */
+  template <class InputIt>
+  void insert(sorted_unique_t, InputIt first, InputIt last) {
+    if (!empty()) return insert(first, last);
+    builder out{*this};
+    for (; first != last; ++first) out.push(*first);
+  }
+
+  template <typename... Args>
+  insert_type emplace(Args &&...args) {
+    return insert(cend(), value_type{std::forward<Args>(args)...});
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args &&...args) {
+    return insert(hint, value_type{std::forward<Args>(args)...}).first;
+  }
+
+  /*
+   * Search for key once and construct an element from args in its place only
+   * if it is absent, see skiplist::lazy_emplace
+   */
+  template <class K, typename... Args>
+  insert_type lazy_emplace(const_iterator hint, const K &key, Args &&...args) {
+    return insert_unique_(hint, key, std::forward<Args>(args)...);
+  }
+
+  iterator erase(const_iterator pos) {
+    auto it = pos.un_const();
+    destroy_at_(it.d_block_p, it.d_index, 1);
+    return rebalance_(it.d_block_p, it.d_index);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator{pos}); }
+
+  /*
+   * Blocks wholly inside the range are unlinked and freed without touching
+   * their neighbours' elements. The blocks the range starts and ends in are
+   * both trimmed, so both get the chance to merge.
+   */
+  iterator erase(const_iterator first, const_iterator last) {
+    auto n = first.remaining_() - last.remaining_();
+    auto it = first.un_const();
+    auto block = it.d_block_p;
+    auto index = it.d_index;
+    // A range starting mid-block leaves that block's first index elements
+    auto start = index ? block : nullptr;
+    auto kept = index;
+    while (n > 0) {
+      auto count = std::min<size_type>(n, block->d_count - index);
+      n -= count;
+      if (count == block->d_count) {
+        auto next = block->d_next;
+        unlink_(block);
+        destroy_block_(block);
+        block = next;
+        continue;
+      }
+      destroy_at_(block, index, count);
+      if (index == block->d_count) {
+        block = block->d_next;
+        index = 0;
+      }
+    }
+    if (!start || start == block) return rebalance_(block, index);
+    // The range ended at the front of block, right behind start's elements,
+    // so once block is settled the end is still element kept of start
+    rebalance_(block, 0);
+    return rebalance_(start, kept);
+  }
+
+  template <typename K>
+  size_type erase(const K &val) {
+    auto it = find(val);
+    if (it == end()) return 0;
+    erase(it);
+    return 1;
+  }
+
+  void swap(block_skiplist &other) noexcept(
+      alloc_traits::is_always_equal::value
+          &&std::is_nothrow_swappable_v<Compare>) {
+    std::swap(d_comp, other.d_comp);
+    std::swap(d_alloc, other.d_alloc);
+    std::swap(d_node_alloc, other.d_node_alloc);
+    std::swap(d_levels, other.d_levels);
+    block_head tmp;
+    move_head_(head_(), tmp.d_base);
+    move_head_(other.head_(), head_());
+    move_head_(tmp.d_base, other.head_());
+    std::swap(d_size, other.d_size);
+  }
+
+  /*
+   * The element is moved out into a node of its own
+   */
+  node_type extract(const_iterator pos) {
+    value_allocator_type alloc{d_alloc};
+    auto node = value_alloc_traits::allocate(alloc, 1);
+    try {
+      value_alloc_traits::construct(alloc, node,
+                                    std::move(*pos.un_const()));
+    } catch (...) {
+      value_alloc_traits::deallocate(alloc, node, 1);
+      throw;
+    }
+    erase(pos);
+    return node_type{node, alloc};
+  }
+
+  node_type extract(const_reference data) {
+    auto it = find(data);
+    if (it != end()) return extract(it);
+    return node_type{};
+  }
+
+  template <class K,
+            class = std::enable_if_t<
+                detail::is_transparent<Compare>::value &&
+                !std::is_convertible_v<const K &, const_iterator>>>
+  node_type extract(const K &key) {
+    auto it = find(key);
+    if (it != end()) return extract(it);
+    return node_type{};
+  }
+
+  template <class C2>
+  void merge(block_skiplist<T, C2, Allocator, Block, Levels> &source) {
+    merge(std::move(source));
+  }
+
+  /*
+   * Elements already present stay behind in source
+   */
+  template <class C2>
+  void merge(block_skiplist<T, C2, Allocator, Block, Levels> &&source) {
+    if constexpr (std::is_same_v<C2, Compare>) {
+      if (&source == this) return;
+    }
+    for (auto it = source.begin(); it != source.end();) {
+      if (insert(std::move(*it)).second) {
+        it = source.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /*
+   * Set algebra against another list in O(size() + other.size()), the result
+   * is built into fresh blocks in one sweep. Both must be ordered the same
+   * way.
+   */
+
+  /* Add copies of the elements of other missing from this list */
+  void set_union(const block_skiplist &other) {
+    if (&other == this) return;
+    block_skiplist result{d_comp, d_alloc};
+    {
+      builder out{result};
+      auto b = other.begin();
+      for (auto &e : *this) {
+        for (; b != other.end() && d_comp(*b, e); ++b) out.push(*b);
+        if (b != other.end() && !d_comp(e, *b)) ++b;
+        out.push(std::move_if_noexcept(e));
+      }
+      for (; b != other.end(); ++b) out.push(*b);
+    }
+    swap(result);
+  }
+
+  /* Erase the elements not found in other */
+  void set_intersection(const block_skiplist &other) {
+    filter_(other, false);
+  }
+
+  /* Erase the elements found in other */
+  void set_difference(const block_skiplist &other) {
+    if (&other == this) return clear();
+    filter_(other, true);
+  }
+
+  /*
+   * Move every element not less than key into a new list. Unlike skiplist
+   * this is linear in the elements moved, they are packed into new blocks.
+   */
+  template <class K>
+  block_skiplist split(const K &key) {
+    block_skiplist tail{d_comp, d_alloc, d_levels};
+    auto first = lower_bound(key);
+    {
+      builder out{tail};
+      for (auto it = first; it != end(); ++it) {
+        out.push(std::move_if_noexcept(*it));
+      }
+    }
+    erase(first, cend());
+    return tail;
+  }
+
+  /*
+   * Concatenate a list whose elements all sort before or after ours, leaving
+   * other empty. Linear in the size of whichever list is appended.
+   */
+  void join(block_skiplist &other) { join(std::move(other)); }
+
+  void join(block_skiplist &&other) {
+    if (&other == this || other.empty()) return;
+    if (!empty() && d_comp(*other.rbegin(), *begin())) swap(other);
+    assert(empty() || d_comp(*rbegin(), *other.begin()));
+    {
+      builder out{*this};
+      for (auto &e : other) out.push(std::move_if_noexcept(e));
+    }
+    other.clear();
+  }
+
+  /* Lookup */
+  template <class K>
+  iterator find(const K &key) {
+    return iterator{std::as_const(*this).find(key)};
+  }
+
+  template <class K>
+  const_iterator find(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    auto it = lower_bound(key);
+    if (it != end() && !d_comp(key, *it)) return it;
+    return end();
+  }
+
+  template <class K>
+  size_type count(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <class K>
+  bool contains(const K &key) const {
+    return find(key) != end();
+  }
+
+  /*
+   * Same results as a loop of find, kept for interface parity with skiplist.
+   * Blocks already cut the misses of a descent to a handful.
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    for (; first != last; ++first) *out++ = find(*first);
+    return out;
+  }
+
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    for (; first != last; ++first) *out++ = find(*first);
+    return out;
+  }
+
+  template <class K>
+  iterator lower_bound(const K &key) {
+    return iterator{std::as_const(*this).lower_bound(key)};
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    return partition_point_([&](const T &e) { return d_comp(e, key); });
+  }
+
+  template <class K>
+  iterator upper_bound(const K &key) {
+    return iterator{std::as_const(*this).upper_bound(key)};
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    return partition_point_([&](const T &e) { return !d_comp(key, e); });
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &key) {
+    auto range = std::as_const(*this).equal_range(key);
+    return {iterator{range.first}, iterator{range.second}};
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    auto first = lower_bound(key);
+    auto last = first;
+    if (last != end() && !d_comp(key, *last)) ++last;
+    return {first, last};
+  }
+
+  /* Indexing */
+  /*
+   * Element at position n, or end() if n is out of range
+   */
+  iterator nth(size_type n) {
+    return iterator{std::as_const(*this).nth(n)};
+  }
+
+  const_iterator nth(size_type n) const {
+    const block_base *head = &head_();
+    if (n >= d_size) return cend();
+    const block_base *cur = head;
+    size_type pos = 0;
+    for (size_t level = head->links(); level-- > 0;) {
+      while (cur->next(level) != head && pos + cur->width(level) <= n) {
+        pos += cur->width(level);
+        cur = cur->next(level);
+      }
+    }
+    return const_iterator{cur->d_next, n - pos};
+  }
+
+  /*
+   * Number of elements that compare less than key
+   */
+  template <class K>
+  size_type rank(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    auto before = [&](const T &e) { return d_comp(e, key); };
+    const block_base *head = &head_();
+    const block_base *cur = head;
+    size_type pos = 0;
+    for (size_t level = head->links(); level-- > 0;) {
+      for (auto next = cur->next(level); next != head && before(next->front());
+           next = cur->next(level)) {
+        pos += cur->width(level);
+        cur = next;
+      }
+    }
+    if (cur == head) return 0;
+    return pos - cur->d_count + count_(cur, before);
+  }
+
+
+  /* Observers */
+  value_compare value_comp() const { return d_comp; }
+
+  allocator_type get_allocator() const noexcept { return d_alloc; }
+
+ private:
+  value_compare d_comp;
+  allocator_type d_alloc;
+  node_allocator_type d_node_alloc{d_alloc};
+  block_head d_head;
+  size_type d_size = 0;
+  Levels d_levels;
+};
+
+template <class T, class... Policies>
+bool operator==(const block_skiplist<T, Policies...> &lhs,
+                const block_skiplist<T, Policies...> &rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class T, class... Policies>
+bool operator!=(const block_skiplist<T, Policies...> &lhs,
+                const block_skiplist<T, Policies...> &rhs) {
+  return !(lhs == rhs);
+}
+
+template <class T, class... Policies>
+bool operator<(const block_skiplist<T, Policies...> &lhs,
+               const block_skiplist<T, Policies...> &rhs) {
+  return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end(), lhs.value_comp());
+}
+
+template <class T, class... Policies>
+bool operator<=(const block_skiplist<T, Policies...> &lhs,
+                const block_skiplist<T, Policies...> &rhs) {
+  return (lhs < rhs) || (lhs == rhs);
+}
+
+template <class T, class... Policies>
+bool operator>(const block_skiplist<T, Policies...> &lhs,
+               const block_skiplist<T, Policies...> &rhs) {
+  return rhs < lhs;
+}
+
+template <class T, class... Policies>
+bool operator>=(const block_skiplist<T, Policies...> &lhs,
+                const block_skiplist<T, Policies...> &rhs) {
+  return rhs <= lhs;
+}
+
+}  // namespace wijagels
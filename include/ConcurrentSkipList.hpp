@@ -0,0 +1,583 @@
+// Copyright 2017 William Jagels
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace wijagels {
+namespace detail {
+struct epoch_cache {
+  uint64_t d_domain;
+  void *d_record;
+};
+
+inline std::atomic<uint64_t> g_epoch_domain_ids{1};
+inline thread_local epoch_cache g_epoch_cache{0, nullptr};
+
+/*
+ * Epoch based reclamation.
+ * Threads pin the domain while they may hold pointers into the structure.
+ * Retired objects are handed to Deleter once every thread that could still
+ * see them has unpinned, which is two epoch advances after retirement.
+ */
+template <class T, class Deleter>
+class epoch_domain {
+  struct bag {
+    uint64_t d_epoch = 0;
+    std::vector<T *> d_items;
+  };
+
+  struct alignas(64) record {
+    std::atomic<bool> d_active{true};
+    std::atomic<uint64_t> d_epoch{0};
+    record *d_next = nullptr;
+    bag d_bags[3];
+    size_t d_retired = 0;
+  };
+
+  static constexpr size_t ADVANCE_INTERVAL = 64;
+
+ public:
+  /*
+   * Keeps the calling thread pinned for its lifetime
+   */
+  class guard {
+    friend epoch_domain;
+    epoch_domain *d_domain_p;
+    record *d_record_p;
+
+    guard(epoch_domain *domain, record *rec) noexcept
+        : d_domain_p{domain}, d_record_p{rec} {}
+
+   public:
+    guard(const guard &) = delete;
+
+    guard(guard &&other) noexcept
+        : d_domain_p{other.d_domain_p}, d_record_p{other.d_record_p} {
+      other.d_record_p = nullptr;
+    }
+
+    ~guard() {
+      if (d_record_p) {
+        d_record_p->d_active.store(false, std::memory_order_release);
+      }
+    }
+
+    guard &operator=(const guard &) = delete;
+    guard &operator=(guard &&) = delete;
+
+    /*
+     * Hand over an object that has already been unlinked
+     */
+    void retire(T *ptr) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto epoch = d_domain_p->d_epoch.load(std::memory_order_seq_cst);
+      auto &b = d_record_p->d_bags[epoch % 3];
+      if (b.d_epoch != epoch) {
+        d_domain_p->free_(b);
+        b.d_epoch = epoch;
+      }
+      b.d_items.push_back(ptr);
+      if (++d_record_p->d_retired % ADVANCE_INTERVAL == 0) {
+        d_domain_p->try_advance_();
+      }
+    }
+  };
+
+  explicit epoch_domain(Deleter deleter = Deleter{})
+      : d_deleter{std::move(deleter)},
+        d_id{g_epoch_domain_ids.fetch_add(1, std::memory_order_relaxed)} {}
+
+  epoch_domain(const epoch_domain &) = delete;
+  epoch_domain &operator=(const epoch_domain &) = delete;
+
+  /*
+   * No thread may be pinned while the domain is destroyed
+   */
+  ~epoch_domain() {
+    for (auto rec = d_records.load(std::memory_order_acquire); rec;) {
+      assert(!rec->d_active.load());
+      for (auto &b : rec->d_bags) free_(b);
+      auto next = rec->d_next;
+      delete rec;
+      rec = next;
+    }
+  }
+
+  guard pin() {
+    auto rec = acquire_();
+    auto epoch = d_epoch.load(std::memory_order_seq_cst);
+    rec->d_epoch.store(epoch, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto &b : rec->d_bags) {
+      if (b.d_epoch + 2 <= epoch) free_(b);
+    }
+    return guard{this, rec};
+  }
+
+ private:
+  /*
+   * Claim a record, preferring the one this thread used last
+   */
+  record *acquire_() {
+    auto &cache = g_epoch_cache;
+    auto cached = static_cast<record *>(cache.d_record);
+    if (cache.d_domain == d_id && try_claim_(cached)) return cached;
+    auto rec = d_records.load(std::memory_order_acquire);
+    for (; rec; rec = rec->d_next) {
+      if (try_claim_(rec)) break;
+    }
+    if (!rec) {
+      rec = new record{};
+      auto head = d_records.load(std::memory_order_relaxed);
+      do {
+        rec->d_next = head;
+      } while (!d_records.compare_exchange_weak(head, rec,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+    }
+    cache = epoch_cache{d_id, rec};
+    return rec;
+  }
+
+  static bool try_claim_(record *rec) noexcept {
+    bool active = false;
+    return rec->d_active.compare_exchange_strong(active, true,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed);
+  }
+
+  /*
+   * The epoch can move on once every pinned thread has observed it
+   */
+  void try_advance_() noexcept {
+    auto epoch = d_epoch.load(std::memory_order_seq_cst);
+    for (auto rec = d_records.load(std::memory_order_acquire); rec;
+         rec = rec->d_next) {
+      if (rec->d_active.load(std::memory_order_seq_cst) &&
+          rec->d_epoch.load(std::memory_order_seq_cst) != epoch) {
+        return;
+      }
+    }
+    d_epoch.compare_exchange_strong(epoch, epoch + 1,
+                                    std::memory_order_seq_cst);
+  }
+
+  void free_(bag &b) {
+    for (auto ptr : b.d_items) d_deleter(ptr);
+    b.d_items.clear();
+  }
+
+  Deleter d_deleter;
+  const uint64_t d_id;
+  std::atomic<uint64_t> d_epoch{2};
+  std::atomic<record *> d_records{nullptr};
+};
+}  // namespace detail
+
+/*
+ * Lock-free ordered set.
+ * Every level is a singly linked list whose next pointers carry a mark bit
+ * for logical deletion, updates are single word CAS operations and nodes are
+ * freed through epoch based reclamation so readers never touch freed memory.
+ * find, insert and erase are linearizable, size() and for_each() are only
+ * weakly consistent while writers are active.
+ */
+template <typename T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+class concurrent_skiplist {
+ public:
+  static constexpr size_t MAX_LEVEL = 32;
+
+  using value_type = T;
+  using value_compare = Compare;
+  using allocator_type = Allocator;
+  using size_type = size_t;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+
+ private:
+  using link = std::atomic<uintptr_t>;
+
+  /*
+   * Like skiplist, the tower sits directly below the node, level i at
+   * this - 1 - i
+   */
+  struct alignas(link) cnode_base {
+    static constexpr uint8_t INSERTED = 1;
+    static constexpr uint8_t REMOVED = 2;
+
+    explicit cnode_base(size_t level) noexcept
+        : d_level{static_cast<uint8_t>(level)} {}
+
+    link &next(size_t level) noexcept {
+      return *std::launder(reinterpret_cast<link *>(this) - 1 - level);
+    }
+
+    T &data() noexcept { return static_cast<cnode *>(this)->d_data; }
+
+    uint8_t d_level;
+    /*
+     * The inserting and the removing thread both set a bit when they are done
+     * touching the node, whoever finishes second retires it
+     */
+    std::atomic<uint8_t> d_state{0};
+  };
+
+  struct cnode : cnode_base {
+    template <typename... Args>
+    explicit cnode(size_t level, Args &&...args)
+        : cnode_base{level}, d_data{std::forward<Args>(args)...} {}
+
+    T d_data;
+  };
+
+  struct cnode_head {
+    link d_tower[MAX_LEVEL];
+    cnode_base d_base{MAX_LEVEL};
+  };
+  static_assert(offsetof(cnode_head, d_base) == sizeof(link) * MAX_LEVEL,
+                "sentinel tower must sit directly below its links");
+
+  struct alignas(cnode) node_unit {
+    unsigned char d_bytes[alignof(cnode)];
+  };
+
+  struct node_deleter {
+    concurrent_skiplist *d_list_p;
+    void operator()(cnode_base *node) const { d_list_p->destroy_node_(node); }
+  };
+
+  using node_allocator_type = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<node_unit>;
+  using node_alloc_traits = std::allocator_traits<node_allocator_type>;
+  using domain_type = detail::epoch_domain<cnode_base, node_deleter>;
+
+  static bool marked_(uintptr_t word) noexcept { return word & 1; }
+
+  static cnode_base *ptr_(uintptr_t word) noexcept {
+    return reinterpret_cast<cnode_base *>(word & ~uintptr_t{1});
+  }
+
+  static uintptr_t word_(cnode_base *node) noexcept {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+
+  static constexpr size_t tower_offset_(size_t level) noexcept {
+    auto bytes = level * sizeof(link);
+    return (bytes + alignof(cnode) - 1) / alignof(cnode) * alignof(cnode);
+  }
+
+  static constexpr size_t node_units_(size_t level) noexcept {
+    return (tower_offset_(level) + sizeof(cnode) + sizeof(node_unit) - 1) /
+           sizeof(node_unit);
+  }
+
+  template <typename... Args>
+  cnode *allocate_node_(size_t level, Args &&...args) {
+    auto units = node_units_(level);
+    auto raw = node_alloc_traits::allocate(d_node_alloc, units);
+    auto bytes = reinterpret_cast<unsigned char *>(std::addressof(*raw));
+    auto node = reinterpret_cast<cnode *>(bytes + tower_offset_(level));
+    try {
+      node_alloc_traits::construct(d_node_alloc, node, level,
+                                   std::forward<Args>(args)...);
+    } catch (...) {
+      node_alloc_traits::deallocate(d_node_alloc, raw, units);
+      throw;
+    }
+    for (size_t i = 0; i < level; i++) new (&node->next(i)) link{0};
+    return node;
+  }
+
+  void destroy_node_(cnode_base *base) {
+    auto node = static_cast<cnode *>(base);
+    auto level = node->d_level;
+    node_alloc_traits::destroy(d_node_alloc, node);
+    auto bytes = reinterpret_cast<unsigned char *>(node) - tower_offset_(level);
+    node_alloc_traits::deallocate(d_node_alloc,
+                                  reinterpret_cast<node_unit *>(bytes),
+                                  node_units_(level));
+  }
+
+  /*
+   * Geometric with p = 1/2 from a per-thread xorshift generator
+   */
+  static size_t random_level_() noexcept {
+    thread_local uint64_t state = std::random_device{}() | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    auto level = static_cast<size_t>(__builtin_ctzll(state | (1ULL << 63))) + 1;
+    return std::min(level, MAX_LEVEL);
+  }
+
+  cnode_base &head_() noexcept { return d_head.d_base; }
+
+  void raise_height_(size_t level) noexcept {
+    auto height = d_height.load(std::memory_order_relaxed);
+    while (height < level &&
+           !d_height.compare_exchange_weak(height, level,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  /*
+   * Record the last node before key and the node after it at every level,
+   * unlinking any logically deleted nodes along the way.
+   * Returns true if an unmarked node with key was found in succs[0].
+   */
+  template <class K>
+  bool find_(const K &key, cnode_base **preds, cnode_base **succs) {
+  retry:
+    cnode_base *pred = &head_();
+    auto height = d_height.load(std::memory_order_acquire);
+    for (size_t level = MAX_LEVEL; level-- > height;) {
+      preds[level] = pred;
+      succs[level] = nullptr;
+    }
+    for (size_t level = height; level-- > 0;) {
+      auto curr = ptr_(pred->next(level).load(std::memory_order_acquire));
+      while (curr) {
+        auto succ = curr->next(level).load(std::memory_order_acquire);
+        if (marked_(succ)) {
+          auto expected = word_(curr);
+          if (!pred->next(level).compare_exchange_strong(
+                  expected, succ & ~uintptr_t{1}, std::memory_order_acq_rel,
+                  std::memory_order_acquire)) {
+            goto retry;
+          }
+          curr = ptr_(succ);
+          continue;
+        }
+        if (!d_comp(curr->data(), key)) break;
+        pred = curr;
+        curr = ptr_(succ);
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return succs[0] && !d_comp(key, succs[0]->data());
+  }
+
+  /*
+   * Runs once the inserting or removing thread is done with node
+   */
+  void release_(typename domain_type::guard &guard, cnode_base *node,
+                uint8_t done) {
+    auto other = done == cnode_base::INSERTED ? cnode_base::REMOVED
+                                              : cnode_base::INSERTED;
+    if (node->d_state.fetch_or(done, std::memory_order_acq_rel) & other) {
+      guard.retire(node);
+    }
+  }
+
+  template <class V>
+  bool insert_(V &&value) {
+    auto guard = d_domain.pin();
+    cnode_base *preds[MAX_LEVEL];
+    cnode_base *succs[MAX_LEVEL];
+    auto level = random_level_();
+    raise_height_(level);
+    cnode *node = nullptr;
+    while (true) {
+      bool found = node ? find_(node->d_data, preds, succs)
+                        : find_(value, preds, succs);
+      if (found) {
+        if (node) destroy_node_(node);
+        return false;
+      }
+      if (!node) node = allocate_node_(level, std::forward<V>(value));
+      for (size_t i = 0; i < level; i++) {
+        node->next(i).store(word_(succs[i]), std::memory_order_relaxed);
+      }
+      auto expected = word_(succs[0]);
+      if (preds[0]->next(0).compare_exchange_strong(
+              expected, word_(node), std::memory_order_acq_rel,
+              std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    d_size.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 1; i < level; i++) {
+      while (true) {
+        auto next = node->next(i).load(std::memory_order_acquire);
+        if (marked_(next)) goto done;
+        if (ptr_(next) != succs[i] &&
+            !node->next(i).compare_exchange_strong(
+                next, word_(succs[i]), std::memory_order_acq_rel)) {
+          goto done;  // Marked by a concurrent erase
+        }
+        auto expected = word_(succs[i]);
+        if (preds[i]->next(i).compare_exchange_strong(
+                expected, word_(node), std::memory_order_acq_rel,
+                std::memory_order_relaxed)) {
+          break;
+        }
+        find_(node->d_data, preds, succs);
+      }
+    }
+  done:
+    if (marked_(node->next(0).load(std::memory_order_acquire))) {
+      // Erased while we were linking, make sure no level still reaches it
+      find_(node->d_data, preds, succs);
+    }
+    release_(guard, node, cnode_base::INSERTED);
+    return true;
+  }
+
+ public:
+  concurrent_skiplist() : concurrent_skiplist{value_compare{}} {}
+
+  explicit concurrent_skiplist(const value_compare &cmp,
+                               const allocator_type &alloc = allocator_type{})
+      : d_comp{cmp}, d_node_alloc{alloc} {
+    for (auto &l : d_head.d_tower) l.store(0, std::memory_order_relaxed);
+  }
+
+  concurrent_skiplist(std::initializer_list<value_type> init,
+                      const value_compare &cmp = value_compare{},
+                      const allocator_type &alloc = allocator_type{})
+      : concurrent_skiplist{cmp, alloc} {
+    for (auto &e : init) insert(e);
+  }
+
+  concurrent_skiplist(const concurrent_skiplist &) = delete;
+  concurrent_skiplist &operator=(const concurrent_skiplist &) = delete;
+
+  /*
+   * Not thread safe, no other thread may be using the list
+   */
+  ~concurrent_skiplist() {
+    auto node = ptr_(head_().next(0).load(std::memory_order_acquire));
+    while (node) {
+      auto next = ptr_(node->next(0).load(std::memory_order_relaxed));
+      destroy_node_(node);
+      node = next;
+    }
+  }
+
+  /* Capacity */
+  bool empty() const noexcept { return size() == 0; }
+
+  size_type size() const noexcept {
+    return d_size.load(std::memory_order_relaxed);
+  }
+
+  /* Modifiers */
+  bool insert(const_reference value) { return insert_(value); }
+
+  bool insert(value_type &&value) { return insert_(std::move(value)); }
+
+  template <typename... Args>
+  bool emplace(Args &&...args) {
+    return insert_(value_type{std::forward<Args>(args)...});
+  }
+
+  template <class K>
+  bool erase(const K &key) {
+    auto guard = d_domain.pin();
+    cnode_base *preds[MAX_LEVEL];
+    cnode_base *succs[MAX_LEVEL];
+    while (true) {
+      if (!find_(key, preds, succs)) return false;
+      auto node = succs[0];
+      for (size_t i = node->d_level; i-- > 1;) {
+        auto next = node->next(i).load(std::memory_order_acquire);
+        while (!marked_(next) &&
+               !node->next(i).compare_exchange_weak(
+                   next, next | 1, std::memory_order_acq_rel)) {
+        }
+      }
+      auto next = node->next(0).load(std::memory_order_acquire);
+      while (!marked_(next) &&
+             !node->next(0).compare_exchange_weak(next, next | 1,
+                                                  std::memory_order_acq_rel)) {
+      }
+      if (marked_(next)) continue;  // Lost the race, look again
+      d_size.fetch_sub(1, std::memory_order_relaxed);
+      find_(key, preds, succs);
+      release_(guard, node, cnode_base::REMOVED);
+      return true;
+    }
+  }
+
+  /* Lookup */
+  /*
+   * Wait-free search that skips over deleted nodes instead of unlinking them
+   */
+  template <class K>
+  bool contains(const K &key) {
+    auto guard = d_domain.pin();
+    return find_node_(key) != nullptr;
+  }
+
+  template <class K>
+  std::optional<value_type> find(const K &key) {
+    auto guard = d_domain.pin();
+    if (auto node = find_node_(key)) return node->data();
+    return std::nullopt;
+  }
+
+  /*
+   * Visit every element in order. Elements inserted or erased during the
+   * walk may or may not be seen.
+   */
+  template <class F>
+  void for_each(F &&f) {
+    auto guard = d_domain.pin();
+    auto node = ptr_(head_().next(0).load(std::memory_order_acquire));
+    while (node) {
+      auto next = node->next(0).load(std::memory_order_acquire);
+      if (!marked_(next)) f(std::as_const(node->data()));
+      node = ptr_(next);
+    }
+  }
+
+  /* Observers */
+  value_compare value_comp() const { return d_comp; }
+
+ private:
+  template <class K>
+  cnode_base *find_node_(const K &key) {
+    cnode_base *pred = &head_();
+    cnode_base *curr = nullptr;
+    for (size_t level = d_height.load(std::memory_order_acquire);
+         level-- > 0;) {
+      curr = ptr_(pred->next(level).load(std::memory_order_acquire));
+      while (curr) {
+        auto succ = curr->next(level).load(std::memory_order_acquire);
+        if (!marked_(succ)) {
+          if (!d_comp(curr->data(), key)) break;
+          pred = curr;
+        }
+        curr = ptr_(succ);
+      }
+    }
+    if (curr && !d_comp(key, curr->data()) &&
+        !marked_(curr->next(0).load(std::memory_order_acquire))) {
+      return curr;
+    }
+    return nullptr;
+  }
+
+  value_compare d_comp;
+  node_allocator_type d_node_alloc;
+  cnode_head d_head;
+  alignas(64) std::atomic<size_t> d_height{1};
+  alignas(64) std::atomic<size_type> d_size{0};
+  domain_type d_domain{node_deleter{this}};
+};
+
+}  // namespace wijagels
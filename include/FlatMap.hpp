@@ -0,0 +1,766 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "Traits.hpp"
+#include "Vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace wijagels {
+/*
+ * Sorted map over two vectors, one of keys and one of mapped values, with
+ * the same interface as map for the operations both can do cheaply.
+ * Lookups are a branch free binary search of the key array, so they touch
+ * no mapped values. Single inserts and erases shift the tail of both
+ * arrays, ranges are sorted once and merged in one pass.
+ * Iterators dereference to a pair of references and are invalidated by
+ * every insert and erase. Node handles have no flat equivalent, so there is
+ * no extract or merge.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>>
+class flat_map {
+ public:
+  /* Aliases */
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using reference = std::pair<const Key &, T &>;
+  using const_reference = std::pair<const Key &, const T &>;
+
+ private:
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+ public:
+  using key_container_type =
+      vector<Key, typename alloc_traits::template rebind_alloc<Key>>;
+  using mapped_container_type =
+      vector<T, typename alloc_traits::template rebind_alloc<T>>;
+
+  /* Comparison functor for elements, by key */
+  class value_compare {
+   protected:
+    friend flat_map;
+    constexpr explicit value_compare(Compare c) : d_comp{std::move(c)} {}
+    Compare d_comp;
+
+   public:
+    template <class L, class R>
+    constexpr bool operator()(const L &lhs, const R &rhs) const {
+      return d_comp(lhs.first, rhs.first);
+    }
+  };
+
+ private:
+  template <bool Const>
+  class iterator_ {
+    friend flat_map;
+    friend iterator_<!Const>;
+    using mapped_pointer = std::conditional_t<Const, const T *, T *>;
+    const Key *d_key_p = nullptr;
+    mapped_pointer d_value_p = nullptr;
+
+    constexpr iterator_(const Key *key, mapped_pointer value) noexcept
+        : d_key_p{key}, d_value_p{value} {}
+
+   public:
+    using value_type = flat_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const, const_reference,
+                                         flat_map::reference>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    /* Holds the pair of references operator-> points into */
+    class pointer {
+      friend iterator_;
+      reference d_ref;
+      constexpr explicit pointer(reference ref) : d_ref{ref} {}
+
+     public:
+      constexpr const reference *operator->() const { return &d_ref; }
+    };
+
+    constexpr iterator_() noexcept = default;
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    constexpr iterator_(const iterator_<false> &other) noexcept  // NOLINT
+        : d_key_p{other.d_key_p}, d_value_p{other.d_value_p} {}
+
+    constexpr reference operator*() const { return {*d_key_p, *d_value_p}; }
+
+    constexpr pointer operator->() const { return pointer{**this}; }
+
+    constexpr reference operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    constexpr iterator_ &operator++() {
+      ++d_key_p;
+      ++d_value_p;
+      return *this;
+    }
+
+    constexpr iterator_ operator++(int) {
+      iterator_ ret{*this};
+      ++*this;
+      return ret;
+    }
+
+    constexpr iterator_ &operator--() {
+      --d_key_p;
+      --d_value_p;
+      return *this;
+    }
+
+    constexpr iterator_ operator--(int) {
+      iterator_ ret{*this};
+      --*this;
+      return ret;
+    }
+
+    constexpr iterator_ &operator+=(difference_type n) {
+      d_key_p += n;
+      d_value_p += n;
+      return *this;
+    }
+
+    constexpr iterator_ &operator-=(difference_type n) { return *this += -n; }
+
+    constexpr friend iterator_ operator+(iterator_ it, difference_type n) {
+      return it += n;
+    }
+
+    constexpr friend iterator_ operator+(difference_type n, iterator_ it) {
+      return it += n;
+    }
+
+    constexpr friend iterator_ operator-(iterator_ it, difference_type n) {
+      return it -= n;
+    }
+
+    constexpr friend difference_type operator-(const iterator_ &lhs,
+                                               const iterator_ &rhs) {
+      return lhs.d_key_p - rhs.d_key_p;
+    }
+
+    constexpr friend bool operator==(const iterator_ &lhs,
+                                     const iterator_ &rhs) {
+      return lhs.d_key_p == rhs.d_key_p;
+    }
+
+    constexpr friend bool operator!=(const iterator_ &lhs,
+                                     const iterator_ &rhs) {
+      return lhs.d_key_p != rhs.d_key_p;
+    }
+
+    constexpr friend bool operator<(const iterator_ &lhs,
+                                    const iterator_ &rhs) {
+      return lhs.d_key_p < rhs.d_key_p;
+    }
+
+    constexpr friend bool operator>(const iterator_ &lhs,
+                                    const iterator_ &rhs) {
+      return rhs < lhs;
+    }
+
+    constexpr friend bool operator<=(const iterator_ &lhs,
+                                     const iterator_ &rhs) {
+      return !(rhs < lhs);
+    }
+
+    constexpr friend bool operator>=(const iterator_ &lhs,
+                                     const iterator_ &rhs) {
+      return !(lhs < rhs);
+    }
+  };
+
+ public:
+  using iterator = iterator_<false>;
+  using const_iterator = iterator_<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+ private:
+  template <class K>
+  using lookup_key_t = detail::lookup_key_t<Compare, K, Key>;
+
+  /* Key overloads that would otherwise catch iterators stay out of the way */
+  template <class K>
+  using transparent_key_t =
+      std::enable_if_t<detail::is_transparent<Compare>::value &&
+                       !std::is_convertible_v<const K &, const_iterator>>;
+
+  /* Staging area for range inserts, keys are moved out of it */
+  using batch_type =
+      vector<std::pair<Key, T>,
+             typename alloc_traits::template rebind_alloc<std::pair<Key, T>>>;
+
+ public:
+  /* Constructors */
+  flat_map() : flat_map{Compare{}} {}
+
+  explicit flat_map(const Compare &comp, const Allocator &alloc = Allocator{})
+      : d_comp{comp},
+        d_keys(typename key_container_type::allocator_type{alloc}),
+        d_values(typename mapped_container_type::allocator_type{alloc}) {}
+
+  explicit flat_map(const Allocator &alloc) : flat_map{Compare{}, alloc} {}
+
+  /*
+   * Bulk load, the input is sorted once and the first of equal keys wins
+   */
+  template <class InputIt>
+  flat_map(InputIt first, InputIt last, const Compare &comp = Compare{},
+           const Allocator &alloc = Allocator{})
+      : flat_map{comp, alloc} {
+    insert(first, last);
+  }
+
+  template <class InputIt>
+  flat_map(InputIt first, InputIt last, const Allocator &alloc)
+      : flat_map{first, last, Compare{}, alloc} {}
+
+  template <class InputIt>
+  flat_map(sorted_unique_t, InputIt first, InputIt last,
+           const Compare &comp = Compare{},
+           const Allocator &alloc = Allocator{})
+      : flat_map{comp, alloc} {
+    insert(sorted_unique, first, last);
+  }
+
+  flat_map(std::initializer_list<value_type> init,
+           const Compare &comp = Compare{},
+           const Allocator &alloc = Allocator{})
+      : flat_map{init.begin(), init.end(), comp, alloc} {}
+
+  flat_map(std::initializer_list<value_type> init, const Allocator &alloc)
+      : flat_map{init.begin(), init.end(), Compare{}, alloc} {}
+
+  flat_map(const flat_map &) = default;
+  flat_map(flat_map &&) noexcept = default;
+
+  /* Destructor */
+  ~flat_map() = default;
+
+  /* Assignment */
+  flat_map &operator=(const flat_map &) = default;
+  flat_map &operator=(flat_map &&) noexcept = default;
+
+  flat_map &operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    insert(ilist);
+    return *this;
+  }
+
+  /* Allocator */
+  allocator_type get_allocator() const {
+    return allocator_type{d_keys.get_allocator()};
+  }
+
+  /* Element access */
+  T &at(const Key &key) {
+    auto i = find_index_(key);
+    if (i == size()) throw std::out_of_range{"Key not found"};
+    return d_values[i];
+  }
+
+  const T &at(const Key &key) const {
+    auto i = find_index_(key);
+    if (i == size()) throw std::out_of_range{"Key not found"};
+    return d_values[i];
+  }
+
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+  T &operator[](Key &&key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  /* Iterators */
+  iterator begin() noexcept { return at_(0); }
+  iterator end() noexcept { return at_(size()); }
+  const_iterator begin() const noexcept { return at_(0); }
+  const_iterator end() const noexcept { return at_(size()); }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  reverse_iterator rbegin() noexcept { return reverse_iterator{end()}; }
+  reverse_iterator rend() noexcept { return reverse_iterator{begin()}; }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator{end()};
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator{begin()};
+  }
+  const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+  const_reverse_iterator crend() const noexcept { return rend(); }
+
+  /* Capacity */
+  bool empty() const noexcept { return d_keys.empty(); }
+  size_type size() const noexcept { return d_keys.size(); }
+  size_type max_size() const noexcept {
+    return std::min(d_keys.max_size(), d_values.max_size());
+  }
+
+  void reserve(size_type n) {
+    d_keys.reserve(n);
+    d_values.reserve(n);
+  }
+
+  /* Modifiers */
+  void clear() noexcept {
+    d_keys.clear();
+    d_values.clear();
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return try_emplace_(cend(), value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return try_emplace_(cend(), value.first, std::move(value.second));
+  }
+
+  iterator insert(const_iterator hint, const value_type &value) {
+    return try_emplace_(hint, value.first, value.second).first;
+  }
+
+  iterator insert(const_iterator hint, value_type &&value) {
+    return try_emplace_(hint, value.first, std::move(value.second)).first;
+  }
+
+  /*
+   * The range is sorted on its own and merged with the map in one linear
+   * pass, or appended when it sorts after every key already present
+   */
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    batch_type batch(d_keys.get_allocator());
+    for (; first != last; ++first) batch.emplace_back(*first);
+    auto less = [&](const auto &lhs, const auto &rhs) {
+      return d_comp(lhs.first, rhs.first);
+    };
+    auto begin = batch.data();
+    auto end = begin + batch.size();
+    if (!std::is_sorted(begin, end, less)) std::stable_sort(begin, end, less);
+    end = std::unique(begin, end, [&](const auto &lhs, const auto &rhs) {
+      return !less(lhs, rhs);
+    });
+    merge_(begin, end);
+  }
+
+  /*
+   * The range must be sorted and free of duplicates, it is merged without
+   * sorting
+   */
+  template <class InputIt>
+  void insert(sorted_unique_t, InputIt first, InputIt last) {
+    batch_type batch(d_keys.get_allocator());
+    for (; first != last; ++first) batch.emplace_back(*first);
+    merge_(batch.data(), batch.data() + batch.size());
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class Range>
+  void insert_range(Range &&range) {
+    insert(std::begin(range), std::end(range));
+  }
+
+  template <class Range>
+  void insert_range(sorted_unique_t, Range &&range) {
+    insert(sorted_unique, std::begin(range), std::end(range));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    std::pair<Key, T> value(std::forward<Args>(args)...);
+    return try_emplace_(cend(), std::move(value.first),
+                        std::move(value.second));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator hint, Args &&...args) {
+    std::pair<Key, T> value(std::forward<Args>(args)...);
+    return try_emplace_(hint, std::move(value.first), std::move(value.second))
+        .first;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type &k, Args &&...args) {
+    return try_emplace_(cend(), k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type &&k, Args &&...args) {
+    return try_emplace_(cend(), std::move(k), std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator hint, const key_type &k,
+                       Args &&...args) {
+    return try_emplace_(hint, k, std::forward<Args>(args)...).first;
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator hint, key_type &&k, Args &&...args) {
+    return try_emplace_(hint, std::move(k), std::forward<Args>(args)...).first;
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type &k, M &&obj) {
+    return insert_or_assign_(cend(), k, std::forward<M>(obj));
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type &&k, M &&obj) {
+    return insert_or_assign_(cend(), std::move(k), std::forward<M>(obj));
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator hint, const key_type &k, M &&obj) {
+    return insert_or_assign_(hint, k, std::forward<M>(obj)).first;
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator hint, key_type &&k, M &&obj) {
+    return insert_or_assign_(hint, std::move(k), std::forward<M>(obj)).first;
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+
+  iterator erase(iterator pos) { return erase(const_iterator{pos}); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto i = index_(first);
+    auto j = index_(last);
+    if (i == j) return at_(i);
+    d_keys.erase(d_keys.cbegin() + i, d_keys.cbegin() + j);
+    d_values.erase(d_values.cbegin() + i, d_values.cbegin() + j);
+    return at_(i);
+  }
+
+  size_type erase(const key_type &key) { return erase_(key); }
+
+  template <class K, class = transparent_key_t<K>>
+  size_type erase(const K &x) {
+    return erase_(x);
+  }
+
+  void swap(flat_map &other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    std::swap(d_comp, other.d_comp);
+    d_keys.swap(other.d_keys);
+    d_values.swap(other.d_values);
+  }
+
+  /* Lookup */
+  template <class K>
+  size_type count(const K &x) const {
+    return find_index_(x) != size();
+  }
+
+  template <class K>
+  bool contains(const K &x) const {
+    return find_index_(x) != size();
+  }
+
+  template <class K>
+  iterator find(const K &x) {
+    return at_(find_index_(x));
+  }
+
+  template <class K>
+  const_iterator find(const K &x) const {
+    return at_(find_index_(x));
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &x) {
+    auto i = lower_index_(x);
+    return {at_(i), at_(i + found_at_(i, x))};
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &x) const {
+    auto i = lower_index_(x);
+    return {at_(i), at_(i + found_at_(i, x))};
+  }
+
+  template <class K>
+  iterator lower_bound(const K &x) {
+    return at_(lower_index_(x));
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &x) const {
+    return at_(lower_index_(x));
+  }
+
+  template <class K>
+  iterator upper_bound(const K &x) {
+    return at_(upper_index_(x));
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &x) const {
+    return at_(upper_index_(x));
+  }
+
+  /* Indexing */
+
+  iterator nth(size_type n) { return at_(std::min(n, size())); }
+
+  const_iterator nth(size_type n) const { return at_(std::min(n, size())); }
+
+  template <class K>
+  size_type rank(const K &x) const {
+    return lower_index_(x);
+  }
+
+  /* Observers */
+
+  key_compare key_comp() const { return d_comp; }
+
+  value_compare value_comp() const { return value_compare{d_comp}; }
+
+  const key_container_type &keys() const noexcept { return d_keys; }
+
+  const mapped_container_type &values() const noexcept { return d_values; }
+
+ private:
+  iterator at_(size_type i) noexcept {
+    return iterator{d_keys.data() + i, d_values.data() + i};
+  }
+
+  const_iterator at_(size_type i) const noexcept {
+    return const_iterator{d_keys.data() + i, d_values.data() + i};
+  }
+
+  size_type index_(const_iterator it) const noexcept {
+    return static_cast<size_type>(it.d_key_p - d_keys.data());
+  }
+
+  /*
+   * Halve the range without branching on the comparison, so the loop runs
+   * a fixed log2(size()) times and compiles to conditional moves
+   */
+  template <class K>
+  size_type lower_index_(const K &x) const {
+    const lookup_key_t<K> &key = x;
+    const Key *base = d_keys.data();
+    size_type n = size();
+    if (n == 0) return 0;
+    while (n > 1) {
+      size_type half = n / 2;
+      base = d_comp(base[half], key) ? base + half : base;
+      n -= half;
+    }
+    return static_cast<size_type>(base - d_keys.data()) + d_comp(*base, key);
+  }
+
+  template <class K>
+  size_type upper_index_(const K &x) const {
+    const lookup_key_t<K> &key = x;
+    const Key *base = d_keys.data();
+    size_type n = size();
+    if (n == 0) return 0;
+    while (n > 1) {
+      size_type half = n / 2;
+      base = d_comp(key, base[half]) ? base : base + half;
+      n -= half;
+    }
+    return static_cast<size_type>(base - d_keys.data()) + !d_comp(key, *base);
+  }
+
+  /* Whether the key at i, from lower_index_, is equivalent to x */
+  template <class K>
+  bool found_at_(size_type i, const K &x) const {
+    const lookup_key_t<K> &key = x;
+    return i != size() && !d_comp(key, d_keys[i]);
+  }
+
+  template <class K>
+  size_type find_index_(const K &x) const {
+    auto i = lower_index_(x);
+    return found_at_(i, x) ? i : size();
+  }
+
+  template <class K>
+  size_type erase_(const K &x) {
+    auto i = find_index_(x);
+    if (i == size()) return 0;
+    erase(at_(i));
+    return 1;
+  }
+
+  /*
+   * Where key belongs, the hint is taken when key sorts right before it
+   */
+  size_type insert_index_(const_iterator hint, const Key &key) const {
+    auto i = index_(hint);
+    if ((i == size() || d_comp(key, d_keys[i])) &&
+        (i == 0 || d_comp(d_keys[i - 1], key))) {
+      return i;
+    }
+    return lower_index_(key);
+  }
+
+  /*
+   * k is only moved from, into the new element, once the search has missed
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_(const_iterator hint, K &&k,
+                                         Args &&...args) {
+    const Key &key = k;
+    auto i = insert_index_(hint, key);
+    if (found_at_(i, key)) return {at_(i), false};
+    d_keys.emplace(d_keys.cbegin() + i, std::forward<K>(k));
+    try {
+      d_values.emplace(d_values.cbegin() + i, std::forward<Args>(args)...);
+    } catch (...) {
+      d_keys.erase(d_keys.cbegin() + i);
+      throw;
+    }
+    return {at_(i), true};
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_(const_iterator hint, K &&k,
+                                              M &&obj) {
+    auto res = try_emplace_(hint, std::forward<K>(k), std::forward<M>(obj));
+    if (!res.second) res.first->second = std::forward<M>(obj);
+    return res;
+  }
+
+  /*
+   * Merge a sorted run of unique pairs in, keeping the elements already
+   * present on equal keys. Every comparison is made before anything moves,
+   * recording how many present elements go before each new one. The merged
+   * arrays are then built on the side and swapped in, and the present
+   * elements are only moved there when that cannot throw, so a throw from
+   * the comparator or an element leaves the map as it was.
+   */
+  template <class Pair>
+  void merge_(Pair *first, Pair *last) {
+    auto n = static_cast<size_type>(last - first);
+    if (n == 0) return;
+    if (empty() || d_comp(d_keys[size() - 1], first->first)) {
+      reserve(size() + n);
+      auto old_size = size();
+      try {
+        for (; first != last; ++first) {
+          d_keys.push_back(std::move(first->first));
+          d_values.push_back(std::move(first->second));
+        }
+      } catch (...) {
+        d_keys.erase(d_keys.cbegin() + old_size, d_keys.cend());
+        d_values.erase(d_values.cbegin() + old_size, d_values.cend());
+        throw;
+      }
+      return;
+    }
+    constexpr auto skip = static_cast<size_type>(-1);  // Already present
+    vector<size_type,
+           typename alloc_traits::template rebind_alloc<size_type>>
+        before(d_keys.get_allocator());
+    before.reserve(n);
+    size_type i = 0;
+    for (auto it = first; it != last; ++it) {
+      while (i != size() && d_comp(d_keys[i], it->first)) ++i;
+      before.push_back(i != size() && !d_comp(it->first, d_keys[i]) ? skip
+                                                                    : i);
+    }
+    constexpr bool steal = std::is_nothrow_move_constructible_v<Key> &&
+                           std::is_nothrow_move_constructible_v<T>;
+    auto take = [](auto &present) -> decltype(auto) {
+      if constexpr (steal) {
+        return std::move(present);
+      } else {
+        return std::as_const(present);
+      }
+    };
+    key_container_type keys(d_keys.get_allocator());
+    mapped_container_type values(d_values.get_allocator());
+    keys.reserve(size() + n);
+    values.reserve(size() + n);
+    i = 0;
+    for (size_type j = 0; j != n; ++j) {
+      if (before[j] == skip) continue;
+      for (; i != before[j]; ++i) {
+        keys.push_back(take(d_keys[i]));
+        values.push_back(take(d_values[i]));
+      }
+      keys.push_back(std::move(first[j].first));
+      values.push_back(std::move(first[j].second));
+    }
+    for (; i != size(); ++i) {
+      keys.push_back(take(d_keys[i]));
+      values.push_back(take(d_values[i]));
+    }
+    d_keys.swap(keys);
+    d_values.swap(values);
+  }
+
+  key_compare d_comp;
+  key_container_type d_keys;
+  mapped_container_type d_values;
+};
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator==(const flat_map<Key, T, Compare, Alloc> &lhs,
+                const flat_map<Key, T, Compare, Alloc> &rhs) {
+  return lhs.keys() == rhs.keys() && lhs.values() == rhs.values();
+}
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator!=(const flat_map<Key, T, Compare, Alloc> &lhs,
+                const flat_map<Key, T, Compare, Alloc> &rhs) {
+  return !(lhs == rhs);
+}
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator<(const flat_map<Key, T, Compare, Alloc> &lhs,
+               const flat_map<Key, T, Compare, Alloc> &rhs) {
+  auto comp = lhs.key_comp();
+  auto &keys = lhs.keys();
+  auto &other = rhs.keys();
+  for (std::size_t i = 0; i != keys.size(); ++i) {
+    if (i == other.size() || comp(other[i], keys[i])) return false;
+    if (comp(keys[i], other[i])) return true;
+    // Equal keys, the mapped values decide
+    if (lhs.values()[i] < rhs.values()[i]) return true;
+    if (rhs.values()[i] < lhs.values()[i]) return false;
+  }
+  return keys.size() < other.size();
+}
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator<=(const flat_map<Key, T, Compare, Alloc> &lhs,
+                const flat_map<Key, T, Compare, Alloc> &rhs) {
+  return !(rhs < lhs);
+}
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator>(const flat_map<Key, T, Compare, Alloc> &lhs,
+               const flat_map<Key, T, Compare, Alloc> &rhs) {
+  return rhs < lhs;
+}
+
+template <class Key, class T, class Compare, class Alloc>
+bool operator>=(const flat_map<Key, T, Compare, Alloc> &lhs,
+                const flat_map<Key, T, Compare, Alloc> &rhs) {
+  return !(lhs < rhs);
+}
+}  // namespace wijagels
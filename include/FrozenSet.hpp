@@ -0,0 +1,374 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "Traits.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace wijagels {
+/*
+ * Immutable sorted array with a small search accelerator on top.
+ * The elements are split into blocks of about a cache line and the last
+ * element of every block is copied into an Eytzinger (breadth first) array,
+ * so a lookup is a branch free descent of that array followed by a
+ * branch free count over one block, which compilers vectorize.
+ * The accelerator costs one element and one block number per block.
+ * Elements, accelerator and header share one layout in memory and on disk,
+ * so a set of trivially copyable elements can be written to a file and
+ * mapped back without copying. Copies share the storage.
+ */
+template <typename T, class Compare = std::less<T>>
+class frozen_set {
+ public:
+  /* Aliases */
+  using value_type = T;
+  using value_compare = Compare;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using const_reference = const value_type &;
+  using const_pointer = const value_type *;
+  using const_iterator = const value_type *;
+  using iterator = const_iterator;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using reverse_iterator = const_reverse_iterator;
+
+  /* Elements per block, searched by a linear count */
+  static constexpr size_type BLOCK =
+      std::max<size_type>(4, 64 / sizeof(value_type));
+
+ private:
+  static constexpr char MAGIC[8] = {'W', 'J', 'F', 'R', 'O', 'Z', 'E', 'N'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  /* Start of a file, offsets are from the start of the mapping */
+  struct header {
+    char d_magic[8];
+    std::uint32_t d_version;
+    std::uint32_t d_value_size;
+    std::uint64_t d_size;
+    std::uint64_t d_samples;
+    std::uint64_t d_values_offset;
+    std::uint64_t d_samples_offset;
+    std::uint64_t d_blocks_offset;
+    std::uint64_t d_bytes;
+  };
+
+  static constexpr std::uint64_t round_up_(std::uint64_t n,
+                                           std::uint64_t align) {
+    return (n + align - 1) / align * align;
+  }
+
+  /* Whether the sections of a file fit the sizes it claims */
+  static bool consistent_(const header &h, size_t bytes) {
+    auto samples = (h.d_size + BLOCK - 1) / BLOCK;
+    return h.d_bytes == bytes && h.d_samples == samples &&
+           h.d_values_offset % alignof(T) == 0 &&
+           h.d_samples_offset % alignof(T) == 0 &&
+           h.d_blocks_offset % alignof(std::uint64_t) == 0 &&
+           h.d_values_offset >= sizeof(header) &&
+           h.d_values_offset + h.d_size * sizeof(T) <= h.d_samples_offset &&
+           h.d_samples_offset + samples * sizeof(T) <= h.d_blocks_offset &&
+           h.d_blocks_offset + samples * sizeof(std::uint64_t) == bytes;
+  }
+
+  struct owned {
+    std::vector<T> d_values;
+    std::vector<T> d_samples;
+    std::vector<std::uint64_t> d_blocks;
+  };
+
+  struct mapping {
+    void *d_addr;
+    size_t d_bytes;
+
+    ~mapping() { ::munmap(d_addr, d_bytes); }
+  };
+
+  /* In order walk of the Eytzinger tree handing out block numbers */
+  static std::uint64_t number_blocks_(std::vector<std::uint64_t> &blocks,
+                                      size_type k, std::uint64_t next) {
+    if (k > blocks.size()) return next;
+    next = number_blocks_(blocks, 2 * k, next);
+    blocks[k - 1] = next++;
+    return number_blocks_(blocks, 2 * k + 1, next);
+  }
+
+  /* Take ownership of sorted unique values and index them */
+  void build_(std::vector<T> &&sorted) {
+    auto store = std::make_shared<owned>();
+    auto &values = store->d_values;
+    values = std::move(sorted);
+    d_size = values.size();
+    auto samples = (d_size + BLOCK - 1) / BLOCK;
+    store->d_blocks.resize(samples);
+    number_blocks_(store->d_blocks, 1, 0);
+    store->d_samples.reserve(samples);
+    for (auto block : store->d_blocks) {
+      auto last = std::min<size_type>((block + 1) * BLOCK, d_size);
+      store->d_samples.push_back(values[last - 1]);
+    }
+    d_values = values.data();
+    d_samples = store->d_samples.data();
+    d_blocks = store->d_blocks.data();
+    d_sample_count = samples;
+    d_storage = std::move(store);
+  }
+
+  /*
+   * First element for which pred no longer holds, pred must hold for a
+   * prefix of the elements and for no others
+   */
+  template <class Pred>
+  const_iterator partition_point_(Pred pred) const {
+    size_type k = 1;
+    while (k <= d_sample_count) {
+      // The 16 descendants four levels down are adjacent
+      if (16 * k <= d_sample_count) {
+        __builtin_prefetch(d_samples + 16 * k - 1);
+      }
+      k = 2 * k + pred(d_samples[k - 1]);
+    }
+    // Undo the final run of right turns, what is left is the answer's node
+    k >>= __builtin_ctzll(~k) + 1;
+    if (k == 0) return end();
+    auto first = d_blocks[k - 1] * BLOCK;
+    auto last = std::min<size_type>(first + BLOCK, d_size);
+    size_type count = 0;
+    for (auto i = first; i < last; i++) count += pred(d_values[i]);
+    return d_values + first + count;
+  }
+
+ public:
+  /* Constructors */
+  frozen_set() : frozen_set{Compare{}} {}
+
+  explicit frozen_set(const Compare &comp) : d_comp{comp} {}
+
+  /*
+   * Copies the range, sorting and dropping duplicates unless it already is
+   * strictly ascending
+   */
+  template <class InputIt>
+  frozen_set(InputIt first, InputIt last, const Compare &comp = Compare{})
+      : d_comp{comp} {
+    std::vector<T> values(first, last);
+    auto less = [this](const T &lhs, const T &rhs) {
+      return d_comp(lhs, rhs);
+    };
+    auto ascending = std::adjacent_find(values.begin(), values.end(),
+                                        [&](const T &lhs, const T &rhs) {
+                                          return !less(lhs, rhs);
+                                        }) == values.end();
+    if (!ascending) {
+      std::stable_sort(values.begin(), values.end(), less);
+      values.erase(std::unique(values.begin(), values.end(),
+                               [&](const T &lhs, const T &rhs) {
+                                 return !less(lhs, rhs);
+                               }),
+                   values.end());
+    }
+    build_(std::move(values));
+  }
+
+  template <class InputIt>
+  frozen_set(sorted_unique_t, InputIt first, InputIt last,
+             const Compare &comp = Compare{})
+      : d_comp{comp} {
+    build_(std::vector<T>(first, last));
+  }
+
+  /*
+   * Map a file written by write(). The file must have been written for the
+   * same element type on a machine with the same layout.
+   */
+  static frozen_set map_file(const std::string &path,
+                             const Compare &comp = Compare{}) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only trivially copyable elements can be mapped");
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::system_error{errno, std::generic_category(), path};
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      auto err = errno;
+      ::close(fd);
+      throw std::system_error{err, std::generic_category(), path};
+    }
+    auto bytes = static_cast<size_t>(st.st_size);
+    if (bytes < sizeof(header)) {
+      ::close(fd);
+      throw std::runtime_error{path + ": not a frozen_set file"};
+    }
+    void *addr = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    auto err = errno;
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      throw std::system_error{err, std::generic_category(), path};
+    }
+    std::shared_ptr<mapping> map;
+    try {
+      map.reset(new mapping{addr, bytes});
+    } catch (...) {
+      ::munmap(addr, bytes);
+      throw;
+    }
+    auto base = static_cast<const unsigned char *>(addr);
+    header h;
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.d_magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        h.d_version != VERSION || h.d_value_size != sizeof(T) ||
+        !consistent_(h, bytes)) {
+      throw std::runtime_error{path + ": not a compatible frozen_set file"};
+    }
+    frozen_set out{comp};
+    out.d_values = reinterpret_cast<const T *>(base + h.d_values_offset);
+    out.d_samples = reinterpret_cast<const T *>(base + h.d_samples_offset);
+    out.d_blocks =
+        reinterpret_cast<const std::uint64_t *>(base + h.d_blocks_offset);
+    out.d_size = h.d_size;
+    out.d_sample_count = h.d_samples;
+    out.d_storage = std::move(map);
+    return out;
+  }
+
+  /*
+   * Write the set in the layout map_file() expects, throws
+   * std::runtime_error if the file cannot be written
+   */
+  void write(const std::string &path) const {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only trivially copyable elements can be written");
+    header h{};
+    std::memcpy(h.d_magic, MAGIC, sizeof(MAGIC));
+    h.d_version = VERSION;
+    h.d_value_size = sizeof(T);
+    h.d_size = d_size;
+    h.d_samples = d_sample_count;
+    h.d_values_offset = round_up_(sizeof(header), 64);
+    h.d_samples_offset = round_up_(h.d_values_offset + d_size * sizeof(T), 64);
+    h.d_blocks_offset = round_up_(
+        h.d_samples_offset + d_sample_count * sizeof(T), alignof(uint64_t));
+    h.d_bytes = h.d_blocks_offset + d_sample_count * sizeof(std::uint64_t);
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    auto put = [&out](std::uint64_t at, const void *data, size_t bytes) {
+      auto pos = static_cast<std::uint64_t>(out.tellp());
+      static constexpr char zeros[64] = {};
+      out.write(zeros, static_cast<std::streamsize>(at - pos));
+      out.write(static_cast<const char *>(data),
+                static_cast<std::streamsize>(bytes));
+    };
+    put(0, &h, sizeof(h));
+    put(h.d_values_offset, d_values, d_size * sizeof(T));
+    put(h.d_samples_offset, d_samples, d_sample_count * sizeof(T));
+    put(h.d_blocks_offset, d_blocks, d_sample_count * sizeof(std::uint64_t));
+    out.close();
+    if (!out) throw std::runtime_error{path + ": write failed"};
+  }
+
+  /* Iterators */
+  const_iterator begin() const noexcept { return d_values; }
+  const_iterator end() const noexcept { return d_values + d_size; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator{end()};
+  }
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator{begin()};
+  }
+  const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+  const_reverse_iterator crend() const noexcept { return rend(); }
+
+  /* Capacity */
+  bool empty() const noexcept { return d_size == 0; }
+
+  size_type size() const noexcept { return d_size; }
+
+  /* Lookup */
+  template <class K>
+  const_iterator find(const K &key) const {
+    auto it = lower_bound(key);
+    if (it != end() && !d_comp(key, *it)) return it;
+    return end();
+  }
+
+  template <class K>
+  size_type count(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <class K>
+  bool contains(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &key) const {
+    return partition_point_([&](const T &e) { return d_comp(e, key); });
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &key) const {
+    return partition_point_([&](const T &e) { return !d_comp(key, e); });
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &key) const {
+    auto first = lower_bound(key);
+    if (first == end() || d_comp(key, *first)) return {first, first};
+    return {first, first + 1};
+  }
+
+  /* Index access */
+  const_iterator nth(size_type index) const noexcept {
+    return d_values + std::min(index, d_size);
+  }
+
+  template <class K>
+  size_type rank(const K &key) const {
+    return static_cast<size_type>(lower_bound(key) - begin());
+  }
+
+  /* Observers */
+  value_compare value_comp() const { return d_comp; }
+
+ private:
+  Compare d_comp;
+  const T *d_values = nullptr;
+  const T *d_samples = nullptr;
+  const std::uint64_t *d_blocks = nullptr;
+  size_type d_size = 0;
+  size_type d_sample_count = 0;
+  std::shared_ptr<const void> d_storage;
+};
+
+/*
+ * Copy an ordered container of unique elements, such as skiplist,
+ * block_skiplist or map, into an immutable flat set without sorting again.
+ * The set searches faster and takes a fraction of the memory. Mapping one
+ * back from a file needs the container's value_comp().
+ */
+template <class Container>
+frozen_set<typename Container::value_type,
+           typename Container::value_compare>
+freeze(const Container &c) {
+  return frozen_set<typename Container::value_type,
+                    typename Container::value_compare>{
+      sorted_unique, c.begin(), c.end(), c.value_comp()};
+}
+
+}  // namespace wijagels
@@ -0,0 +1,538 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "Map.hpp"
+#include "UnorderedMap.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace wijagels {
+/*
+ * Ordered map with a hash index on the side for point lookups.
+ * The elements live in a map, which keeps them sorted for iteration,
+ * bounds, ranks and range scans. Beside it is a table probed like
+ * unordered_map's that points from each key's hash to its node, so find,
+ * at and erase by key cost a hash and usually one key comparison instead
+ * of a descent through the list. Inserts still descend to find the new
+ * element's place, then record it in both.
+ * Hash and KeyEqual must agree with Compare about which keys are equal.
+ * Iterators are the map's and stay valid until their element is erased.
+ * Node handles and the map's whole list operations (split, join, merge and
+ * set algebra) would bypass the index, so they are left out.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>>
+class indexed_map {
+  using map_type = map<Key, T, Compare, Allocator>;
+
+ public:
+  /* Aliases */
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = typename map_type::pointer;
+  using value_compare = typename map_type::value_compare;
+  using iterator = typename map_type::iterator;
+  using const_iterator = typename map_type::const_iterator;
+  using reverse_iterator = typename map_type::reverse_iterator;
+  using const_reverse_iterator = typename map_type::const_reverse_iterator;
+
+ private:
+  /* The node a full slot points at, and the hash bits its home came from */
+  struct slot {
+    iterator d_it;
+    std::uint32_t d_hash;
+  };
+
+  using table_type = detail::probe_index<slot, Allocator>;
+
+  /* Hashed lookups only skip the conversion when both functors allow it */
+  template <class K>
+  using hash_key_t =
+      std::conditional_t<detail::is_transparent<Hash>::value &&
+                             detail::is_transparent<KeyEqual>::value,
+                         K, Key>;
+
+  /* Key overloads that would otherwise catch iterators stay out of the way */
+  template <class K>
+  using transparent_key_t =
+      std::enable_if_t<detail::is_transparent<Hash>::value &&
+                       detail::is_transparent<KeyEqual>::value &&
+                       !std::is_convertible_v<const K &, const_iterator>>;
+
+ public:
+  /* Constructors */
+  indexed_map() : indexed_map{Compare{}} {}
+
+  explicit indexed_map(const Compare &comp, const Hash &hash = Hash{},
+                       const KeyEqual &equal = KeyEqual{},
+                       const Allocator &alloc = Allocator{})
+      : d_hash{hash}, d_equal{equal}, d_map{comp, alloc}, d_table(alloc) {}
+
+  explicit indexed_map(const Allocator &alloc)
+      : indexed_map{Compare{}, Hash{}, KeyEqual{}, alloc} {}
+
+  template <class InputIt>
+  indexed_map(InputIt first, InputIt last, const Compare &comp = Compare{},
+              const Hash &hash = Hash{}, const KeyEqual &equal = KeyEqual{},
+              const Allocator &alloc = Allocator{})
+      : indexed_map{comp, hash, equal, alloc} {
+    insert(first, last);
+  }
+
+  indexed_map(std::initializer_list<value_type> init,
+              const Compare &comp = Compare{}, const Hash &hash = Hash{},
+              const KeyEqual &equal = KeyEqual{},
+              const Allocator &alloc = Allocator{})
+      : indexed_map{init.begin(), init.end(), comp, hash, equal, alloc} {}
+
+  /*
+   * The copy has nodes of its own, so its index is built from scratch
+   */
+  indexed_map(const indexed_map &other)
+      : d_hash{other.d_hash},
+        d_equal{other.d_equal},
+        d_map{other.d_map},
+        d_table(other.get_allocator()) {
+    d_table.resize(capacity_for_(size()));
+    reindex_();
+  }
+
+  indexed_map(indexed_map &&other) = default;
+
+  /* Destructor */
+  ~indexed_map() = default;
+
+  /* Assignment */
+  indexed_map &operator=(const indexed_map &other) {
+    if (this == &other) return *this;
+    indexed_map copy{other};
+    swap(copy);
+    return *this;
+  }
+
+  /* Nodes must keep their addresses, so they are never moved one by one */
+  indexed_map &operator=(indexed_map &&other) {
+    indexed_map tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  indexed_map &operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    insert(ilist);
+    return *this;
+  }
+
+  /* Allocator */
+  allocator_type get_allocator() const { return d_map.get_allocator(); }
+
+  /* Element access */
+  T &at(const Key &key) {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range{"Key not found"};
+    return it->second;
+  }
+
+  const T &at(const Key &key) const {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range{"Key not found"};
+    return it->second;
+  }
+
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+  T &operator[](Key &&key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  /* Iterators */
+  iterator begin() noexcept { return d_map.begin(); }
+  iterator end() noexcept { return d_map.end(); }
+  const_iterator begin() const noexcept { return d_map.begin(); }
+  const_iterator end() const noexcept { return d_map.end(); }
+  const_iterator cbegin() const noexcept { return d_map.cbegin(); }
+  const_iterator cend() const noexcept { return d_map.cend(); }
+  reverse_iterator rbegin() noexcept { return d_map.rbegin(); }
+  reverse_iterator rend() noexcept { return d_map.rend(); }
+  const_reverse_iterator rbegin() const noexcept { return d_map.rbegin(); }
+  const_reverse_iterator rend() const noexcept { return d_map.rend(); }
+  const_reverse_iterator crbegin() const noexcept { return d_map.crbegin(); }
+  const_reverse_iterator crend() const noexcept { return d_map.crend(); }
+
+  /* Capacity */
+  bool empty() const { return d_map.empty(); }
+  size_type size() const { return d_map.size(); }
+  size_type max_size() const { return d_map.max_size(); }
+
+  /* Modifiers */
+  void clear() {
+    d_map.clear();
+    d_table.clear();
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return try_emplace_(cend(), value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return try_emplace_(cend(), value.first, std::move(value.second));
+  }
+
+  iterator insert(const_iterator hint, const value_type &value) {
+    return try_emplace_(hint, value.first, value.second).first;
+  }
+
+  iterator insert(const_iterator hint, value_type &&value) {
+    return try_emplace_(hint, value.first, std::move(value.second)).first;
+  }
+
+  /*
+   * A forward range at least as long as the map goes through the map's bulk
+   * insert, one sort and one merge pass, and the index is rebuilt after it.
+   * Anything else is inserted an element at a time.
+   */
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      auto count = static_cast<size_type>(std::distance(first, last));
+      if (count && count >= size()) {
+        // Room first, so nothing can fail between the merge and the index
+        auto capacity = capacity_for_(size() + count);
+        if (capacity > bucket_count()) d_table.resize(capacity);
+        try {
+          d_map.insert(first, last);
+        } catch (...) {
+          reindex_();  // A throwing comparator leaves part of the range in
+          throw;
+        }
+        return reindex_();
+      }
+    }
+    for (; first != last; ++first) insert(cend(), *first);
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    std::pair<Key, T> value(std::forward<Args>(args)...);
+    return try_emplace_(cend(), std::move(value.first),
+                        std::move(value.second));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator hint, Args &&...args) {
+    std::pair<Key, T> value(std::forward<Args>(args)...);
+    return try_emplace_(hint, std::move(value.first), std::move(value.second))
+        .first;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type &k, Args &&...args) {
+    return try_emplace_(cend(), k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type &&k, Args &&...args) {
+    return try_emplace_(cend(), std::move(k), std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator hint, const key_type &k, Args &&...args) {
+    return try_emplace_(hint, k, std::forward<Args>(args)...).first;
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator hint, key_type &&k, Args &&...args) {
+    return try_emplace_(hint, std::move(k), std::forward<Args>(args)...).first;
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type &k, M &&obj) {
+    return insert_or_assign_(cend(), k, std::forward<M>(obj));
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type &&k, M &&obj) {
+    return insert_or_assign_(cend(), std::move(k), std::forward<M>(obj));
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator hint, const key_type &k, M &&obj) {
+    return insert_or_assign_(hint, k, std::forward<M>(obj)).first;
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator hint, key_type &&k, M &&obj) {
+    return insert_or_assign_(hint, std::move(k), std::forward<M>(obj)).first;
+  }
+
+  iterator erase(const_iterator pos) {
+    d_table.erase(find_slot_(pos));
+    return d_map.erase(pos);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator{pos}); }
+
+  /*
+   * Every element in the range is hashed to clear its slot, the list then
+   * drops the range in one pass
+   */
+  iterator erase(const_iterator first, const_iterator last) {
+    for (auto it = first; it != last; ++it) d_table.erase(find_slot_(it));
+    return d_map.erase(first, last);
+  }
+
+  size_type erase(const key_type &key) { return erase_(key); }
+
+  template <class K, class = transparent_key_t<K>>
+  size_type erase(const K &x) {
+    return erase_(x);
+  }
+
+  void swap(indexed_map &other) noexcept(
+      noexcept(std::declval<map_type &>().swap(std::declval<map_type &>()))) {
+    std::swap(d_hash, other.d_hash);
+    std::swap(d_equal, other.d_equal);
+    d_map.swap(other.d_map);
+    d_table.swap(other.d_table);
+  }
+
+  /* Lookup */
+  template <class K>
+  size_type count(const K &x) const {
+    return find(x) != end();
+  }
+
+  template <class K>
+  bool contains(const K &x) const {
+    return find(x) != end();
+  }
+
+  /*
+   * Found through the hash index, the list is not searched
+   */
+  template <class K>
+  iterator find(const K &x) {
+    const hash_key_t<K> &key = x;
+    auto s = find_key_(key, hash_(key));
+    if (s == table_type::npos) return end();
+    return d_table[s].d_it;
+  }
+
+  template <class K>
+  const_iterator find(const K &x) const {
+    return const_cast<indexed_map *>(this)->find(x);  // NOLINT
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &x) {
+    auto it = find(x);
+    return {it, it == end() ? it : std::next(it)};
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &x) const {
+    auto it = find(x);
+    return {it, it == end() ? it : std::next(it)};
+  }
+
+  template <class K>
+  iterator lower_bound(const K &x) {
+    return d_map.lower_bound(x);
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &x) const {
+    return d_map.lower_bound(x);
+  }
+
+  template <class K>
+  iterator upper_bound(const K &x) {
+    return d_map.upper_bound(x);
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &x) const {
+    return d_map.upper_bound(x);
+  }
+
+  /* Indexing */
+
+  iterator nth(size_type n) { return d_map.nth(n); }
+
+  const_iterator nth(size_type n) const { return d_map.nth(n); }
+
+  template <class K>
+  size_type rank(const K &x) const {
+    return d_map.rank(x);
+  }
+
+  /*
+   * Shape and memory use of the list, the index adds bucket_count() slots
+   */
+  skiplist_stats stats(size_type samples = 64) const {
+    return d_map.stats(samples);
+  }
+
+  /* Bucket interface */
+  size_type bucket_count() const noexcept { return d_table.capacity(); }
+
+  /* Hash policy */
+  float load_factor() const noexcept {
+    return empty() ? 0.0F
+                   : static_cast<float>(size()) /
+                         static_cast<float>(bucket_count());
+  }
+
+  float max_load_factor() const noexcept { return 0.875F; }
+
+  /*
+   * Resize the index to at least count slots, and enough for size()
+   */
+  void rehash(size_type count) {
+    auto capacity = capacity_for_(size());
+    while (capacity < count) capacity *= 2;
+    if (capacity != bucket_count()) d_table.resize(capacity);
+  }
+
+  /*
+   * Make room in the index for count elements, the list has no capacity
+   */
+  void reserve(size_type count) {
+    if (count > table_type::max_load(bucket_count())) {
+      d_table.resize(capacity_for_(count));
+    }
+  }
+
+  /* Observers */
+  hasher hash_function() const { return d_hash; }
+
+  key_equal key_eq() const { return d_equal; }
+
+  key_compare key_comp() const { return d_map.key_comp(); }
+
+  value_compare value_comp() const { return d_map.value_comp(); }
+
+ private:
+  template <class K>
+  std::uint64_t hash_(const K &key) const {
+    return detail::mix_hash(d_hash(key));
+  }
+
+  template <class K>
+  size_type find_key_(const K &key, std::uint64_t hash) const {
+    return d_table.find(
+        hash, [&](const slot &s) { return d_equal(s.d_it->first, key); });
+  }
+
+  /* The slot that points at pos */
+  size_type find_slot_(const_iterator pos) const {
+    return d_table.find(hash_(pos->first), [pos](const slot &s) {
+      return const_iterator{s.d_it} == pos;
+    });
+  }
+
+  /* Smallest table that holds count elements */
+  static size_type capacity_for_(size_type count) noexcept {
+    size_type capacity = table_type::GROUP;
+    while (table_type::max_load(capacity) < count) capacity *= 2;
+    return capacity;
+  }
+
+  /* Index every element again, the table must already have room */
+  void reindex_() {
+    d_table.clear();
+    for (auto it = begin(); it != end(); ++it) {
+      d_table.insert(hash_(it->first), slot{it, 0});
+    }
+  }
+
+  /*
+   * The index answers whether k is new, so the list is only descended to
+   * place a new element, and k is only moved from then
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_(const_iterator hint, K &&k,
+                                         Args &&...args) {
+    const Key &key = k;
+    auto hash = hash_(key);
+    auto s = find_key_(key, hash);
+    if (s != table_type::npos) return {d_table[s].d_it, false};
+    if (size() >= table_type::max_load(bucket_count())) {
+      d_table.resize(bucket_count() ? bucket_count() * 2 : table_type::GROUP);
+    }
+    auto it = d_map.try_emplace(hint, std::forward<K>(k),
+                                std::forward<Args>(args)...);
+    d_table.insert(hash, slot{it, 0});
+    return {it, true};
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_(const_iterator hint, K &&k,
+                                              M &&obj) {
+    auto res = try_emplace_(hint, std::forward<K>(k), std::forward<M>(obj));
+    if (!res.second) res.first->second = std::forward<M>(obj);
+    return res;
+  }
+
+  template <class K>
+  size_type erase_(const K &x) {
+    const hash_key_t<K> &key = x;
+    auto s = find_key_(key, hash_(key));
+    if (s == table_type::npos) return 0;
+    auto it = d_table[s].d_it;
+    d_table.erase(s);
+    d_map.erase(it);
+    return 1;
+  }
+
+  Hash d_hash;
+  KeyEqual d_equal;
+  map_type d_map;
+  table_type d_table;
+};
+
+template <class Key, class T, class Hash, class KeyEqual, class Compare,
+          class Alloc>
+bool operator==(
+    const indexed_map<Key, T, Hash, KeyEqual, Compare, Alloc> &lhs,
+    const indexed_map<Key, T, Hash, KeyEqual, Compare, Alloc> &rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  auto eq = lhs.key_eq();
+  auto it = rhs.begin();
+  for (const auto &e : lhs) {
+    if (!eq(e.first, it->first) || !(e.second == it->second)) return false;
+    ++it;
+  }
+  return true;
+}
+
+template <class Key, class T, class Hash, class KeyEqual, class Compare,
+          class Alloc>
+bool operator!=(
+    const indexed_map<Key, T, Hash, KeyEqual, Compare, Alloc> &lhs,
+    const indexed_map<Key, T, Hash, KeyEqual, Compare, Alloc> &rhs) {
+  return !(lhs == rhs);
+}
+}  // namespace wijagels
@@ -9,8 +9,21 @@
 #include <utility>
 
 namespace wijagels {
+/* Defined in FrozenSet.hpp, see freeze() there */
+template <typename T, class Compare>
+class frozen_set;
+
+/*
+ * Container is the ordered set the pairs live in, skiplist by default or
+ * block_skiplist for denser nodes. The map keeps its container's
+ * invalidation rules: over skiplist, references and iterators stay valid
+ * until their own element is erased, as with std::map. Over block_skiplist,
+ * any insert or erase invalidates every iterator, pointer and reference into
+ * the map, including the ones returned by operator[], try_emplace and find.
+ */
 template <class Key, class T, class Compare = std::less<Key>,
-          class Allocator = std::allocator<std::pair<const Key, T>>>
+          class Allocator = std::allocator<std::pair<const Key, T>>,
+          template <class, class, class, class...> class Container = skiplist>
 class map {
  public:
   /* Aliases */
@@ -24,7 +37,11 @@ class map {
   using reference = value_type &;
   using const_reference = const value_type &;
   using pointer = typename std::allocator_traits<allocator_type>::pointer;
-  /* Comparison functor for value_type */
+  /*
+   * Comparison functor for value_type. It is always transparent to the
+   * container, map itself converts lookup keys to key_type first unless
+   * Compare is transparent too.
+   */
   class value_compare {
    protected:
     friend map;
@@ -32,23 +49,26 @@ class map {
     Compare d_comp;
 
    public:
+    using is_transparent = void;
+
     constexpr bool operator()(const value_type &lhs,
                               const value_type &rhs) const {
       return d_comp(lhs.first, rhs.first);
     }
-    constexpr bool operator()(const key_type &lhs,
-                              const value_type &rhs) const {
+    template <class K>
+    constexpr bool operator()(const K &lhs, const value_type &rhs) const {
       return d_comp(lhs, rhs.first);
     }
-    constexpr bool operator()(const value_type &lhs,
-                              const key_type &rhs) const {
+    template <class K>
+    constexpr bool operator()(const value_type &lhs, const K &rhs) const {
       return d_comp(lhs.first, rhs);
     }
     constexpr bool operator()(const key_type &lhs, const key_type &rhs) const {
       return d_comp(lhs, rhs);
     }
   };
-  using container_type = skiplist<value_type, value_compare, allocator_type>;
+  using container_type = Container<value_type, value_compare, allocator_type>;
+  using level_policy = typename container_type::level_policy;
   using iterator = typename container_type::iterator;
   using const_iterator = typename container_type::const_iterator;
   using reverse_iterator = typename container_type::reverse_iterator;
@@ -57,9 +77,27 @@ class map {
   using ReverseIterator = reverse_iterator;
   using const_reverse_iterator =
       typename container_type::const_reverse_iterator;
+  using frozen_type = frozen_set<value_type, value_compare>;
   struct node_type;
   using insert_return_type = detail::InsertReturnType<iterator, node_type>;
 
+ private:
+  template <class K>
+  using lookup_key_t = detail::lookup_key_t<Compare, K, Key>;
+
+  /* What find_batch has the container convert each key to */
+  template <class ForwardIt>
+  using batch_key_t =
+      lookup_key_t<typename std::iterator_traits<ForwardIt>::value_type>;
+
+  /* Key overloads that would otherwise catch iterators stay out of the way */
+  template <class K>
+  using transparent_key_t =
+      std::enable_if_t<detail::is_transparent<Compare>::value &&
+                       !std::is_convertible_v<const K &, const_iterator>>;
+
+ public:
+
   struct node_type : public container_type::node_type {
     using key_type = const Key;
     using mapped_type = T;
@@ -92,8 +130,14 @@ class map {
   /* Constructors */
   map() : map{Compare()} {}
 
-  explicit map(const Compare &comp, const Allocator &alloc = Allocator{})
-      : d_comp{comp}, d_val_comp{comp}, d_container{d_val_comp, alloc} {}
+  /*
+   * levels seeds the container's tower heights, copies carry it along
+   */
+  explicit map(const Compare &comp, const Allocator &alloc = Allocator{},
+               const level_policy &levels = level_policy{})
+      : d_comp{comp},
+        d_val_comp{comp},
+        d_container{d_val_comp, alloc, levels} {}
 
   explicit map(const Allocator &alloc) : map{Compare{}, alloc} {}
 
@@ -162,10 +206,13 @@ class map {
     d_val_comp = std::move(other.d_val_comp);
     d_comp = std::move(other.d_comp);
     d_container = std::move(other.d_container);
+    return *this;
   }
 
   map &operator=(std::initializer_list<value_type> ilist) {
-    d_container = ilist;
+    clear();
+    insert(ilist);
+    return *this;
   }
 
   /* Allocator */
@@ -184,16 +231,10 @@ class map {
     return it->second;
   }
 
-  T &operator[](const Key &key) {
-    auto it = d_container.find(key);
-    if (it != d_container.end()) return it->second;
-    return d_container.emplace(key, mapped_type{}).first->second;
-  }
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
 
   T &operator[](Key &&key) {
-    auto it = d_container.find(key);
-    if (it != d_container.end()) return it->second;
-    return d_container.emplace(std::move(key), mapped_type{}).first->second;
+    return try_emplace(std::move(key)).first->second;
   }
 
   /* Iterators */
@@ -240,11 +281,11 @@ class map {
 
   template <class InputIt>
   void insert(InputIt first, InputIt last) {
-    while (first != last) insert(*first++);
+    d_container.insert(first, last);
   }
 
   void insert(std::initializer_list<value_type> ilist) {
-    for (auto e : ilist) insert(std::move(e));
+    d_container.insert(ilist);
   }
 
   insert_return_type insert(node_type &&nh) {
@@ -260,44 +301,27 @@ class map {
     return d_container.insert(hint, std::move(nh));
   }
 
+  /*
+   * Upserts search once, the element is only built when the key is absent
+   */
   template <class M>
   std::pair<iterator, bool> insert_or_assign(const key_type &k, M &&obj) {
-    auto iter = find(k);
-    if (iter == end()) {
-      return emplace(k, std::forward<M>(obj));
-    }
-    iter->second = std::forward<M>(obj);
-    return {iter, false};
+    return insert_or_assign_(cend(), k, std::forward<M>(obj));
   }
 
   template <class M>
   std::pair<iterator, bool> insert_or_assign(key_type &&k, M &&obj) {
-    auto iter = find(k);
-    if (iter == end()) {
-      return emplace(std::move(k), std::forward<M>(obj));
-    }
-    iter->second = std::forward<M>(obj);
-    return {iter, false};
+    return insert_or_assign_(cend(), std::move(k), std::forward<M>(obj));
   }
 
   template <class M>
   iterator insert_or_assign(const_iterator hint, const key_type &k, M &&obj) {
-    auto iter = find(k);
-    if (iter == end()) {
-      return emplace_hint(hint, k, std::forward<M>(obj));
-    }
-    iter->second = std::forward<M>(obj);
-    return iter;
+    return insert_or_assign_(hint, k, std::forward<M>(obj)).first;
   }
 
   template <class M>
   iterator insert_or_assign(const_iterator hint, key_type &&k, M &&obj) {
-    auto iter = find(k);
-    if (iter == end()) {
-      return emplace_hint(hint, std::move(k), std::forward<M>(obj));
-    }
-    iter->second = std::forward<M>(obj);
-    return iter;
+    return insert_or_assign_(hint, std::move(k), std::forward<M>(obj)).first;
   }
 
   template <class... Args>
@@ -312,41 +336,22 @@ class map {
 
   template <class... Args>
   std::pair<iterator, bool> try_emplace(const key_type &k, Args &&...args) {
-    auto it = d_container.find(k);
-    if (it != d_container.end()) return {it, false};
-    // TODO: optimize finding the spot to put the new element
-    return emplace(std::piecewise_construct, std::forward_as_tuple(k),
-                   std::forward_as_tuple(std::forward<Args>(args)...));
+    return try_emplace_(cend(), k, std::forward<Args>(args)...);
   }
 
   template <class... Args>
   std::pair<iterator, bool> try_emplace(key_type &&k, Args &&...args) {
-    auto it = d_container.find(k);
-    if (it != d_container.end()) return {it, false};
-    // TODO: optimize finding the spot to put the new element
-    return emplace(std::piecewise_construct,
-                   std::forward_as_tuple(std::move(k)),
-                   std::forward_as_tuple(std::forward<Args>(args)...));
+    return try_emplace_(cend(), std::move(k), std::forward<Args>(args)...);
   }
 
   template <class... Args>
   iterator try_emplace(const_iterator hint, const key_type &k, Args &&...args) {
-    auto it = d_container.find(k);
-    if (it != d_container.end()) return it;
-    // TODO: optimize finding the spot to put the new element
-    return emplace_hint(hint, std::piecewise_construct,
-                        std::forward_as_tuple(k),
-                        std::forward_as_tuple(std::forward<Args>(args)...));
+    return try_emplace_(hint, k, std::forward<Args>(args)...).first;
   }
 
   template <class... Args>
   iterator try_emplace(const_iterator hint, key_type &&k, Args &&...args) {
-    auto it = d_container.find(k);
-    if (it != d_container.end()) return it;
-    // TODO: optimize finding the spot to put the new element
-    return emplace_hint(hint, std::piecewise_construct,
-                        std::forward_as_tuple(std::move(k)),
-                        std::forward_as_tuple(std::forward<Args>(args)...));
+    return try_emplace_(hint, std::move(k), std::forward<Args>(args)...).first;
   }
 
   iterator erase(const_iterator pos) { return d_container.erase(pos); }
@@ -359,10 +364,16 @@ class map {
 
   size_type erase(const key_type &key) { return d_container.erase(key); }
 
-  void swap(map &other) noexcept(
-      container_type::swap(std::ref(container_type{}))) {
+  template <class K, class = transparent_key_t<K>>
+  size_type erase(const K &x) {
+    return d_container.erase(x);
+  }
+
+  void swap(map &other) noexcept(noexcept(std::declval<container_type &>().swap(
+      std::declval<container_type &>()))) {
+    std::swap(d_comp, other.d_comp);
     std::swap(d_val_comp, other.d_val_comp);
-    std::swap(d_container, other.d_container);
+    d_container.swap(other.d_container);
   }
 
   node_type extract(const_iterator position) {
@@ -375,16 +386,56 @@ class map {
     return node_type{};
   }
 
+  template <class K, class = transparent_key_t<K>>
+  node_type extract(const K &x) {
+    auto it = d_container.find(x);
+    if (it != d_container.end()) return extract(it);
+    return node_type{};
+  }
+
   template <class C2>
-  void merge(map<Key, T, C2, Allocator> &source) {
+  void merge(map<Key, T, C2, Allocator, Container> &source) {
     return merge(std::move(source));
   }
 
   template <class C2>
-  void merge(map<Key, T, C2, Allocator> &&source) {
+  void merge(map<Key, T, C2, Allocator, Container> &&source) {
     return d_container.merge(std::move(source.d_container));
   }
 
+  /*
+   * Move every element with a key not less than key into a new map
+   */
+  template <class K>
+  map split(const K &key) {
+    map tail{d_comp, get_allocator()};
+    tail.d_container =
+        d_container.split(static_cast<const lookup_key_t<K> &>(key));
+    return tail;
+  }
+
+  /*
+   * Append a map whose keys all sort before or after ours, leaving other
+   * empty
+   */
+  void join(map &other) { d_container.join(other.d_container); }
+
+  void join(map &&other) { d_container.join(other.d_container); }
+
+  /*
+   * Set algebra by key in O(size() + other.size()), elements already in
+   * this map keep their mapped values
+   */
+  void set_union(const map &other) { d_container.set_union(other.d_container); }
+
+  void set_intersection(const map &other) {
+    d_container.set_intersection(other.d_container);
+  }
+
+  void set_difference(const map &other) {
+    d_container.set_difference(other.d_container);
+  }
+
   /* Lookup */
 
   template <class K>
@@ -395,58 +446,76 @@ class map {
 
   template <class K>
   iterator find(const K &x) {
-    return d_container.find(x);
+    return d_container.find(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   const_iterator find(const K &x) const {
-    return d_container.find(x);
+    return d_container.find(static_cast<const lookup_key_t<K> &>(x));
+  }
+
+  /*
+   * Find every key in [first, last), writing the iterators to out in input
+   * order, with the searches interleaved
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    return d_container.template find_batch<batch_key_t<ForwardIt>>(first, last,
+                                                                   out);
+  }
+
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    return d_container.template find_batch<batch_key_t<ForwardIt>>(first, last,
+                                                                   out);
   }
 
   template <class K>
   std::pair<iterator, iterator> equal_range(const K &x) {
-    auto it = find(x);
-    if (it != end()) {
-      auto next = it;
-      ++next;
-      return {it, next};
-    }
-    return {it, it};
+    return d_container.equal_range(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   std::pair<const_iterator, const_iterator> equal_range(const K &x) const {
-    auto lower = find(x);
-    if (lower != end()) {
-      auto upper = lower;
-      ++upper;
-      return {lower, upper};
-    }
-    return {lower, lower};
+    return d_container.equal_range(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   iterator lower_bound(const K &x) {
-    return find(x);
+    return d_container.lower_bound(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   const_iterator lower_bound(const K &x) const {
-    return find(x);
+    return d_container.lower_bound(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   iterator upper_bound(const K &x) {
-    auto it = find(x);
-    if (it != end()) return ++it;
-    return it;
+    return d_container.upper_bound(static_cast<const lookup_key_t<K> &>(x));
   }
 
   template <class K>
   const_iterator upper_bound(const K &x) const {
-    auto it = find(x);
-    if (it != end()) return ++it;
-    return it;
+    return d_container.upper_bound(static_cast<const lookup_key_t<K> &>(x));
+  }
+
+  /* Indexing */
+
+  iterator nth(size_type n) { return d_container.nth(n); }
+
+  const_iterator nth(size_type n) const { return d_container.nth(n); }
+
+  template <class K>
+  size_type rank(const K &x) const {
+    return d_container.rank(static_cast<const lookup_key_t<K> &>(x));
+  }
+
+  /*
+   * Shape and memory use of the underlying list, see skiplist::stats()
+   */
+  skiplist_stats stats(size_type samples = 64) const {
+    return d_container.stats(samples);
   }
 
   /* Observers */
@@ -456,14 +525,38 @@ class map {
   value_compare value_comp() const { return d_val_comp; }
 
  private:
+  /*
+   * k is only moved from, into the new element, once the search has missed
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_(const_iterator hint, K &&k,
+                                         Args &&...args) {
+    const key_type &key = k;
+    return d_container.lazy_emplace(
+        hint, key, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<K>(k)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_(const_iterator hint, K &&k,
+                                              M &&obj) {
+    const key_type &key = k;
+    auto ret = d_container.lazy_emplace(hint, key, std::forward<K>(k),
+                                        std::forward<M>(obj));
+    if (!ret.second) ret.first->second = std::forward<M>(obj);
+    return ret;
+  }
+
   key_compare d_comp;
   value_compare d_val_comp;
   container_type d_container;
 };
 
-template <class Key, class T, class Compare, class Alloc>
-bool operator==(const map<Key, T, Compare, Alloc> &lhs,
-                const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator==(const map<Key, T, Compare, Alloc, C> &lhs,
+                const map<Key, T, Compare, Alloc, C> &rhs) {
   auto cmp = lhs.value_comp();
   auto first1 = lhs.begin();
   auto last1 = lhs.end();
@@ -479,15 +572,17 @@ bool operator==(const map<Key, T, Compare, Alloc> &lhs,
   return (first1 == last1) && (first2 == last2);
 }
 
-template <class Key, class T, class Compare, class Alloc>
-bool operator!=(const map<Key, T, Compare, Alloc> &lhs,
-                const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator!=(const map<Key, T, Compare, Alloc, C> &lhs,
+                const map<Key, T, Compare, Alloc, C> &rhs) {
   return !(lhs == rhs);
 }
 
-template <class Key, class T, class Compare, class Alloc>
-bool operator<(const map<Key, T, Compare, Alloc> &lhs,
-               const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator<(const map<Key, T, Compare, Alloc, C> &lhs,
+               const map<Key, T, Compare, Alloc, C> &rhs) {
   auto cmp = lhs.value_comp();
   auto first1 = lhs.begin();
   auto last1 = lhs.end();
@@ -502,20 +597,23 @@ bool operator<(const map<Key, T, Compare, Alloc> &lhs,
   return (first1 == last1) && (first2 != last2);
 }
 
-template <class Key, class T, class Compare, class Alloc>
-bool operator<=(const map<Key, T, Compare, Alloc> &lhs,
-                const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator<=(const map<Key, T, Compare, Alloc, C> &lhs,
+                const map<Key, T, Compare, Alloc, C> &rhs) {
   return (lhs < rhs) || (lhs == rhs);
 }
 
-template <class Key, class T, class Compare, class Alloc>
-bool operator>(const map<Key, T, Compare, Alloc> &lhs,
-               const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator>(const map<Key, T, Compare, Alloc, C> &lhs,
+               const map<Key, T, Compare, Alloc, C> &rhs) {
   return rhs < lhs;
 }
-template <class Key, class T, class Compare, class Alloc>
-bool operator>=(const map<Key, T, Compare, Alloc> &lhs,
-                const map<Key, T, Compare, Alloc> &rhs) {
+template <class Key, class T, class Compare, class Alloc,
+          template <class, class, class, class...> class C>
+bool operator>=(const map<Key, T, Compare, Alloc, C> &lhs,
+                const map<Key, T, Compare, Alloc, C> &rhs) {
   return rhs <= lhs;
 }
 
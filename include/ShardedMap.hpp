@@ -0,0 +1,427 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "Map.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace wijagels {
+namespace detail {
+/*
+ * Two phase read-copy-update domain for freeing data readers may still be
+ * looking at. A reader counts itself in under the current phase of one of a
+ * few cache line sized slots, synchronize() flips the phase and waits for the
+ * old phase to drain on every slot, twice, so anything unpublished before the
+ * call is unreachable once it returns. Readers never block or write shared
+ * lines other than their slot's. Calls to synchronize() must not overlap.
+ */
+class rcu_domain {
+ public:
+  static constexpr std::size_t SLOTS = 64;
+
+  class reader {
+   public:
+    explicit reader(const rcu_domain &domain) noexcept
+        : d_counter_p{&domain.enter_()} {}
+    reader(const reader &) = delete;
+    reader &operator=(const reader &) = delete;
+    ~reader() { d_counter_p->fetch_sub(1, std::memory_order_release); }
+
+   private:
+    std::atomic<std::size_t> *d_counter_p;
+  };
+
+  void synchronize() const noexcept {
+    // A reader may have loaded the phase just before the first flip and
+    // counted itself in after it, the second flip waits that one out
+    for (int flip = 0; flip < 2; flip++) {
+      auto old = d_phase.fetch_xor(1);
+      for (auto &slot : d_slots) {
+        while (slot.d_readers[old].load()) std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  struct alignas(64) slot {
+    std::atomic<std::size_t> d_readers[2]{{0}, {0}};
+  };
+
+  std::atomic<std::size_t> &enter_() const noexcept {
+    static std::atomic<std::size_t> s_next{0};
+    thread_local std::size_t t_slot = s_next.fetch_add(1) % SLOTS;
+    auto &counter = d_slots[t_slot].d_readers[d_phase.load()];
+    counter.fetch_add(1);
+    return counter;
+  }
+
+  mutable slot d_slots[SLOTS];
+  mutable std::atomic<unsigned> d_phase{0};
+};
+}  // namespace detail
+
+/*
+ * Thread safe ordered map made of a fixed number of maps, each owning a
+ * contiguous key range behind its own reader-writer lock.
+ * The ranges are an immutable snapshot behind an atomic pointer, so routing
+ * an operation to its shard takes no lock at all, and writers to different
+ * shards never contend. A shard that grows past twice its fair share hands
+ * half the difference over to its smaller neighbour, locking only those two
+ * shards, and publishes new ranges; the old ones are freed once no reader
+ * can still be using them.
+ * Lookups hand out copies or run a callback under the shard lock, there are
+ * no iterators since they could not outlive the lock.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>>
+class sharded_map {
+ public:
+  /* Aliases */
+  using map_type = map<Key, T, Compare, Allocator>;
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = typename map_type::value_type;
+  using size_type = typename map_type::size_type;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+
+  /* Shards are never split below this many elements */
+  static constexpr size_type MIN_SHARD_SIZE = 1024;
+
+ private:
+  /*
+   * Shard i holds the keys in [d_bounds[i - 1], d_bounds[i]), shards past
+   * d_bounds.size() are empty. Never modified once published, every change
+   * publishes a copy with the next version.
+   */
+  struct layout {
+    std::vector<Key> d_bounds;
+    std::uint64_t d_version = 0;
+  };
+
+  struct alignas(64) shard {
+    shard(const Compare &comp, const Allocator &alloc) : d_map{comp, alloc} {}
+
+    mutable std::shared_mutex d_mutex;
+    map_type d_map;
+    /* Version of the last layout that moved this shard's range */
+    std::uint64_t d_version = 0;
+    /* Size at which the next writer checks whether to rebalance */
+    size_type d_limit = MIN_SHARD_SIZE;
+    /* d_map.size(), readable without the lock */
+    std::atomic<size_type> d_count{0};
+  };
+
+  using read_lock = std::shared_lock<std::shared_mutex>;
+  using write_lock = std::unique_lock<std::shared_mutex>;
+
+  template <class K>
+  size_type shard_for_(const layout &l, const K &key) const {
+    auto it = std::upper_bound(
+        l.d_bounds.begin(), l.d_bounds.end(), key,
+        [this](const K &lhs, const Key &rhs) { return d_comp(lhs, rhs); });
+    return static_cast<size_type>(it - l.d_bounds.begin());
+  }
+
+  /*
+   * Run f(shard, index) on the shard owning key under a Lock of it. The
+   * layout snapshot may be stale by the time the lock is held, which only
+   * matters if a later layout moved this shard's range, then look again.
+   */
+  template <class Lock, class K, class F>
+  decltype(auto) with_shard_(const K &key, F &&f) const {
+    for (;;) {
+      std::uint64_t version;
+      size_type index;
+      {
+        detail::rcu_domain::reader guard{d_rcu};
+        auto snapshot = d_layout.load();
+        version = snapshot->d_version;
+        index = shard_for_(*snapshot, key);
+      }
+      auto &s = *d_shards[index];
+      Lock lock{s.d_mutex};
+      if (s.d_version > version) continue;
+      return f(s, index);
+    }
+  }
+
+  size_type split_threshold_(size_type total) const noexcept {
+    return std::max(MIN_SHARD_SIZE, 2 * total / d_shards.size());
+  }
+
+  /*
+   * Record a write to a shard held exclusively, returns its index if it has
+   * outgrown its limit and should be rebalanced once unlocked
+   */
+  static std::optional<size_type> wrote_(shard &s, size_type index) noexcept {
+    s.d_count.store(s.d_map.size(), std::memory_order_relaxed);
+    if (s.d_map.size() > s.d_limit) return index;
+    return std::nullopt;
+  }
+
+  /*
+   * Hand everything in shard from past its fair share over to the adjacent
+   * shard to by splitting and joining their maps, then publish the moved
+   * bound. Only these two shards are locked. Returns the layout replaced, or
+   * null if from was already down to its share.
+   */
+  const layout *shift_(size_type from, size_type to, size_type fair,
+                       size_type threshold) {
+    auto &src = *d_shards[from];
+    auto &dest = *d_shards[to];
+    write_lock first{d_shards[std::min(from, to)]->d_mutex};
+    write_lock second{d_shards[std::max(from, to)]->d_mutex};
+    auto have = src.d_map.size();
+    if (have <= fair) return nullptr;
+    auto old = d_layout.load();
+    auto next = std::make_unique<layout>(*old);
+    next->d_version = old->d_version + 1;
+    if (to > from) {
+      auto at = src.d_map.nth(fair)->first;
+      if (from == next->d_bounds.size()) {
+        next->d_bounds.push_back(at);
+      } else {
+        next->d_bounds[from] = at;
+      }
+      dest.d_map.join(src.d_map.split(at));
+    } else {
+      auto at = src.d_map.nth(have - fair)->first;
+      next->d_bounds[to] = at;
+      auto rest = src.d_map.split(at);
+      dest.d_map.join(src.d_map);
+      src.d_map.swap(rest);
+    }
+    for (auto s : {&src, &dest}) {
+      s->d_version = next->d_version;
+      s->d_limit = threshold;
+      s->d_count.store(s->d_map.size(), std::memory_order_relaxed);
+    }
+    d_layout.store(next.release());
+    return old;
+  }
+
+  /*
+   * Bring an overgrown shard back to its fair share. The excess moves one
+   * shard at a time towards the less loaded side, each hop leaving the
+   * sender with its share, until it reaches a shard with room for it. Every
+   * hop is a split and a join, so a rebalance costs O(log n) per shard it
+   * passes through whatever the number of elements moved.
+   */
+  void rebalance_(size_type index) {
+    write_lock moving{d_moving};
+    auto total = size();
+    auto threshold = split_threshold_(total);
+    auto shards = d_shards.size();
+    {
+      write_lock lock{d_shards[index]->d_mutex};
+      if (shards == 1 || d_shards[index]->d_map.size() <= threshold) {
+        d_shards[index]->d_limit = threshold;  // Somebody beat us to it
+        return;
+      }
+    }
+    size_type left = 0;
+    size_type right = 0;
+    for (size_type i = 0; i < shards; i++) {
+      auto count = d_shards[i]->d_count.load(std::memory_order_relaxed);
+      if (i < index) left += count;
+      if (i > index) right += count;
+    }
+    // Towards the side with the lower average
+    bool rightward =
+        index == 0 ||
+        (index + 1 < shards && right * index < left * (shards - 1 - index));
+    auto fair = std::max<size_type>(total / shards, 1);
+    std::vector<std::unique_ptr<const layout>> retired;
+    retired.reserve(shards);
+    try {
+      for (auto from = index;;) {
+        auto to = rightward ? from + 1 : from - 1;
+        auto old = shift_(from, to, fair, threshold);
+        if (!old) break;
+        retired.emplace_back(old);
+        if (to == 0 || to + 1 == shards) break;
+        from = to;
+      }
+    } catch (...) {
+      d_rcu.synchronize();
+      throw;
+    }
+    if (!retired.empty()) d_rcu.synchronize();
+  }
+
+ public:
+  /* Constructors */
+  sharded_map()
+      : sharded_map{std::max(1u, std::thread::hardware_concurrency())} {}
+
+  explicit sharded_map(size_type shards, const Compare &comp = Compare{},
+                       const Allocator &alloc = Allocator{})
+      : d_comp{comp} {
+    d_shards.reserve(std::max(size_type{1}, shards));
+    for (size_type i = 0; i < std::max(size_type{1}, shards); i++) {
+      d_shards.push_back(std::make_unique<shard>(comp, alloc));
+    }
+    d_layout.store(new layout{});
+  }
+
+  sharded_map(const sharded_map &) = delete;
+  sharded_map &operator=(const sharded_map &) = delete;
+
+  ~sharded_map() { delete d_layout.load(); }
+
+  /* Capacity */
+  bool empty() const noexcept { return size() == 0; }
+
+  size_type size() const noexcept {
+    size_type total = 0;
+    for (auto &s : d_shards) {
+      total += s->d_count.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  size_type shard_count() const noexcept { return d_shards.size(); }
+
+  /* Modifiers */
+  /*
+   * Empties every shard at once, the ranges stay as they are
+   */
+  void clear() {
+    write_lock moving{d_moving};
+    std::vector<write_lock> locks;
+    locks.reserve(d_shards.size());
+    for (auto &s : d_shards) locks.emplace_back(s->d_mutex);
+    for (auto &s : d_shards) {
+      s->d_map.clear();
+      s->d_limit = MIN_SHARD_SIZE;
+      s->d_count.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  bool insert(const value_type &value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  bool insert(value_type &&value) {
+    return try_emplace(value.first, std::move(value.second));
+  }
+
+  template <class... Args>
+  bool try_emplace(const key_type &k, Args &&...args) {
+    auto [inserted, grown] =
+        with_shard_<write_lock>(k, [&](shard &s, size_type index) {
+          auto res = s.d_map.try_emplace(k, std::forward<Args>(args)...);
+          return std::make_pair(res.second, wrote_(s, index));
+        });
+    if (grown) rebalance_(*grown);
+    return inserted;
+  }
+
+  /*
+   * Returns true if the element was inserted, false if it was assigned
+   */
+  template <class M>
+  bool insert_or_assign(const key_type &k, M &&obj) {
+    auto [inserted, grown] =
+        with_shard_<write_lock>(k, [&](shard &s, size_type index) {
+          auto res = s.d_map.insert_or_assign(k, std::forward<M>(obj));
+          return std::make_pair(res.second, wrote_(s, index));
+        });
+    if (grown) rebalance_(*grown);
+    return inserted;
+  }
+
+  template <class K>
+  size_type erase(const K &key) {
+    return with_shard_<write_lock>(key, [&](shard &s, size_type index) {
+      auto erased = s.d_map.erase(key);
+      wrote_(s, index);
+      return erased;
+    });
+  }
+
+  /* Lookup */
+  template <class K>
+  bool contains(const K &key) const {
+    return with_shard_<read_lock>(key, [&](const shard &s, size_type) {
+      return s.d_map.find(key) != s.d_map.end();
+    });
+  }
+
+  template <class K>
+  size_type count(const K &key) const {
+    return contains(key);
+  }
+
+  template <class K>
+  std::optional<mapped_type> find(const K &key) const {
+    return with_shard_<read_lock>(
+        key, [&](const shard &s, size_type) -> std::optional<mapped_type> {
+          auto it = s.d_map.find(key);
+          if (it == s.d_map.end()) return std::nullopt;
+          return it->second;
+        });
+  }
+
+  /*
+   * Call f with the element while holding its shard exclusively.
+   * Returns false if key is not present.
+   */
+  template <class K, class F>
+  bool visit(const K &key, F &&f) {
+    return with_shard_<write_lock>(key, [&](shard &s, size_type) {
+      auto it = s.d_map.find(key);
+      if (it == s.d_map.end()) return false;
+      f(*it);
+      return true;
+    });
+  }
+
+  template <class K, class F>
+  bool visit(const K &key, F &&f) const {
+    return with_shard_<read_lock>(key, [&](const shard &s, size_type) {
+      auto it = s.d_map.find(key);
+      if (it == s.d_map.end()) return false;
+      f(*it);
+      return true;
+    });
+  }
+
+  /*
+   * Visit every element in key order.
+   * Each shard is read under its own lock, so the walk is consistent per
+   * shard but may observe writes to shards it has not reached yet. No
+   * elements move between shards while it runs.
+   */
+  template <class F>
+  void for_each(F &&f) const {
+    read_lock moving{d_moving};
+    for (auto &s : d_shards) {
+      read_lock lock{s->d_mutex};
+      for (auto &e : s->d_map) f(e);
+    }
+  }
+
+  /* Observers */
+  key_compare key_comp() const { return d_comp; }
+
+ private:
+  key_compare d_comp;
+  std::vector<std::unique_ptr<shard>> d_shards;
+  /* Held by rebalances and clear exclusively, by for_each shared */
+  mutable std::shared_mutex d_moving;
+  detail::rcu_domain d_rcu;
+  std::atomic<const layout *> d_layout{nullptr};
+};
+
+}  // namespace wijagels
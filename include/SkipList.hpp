@@ -1,15 +1,20 @@
 // Copyright 2017 William Jagels
 #pragma once
-
-#include <boost/container/small_vector.hpp>
+#include "Traits.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <iterator>
 #include <memory>
-#include <random>
-#include <stack>
+#include <new>
+#include <optional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace wijagels {
 namespace detail {
@@ -19,69 +24,303 @@ struct InsertReturnType {
   bool inserted;
   NodeType node;
 };
+
+/*
+ * Allocators that declare is_monotonic never reclaim single deallocations,
+ * their memory goes away all at once with the allocator
+ */
+template <class Alloc, class = void>
+struct is_monotonic : std::false_type {};
+
+template <class Alloc>
+struct is_monotonic<Alloc, std::void_t<typename Alloc::is_monotonic>>
+    : Alloc::is_monotonic {};
+
+/*
+ * Monotonic allocators may free their memory in place through
+ * release_unshared(held), when the held copies are its only users
+ */
+template <class Alloc>
+auto release_unshared(const Alloc &alloc, long held, int) noexcept
+    -> decltype(alloc.release_unshared(held)) {
+  return alloc.release_unshared(held);
+}
+
+template <class Alloc>
+bool release_unshared(const Alloc &, long, long) noexcept {
+  return false;
+}
 }  // namespace detail
 
+/*
+ * Link policies for skiplist. Level 0 is always doubly linked so iterators
+ * stay bidirectional, the policy decides whether the upper levels keep back
+ * pointers too.
+ */
+struct bidirectional_links {
+  static constexpr bool upper_prev = true;
+};
+
+/*
+ * Upper levels are singly linked, which makes towers a third smaller and
+ * saves the back link stores on insert and erase. Updates find their
+ * predecessors with a search from the sentinel instead of walking back.
+ */
+struct forward_links {
+  static constexpr bool upper_prev = false;
+};
+
+/*
+ * Default level policy for skiplist. A node gets one level plus one more for
+ * every Shift trailing zero bits of a xorshift64* word, so each level holds
+ * 1 / 2^Shift of the level below: p = 1/2 for Shift 1, p = 1/4 for Shift 2.
+ * Levels are capped at MaxLevel, and the generator starts from a fixed seed so
+ * the same operations always build the same list. Pass a seeded instance to
+ * the skiplist constructor for a different, still reproducible, shape.
+ */
+template <unsigned Shift = 1, size_t MaxLevel = 32>
+class geometric_levels {
+  static_assert(Shift > 0 && Shift < 32, "p must be 1/2^Shift");
+
+ public:
+  static constexpr size_t max_level = MaxLevel;
+  static constexpr uint64_t default_seed = 0x9e3779b97f4a7c15;
+  /* Chance that a node reaches the next level up */
+  static constexpr double probability = 1.0 / (1U << Shift);
+
+  explicit geometric_levels(uint64_t seed = default_seed) noexcept
+      : d_state{seed ? seed : default_seed} {}
+
+  size_t operator()() noexcept {
+    d_state ^= d_state >> 12;
+    d_state ^= d_state << 25;
+    d_state ^= d_state >> 27;
+    // The high half of the product is the well mixed one
+    auto word = static_cast<uint32_t>((d_state * 0x2545f4914f6cdd1d) >> 32);
+    auto zeros = static_cast<size_t>(__builtin_ctz(word | (1U << 31)));
+    return std::min(zeros / Shift + 1, MaxLevel);
+  }
+
+ private:
+  uint64_t d_state;
+};
+
+namespace detail {
+/*
+ * 1 / p of a level policy, how many nodes of a level there are for each node
+ * of the level above. Policies that do not give a probability count as 1/2.
+ */
+template <class Levels, class = void>
+struct level_fanout : std::integral_constant<size_t, 2> {};
+
+template <class Levels>
+struct level_fanout<Levels, std::void_t<decltype(Levels::probability)>>
+    : std::integral_constant<size_t, static_cast<size_t>(
+                                         1 / Levels::probability + 0.5)> {};
+}  // namespace detail
+
+/*
+ * Prefetch policies for skiplist searches.
+ * While a search compares against the node to its right, the node one level
+ * down, which is where it goes next if it descends, is fetched in the
+ * background so the two misses overlap. Lines is how many cache lines of that
+ * node to fetch, raise it for elements that span several.
+ */
+struct no_prefetch {
+  static constexpr size_t lines = 0;
+};
+
+template <size_t Lines = 1>
+struct prefetch_nodes {
+  static_assert(Lines > 0, "use no_prefetch to turn prefetching off");
+  static constexpr size_t lines = Lines;
+};
+
+/*
+ * Shape and memory footprint of a skiplist, as reported by stats()
+ */
+struct skiplist_stats {
+  size_t size = 0;
+  /* Number of nodes with exactly i + 1 levels at index i */
+  std::vector<size_t> level_histogram;
+  /* Tallest tower in the list */
+  size_t max_level = 0;
+  /* Height a list of this size should top out at, log base 1/p of size */
+  double ideal_level = 0;
+  /* Nodes compared against by a find, over the sampled elements */
+  double mean_search_path = 0;
+  size_t max_search_path = 0;
+  /* Node allocations including their towers and alignment padding */
+  size_t node_bytes = 0;
+  /* node_bytes plus the list object itself, which holds the sentinel */
+  size_t total_bytes = 0;
+  double bytes_per_element = 0;
+};
+
 template <typename T, class Compare = std::less<T>,
-          class Allocator = std::allocator<T>>
+          class Allocator = std::allocator<T>,
+          class Links = bidirectional_links,
+          class Levels = geometric_levels<>, class Prefetch = no_prefetch>
 class skiplist {
+  template <typename, class, class, class, class, class>
+  friend class skiplist;
+
+ public:
+  /*
+   * Towers are capped so the sentinel can hold every level inline
+   */
+  static constexpr size_t MAX_LEVEL = 32;
+  static_assert(Levels::max_level <= MAX_LEVEL,
+                "the sentinel holds at most MAX_LEVEL levels");
+
+ private:
+  struct skip_node_base;
   struct skip_node;
+  /*
+   * A link at one of the upper levels of a tower. width is the number of
+   * level 0 hops that following next skips over, which makes the list
+   * indexable.
+   */
+  struct skip_link_bidirectional {
+    skip_node_base *prev;
+    skip_node_base *next;
+    size_t width;
+  };
+
+  struct skip_link_forward {
+    skip_node_base *next;
+    size_t width;
+  };
+
+  using skip_link = std::conditional_t<Links::upper_prev,
+                                       skip_link_bidirectional,
+                                       skip_link_forward>;
+
+  /*
+   * Level 0 is linked through the node itself. The upper levels are stored
+   * directly below it in the same allocation, level i at this - i, so a node
+   * only pays for the levels it actually has.
+   */
   struct skip_node_base {
-    skip_node_base() = default;
-    explicit skip_node_base(size_t level)
-        : d_skips{level, std::make_pair(static_cast<skip_node *>(this),
-                                        static_cast<skip_node *>(this))} {}
-    size_t links() const noexcept { return d_skips.size(); }
+    explicit skip_node_base(size_t level, bool sentinel = false) noexcept
+        : d_prev{this},
+          d_next{this},
+          d_level{static_cast<uint8_t>(level)},
+          d_sentinel{sentinel} {}
 
-    void expand(size_t size) {
-      if (links() < size) {
-        d_skips.resize(size, std::make_pair(static_cast<skip_node *>(this),
-                                            static_cast<skip_node *>(this)));
-      }
+    skip_node_base(const skip_node_base &) = delete;
+    skip_node_base &operator=(const skip_node_base &) = delete;
+
+    size_t links() const noexcept { return d_level; }
+
+    skip_link &upper(size_t level) noexcept {
+      assert(level > 0);
+      return *std::launder(reinterpret_cast<skip_link *>(this) - level);
     }
 
-    boost::container::small_vector<std::pair<skip_node *, skip_node *>, 4>
-        d_skips;
-  };
+    const skip_link &upper(size_t level) const noexcept {
+      assert(level > 0);
+      return *std::launder(reinterpret_cast<const skip_link *>(this) - level);
+    }
 
-  struct skip_node : skip_node_base {
-    explicit skip_node(size_t level) : skip_node_base{level} {}
+    skip_node_base *&next(size_t level) noexcept {
+      return level ? upper(level).next : d_next;
+    }
 
-    template <typename... Args>
-    explicit skip_node(size_t level, Args &&...args)
-        : skip_node_base{level}, d_data{std::forward<Args>(args)...} {}
+    skip_node_base *next(size_t level) const noexcept {
+      return level ? upper(level).next : d_next;
+    }
 
-    skip_node(const skip_node &other) = default;
+    skip_node_base *&prev(size_t level) noexcept {
+      if constexpr (Links::upper_prev) {
+        return level ? upper(level).prev : d_prev;
+      } else {
+        assert(level == 0);
+        return d_prev;
+      }
+    }
 
-    skip_node(skip_node &&other) noexcept
-        : skip_node_base::d_skips{std::move(other.d_skips)},
-          d_data{std::move(other.d_data)} {
-      other.d_skips = {std::make_pair(&other, &other)};
+    skip_node_base *prev(size_t level) const noexcept {
+      return const_cast<skip_node_base *>(this)->prev(level);  // NOLINT
     }
 
-    ~skip_node() = default;
+    size_t width(size_t level) const noexcept {
+      return level ? upper(level).width : 1;
+    }
 
-    skip_node &operator=(const skip_node &other) = default;
+    /*
+     * Grow the sentinel's tower to size levels, new levels are self links
+     * spanning width
+     */
+    void expand(size_t size, size_t width) noexcept {
+      for (; d_level < size; ++d_level) {
+        if constexpr (Links::upper_prev) {
+          upper(d_level) = skip_link{this, this, width};
+        } else {
+          upper(d_level) = skip_link{this, width};
+        }
+      }
+    }
 
-    skip_node &operator=(skip_node &&other) noexcept {
-      if (&other == this) return *this;
-      this->d_skips = std::move(other.d_skips);
-      other.d_skips = {std::make_pair(&other, &other)};
-      return *this;
+    /*
+     * Number of elements from here to the end of the list.
+     * Climbs forward along the tallest link of each node, which visits the
+     * same nodes as a search path in reverse.
+     */
+    size_t distance_to_end() const noexcept {
+      size_t d = 0;
+      for (auto node = this; !node->d_sentinel;) {
+        auto level = node->links() - 1;
+        d += node->width(level);
+        node = node->next(level);
+      }
+      return d;
     }
 
-    friend void swap(skip_node &lhs, skip_node &rhs) noexcept {
-      std::swap(lhs.d_skips, rhs.d_skips);
-      std::swap(lhs.d_data, rhs.d_data);
+    T &data() noexcept { return static_cast<skip_node *>(this)->d_data; }
+
+    const T &data() const noexcept {
+      return static_cast<const skip_node *>(this)->d_data;
     }
 
+    skip_node_base *d_prev;
+    skip_node_base *d_next;
+    uint8_t d_level;
+    bool d_sentinel;
+  };
+
+  struct skip_node : skip_node_base {
+    template <typename... Args>
+    explicit skip_node(size_t level, Args &&...args)
+        : skip_node_base{level}, d_data{std::forward<Args>(args)...} {}
+
     T d_data;
   };
 
+  /*
+   * The sentinel has room for every level up front
+   */
+  struct skip_head {
+    skip_link d_tower[MAX_LEVEL - 1];
+    skip_node_base d_base{1, true};
+  };
+  static_assert(offsetof(skip_head, d_base) ==
+                    sizeof(skip_link) * (MAX_LEVEL - 1),
+                "sentinel tower must sit directly below its links");
+
+  /*
+   * Nodes are allocated in units of their alignment so that the tower can sit
+   * below the node without padding out to a whole skip_node
+   */
+  struct alignas(skip_node) node_unit {
+    unsigned char d_bytes[alignof(skip_node)];
+  };
+
  public:
   class const_iterator;
   class iterator {
     friend skiplist;
-    skip_node *d_node_p;
+    skip_node_base *d_node_p;
 
    public:
     using value_type = T;
@@ -94,48 +333,49 @@ class skiplist {
         typename std::allocator_traits<Allocator>::const_pointer;
     using iterator_category = std::bidirectional_iterator_tag;
 
+    constexpr iterator() noexcept : d_node_p{nullptr} {}
+
     constexpr explicit iterator(skip_node *node) : d_node_p{node} {}
 
    private:
-    constexpr explicit iterator(skip_node_base *node)
-        : d_node_p{static_cast<skip_node *>(node)} {}
+    constexpr explicit iterator(skip_node_base *node) : d_node_p{node} {}
     constexpr explicit iterator(const const_iterator &other)
         : iterator{other.un_const()} {}
 
    public:
     iterator &operator++() {
-      d_node_p = d_node_p->d_skips[0].second;
+      d_node_p = d_node_p->d_next;
       return *this;
     }
 
     iterator operator++(int) {
       iterator ret{*this};
-      d_node_p = d_node_p->d_skips[0].second;
+      d_node_p = d_node_p->d_next;
       return ret;
     }
 
     iterator &operator--() {
-      d_node_p = d_node_p->d_skips[0].first;
+      d_node_p = d_node_p->d_prev;
       return *this;
     }
 
     iterator operator--(int) {
       iterator ret{*this};
-      d_node_p = d_node_p->d_skips[0].first;
+      d_node_p = d_node_p->d_prev;
       return ret;
     }
 
     iterator next(size_t level) const {
-      return iterator{d_node_p->d_skips[level].second};
+      return iterator{d_node_p->next(level)};
     }
 
     iterator prev(size_t level) const {
-      return iterator{d_node_p->d_skips[level].first};
+      return iterator{d_node_p->prev(level)};
     }
 
-    reference operator*() const { return d_node_p->d_data; }
+    reference operator*() const { return d_node_p->data(); }
 
-    pointer operator->() const { return &d_node_p->d_data; }
+    pointer operator->() const { return &d_node_p->data(); }
 
     constexpr friend bool operator==(const iterator &lhs, const iterator &rhs) {
       return lhs.d_node_p == rhs.d_node_p;
@@ -145,18 +385,20 @@ class skiplist {
       return lhs.d_node_p != rhs.d_node_p;
     }
 
+    /*
+     * Logarithmic, both iterators must belong to the same list with lhs not
+     * after rhs
+     */
     friend difference_type distance(const iterator &lhs, const iterator &rhs) {
-      size_type d = 0;
-      auto it = lhs;
-      while (it++ != rhs) d++;
-      return d;
+      return lhs.d_node_p->distance_to_end() -
+             rhs.d_node_p->distance_to_end();
     }
   };
 
   class const_iterator {
     friend skiplist;
     friend iterator;
-    const skip_node *d_node_p;
+    const skip_node_base *d_node_p;
 
    public:
     using value_type = T;
@@ -166,39 +408,41 @@ class skiplist {
     using pointer = typename std::allocator_traits<Allocator>::const_pointer;
     using iterator_category = std::bidirectional_iterator_tag;
 
+    constexpr const_iterator() noexcept : d_node_p{nullptr} {}
+
     constexpr explicit const_iterator(const skip_node *node) : d_node_p{node} {}
 
     constexpr explicit const_iterator(const skip_node_base *node)
-        : d_node_p{static_cast<const skip_node *>(node)} {}
+        : d_node_p{node} {}
 
     constexpr const_iterator(const iterator &other)
         : d_node_p{other.d_node_p} {}
 
     const_iterator &operator++() {
-      d_node_p = d_node_p->d_skips[0].second;
+      d_node_p = d_node_p->d_next;
       return *this;
     }
 
     const_iterator operator++(int) {
       const_iterator ret{*this};
-      d_node_p = d_node_p->d_skips[0].second;
+      d_node_p = d_node_p->d_next;
       return ret;
     }
 
     const_iterator &operator--() {
-      d_node_p = d_node_p->d_skips[0].first;
+      d_node_p = d_node_p->d_prev;
       return *this;
     }
 
     const_iterator operator--(int) {
       const_iterator ret{*this};
-      d_node_p = d_node_p->d_skips[0].first;
+      d_node_p = d_node_p->d_prev;
       return ret;
     }
 
-    reference operator*() const { return d_node_p->d_data; }
+    reference operator*() const { return d_node_p->data(); }
 
-    pointer operator->() const { return &d_node_p->d_data; }
+    pointer operator->() const { return &d_node_p->data(); }
 
     constexpr friend bool operator==(const const_iterator &lhs,
                                      const const_iterator &rhs) {
@@ -212,21 +456,20 @@ class skiplist {
 
     friend difference_type distance(const const_iterator &lhs,
                                     const const_iterator &rhs) {
-      difference_type d = 0;
-      auto it = lhs;
-      while (it++ != rhs) d++;
-      return d;
+      return lhs.d_node_p->distance_to_end() -
+             rhs.d_node_p->distance_to_end();
     }
 
    private:
     constexpr iterator un_const() const {
-      return iterator{const_cast<skip_node *>(d_node_p)};  // NOLINT
+      return iterator{const_cast<skip_node_base *>(d_node_p)};  // NOLINT
     }
   };
 
   using value_type = T;
   using value_compare = Compare;
   using allocator_type = Allocator;
+  using level_policy = Levels;
   using size_type = size_t;
   using difference_type = size_t;
   using reference = value_type &;
@@ -238,8 +481,9 @@ class skiplist {
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
   using node_ptr = skip_node *;
   using insert_type = std::pair<iterator, bool>;
+  using alloc_traits = std::allocator_traits<allocator_type>;
   using node_allocator_type = typename std::allocator_traits<
-      allocator_type>::template rebind_alloc<skip_node>;
+      allocator_type>::template rebind_alloc<node_unit>;
   using node_alloc_traits = typename std::allocator_traits<node_allocator_type>;
   class node_type;
   using insert_return_type = detail::InsertReturnType<iterator, node_type>;
@@ -254,10 +498,7 @@ class skiplist {
     allocator_type d_alloc;
 
     void destroy_() {
-      if (d_node_p) {
-        std::allocator_traits<allocator_type>::destroy(d_alloc, d_node_p);
-        std::allocator_traits<allocator_type>::deallocate(d_alloc, d_node_p, 1);
-      }
+      if (d_node_p) deallocate_node_(d_alloc, d_node_p);
     }
 
     /*
@@ -319,17 +560,33 @@ class skiplist {
   };
 
  private:
-  void link_(size_t level, skip_node *first, skip_node *last) {
-    first->d_skips[level].second = last;
-    last->d_skips[level].first = first;
+  static void link_(size_t level, skip_node_base *first,
+                    skip_node_base *last) {
+    first->next(level) = last;
+    if (Links::upper_prev || level == 0) last->prev(level) = first;
   }
 
   template <typename... Args>
-  void link_(size_t level, skip_node *first, skip_node *second, Args... rest) {
+  static void link_(size_t level, skip_node_base *first,
+                    skip_node_base *second, Args... rest) {
     link_(level, first, second);
     link_(level, second, rest...);
   }
 
+  /*
+   * Start loading node and its link at level ahead of the search reaching it
+   */
+  template <size_t Lines = Prefetch::lines>
+  static void prefetch_(const skip_node_base *node, size_t level) noexcept {
+    if constexpr (Lines > 0) {
+      auto bytes = reinterpret_cast<const char *>(node);
+      for (size_t i = 0; i < Lines; i++) {
+        __builtin_prefetch(bytes + i * 64);
+      }
+      if (level > 0) __builtin_prefetch(&node->upper(level));
+    }
+  }
+
   /*
    * Return an iterator directly after the location where some data should be
    * inserted.
@@ -343,6 +600,7 @@ class skiplist {
       level = hint.d_node_p->links() - 1;
       while (level > 0) {
         auto next = hint.next(level);
+        prefetch_(hint.d_node_p->next(level - 1), level - 1);
         if (next == end() || d_comp(data, *next)) {
           --level;
         } else if (d_comp(*next, data)) {
@@ -359,6 +617,7 @@ class skiplist {
       if (hint != end() && !d_comp(data, *hint)) return {hint, false};
       return {hint, true};
     } else if (d_comp(data, *hint)) {  // Go backwards
+      if constexpr (!Links::upper_prev) return find_pos_(end(), data);
       level = hint.d_node_p->links() - 1;
       while (level > 0) {
         auto prev = hint.prev(level);
@@ -381,152 +640,746 @@ class skiplist {
     return {hint, false};
   }
 
-  /**
-   * Experimental, insert without a hint and return a stack with the nodes an
-   * inserted node should come after.
-   * Slower than the normal way
+  /*
+   * The last node before some position at every level, along with its rank
+   * (the sentinel is rank 0, elements are 1-based).
+   */
+  struct skip_path {
+    skip_node_base *d_nodes[MAX_LEVEL];
+    size_type d_ranks[MAX_LEVEL];
+  };
+
+  /*
+   * Rethreads every level of a list through nodes handed over in ascending
+   * order, recomputing widths as it goes. Nodes keep their tower heights.
+   * Used to rebuild a list in one sweep once its level 0 order is known,
+   * links are only written behind the sweep so the old level 0 chain can be
+   * read up to the node about to be pushed.
+   */
+  class relinker {
+   public:
+    explicit relinker(skip_node_base &head) noexcept : d_head{head} {
+      d_head.d_level = 1;
+      std::fill_n(d_tail.d_nodes, MAX_LEVEL, &head);
+      std::fill_n(d_tail.d_ranks, MAX_LEVEL, 0);
+    }
+
+    void push(skip_node_base *node) noexcept {
+      auto rank = ++d_size;
+      d_head.expand(node->links(), 0);
+      for (size_t i = 0; i < node->links(); i++) {
+        if (i > 0) {
+          d_tail.d_nodes[i]->upper(i).width = rank - d_tail.d_ranks[i];
+        }
+        link_(i, d_tail.d_nodes[i], node);
+        d_tail.d_nodes[i] = node;
+        d_tail.d_ranks[i] = rank;
+      }
+    }
+
+    /* Push every node from first up to the sentinel end */
+    void push_rest(skip_node_base *first, const skip_node_base *end) noexcept {
+      while (first != end) {
+        auto node = first;
+        first = first->d_next;
+        push(node);
+      }
+    }
+
+    const skip_node_base *last() const noexcept { return d_tail.d_nodes[0]; }
+
+    /* Close every level back onto the sentinel, returns the new size */
+    size_type finish() noexcept {
+      for (size_t i = 0; i < d_head.links(); i++) {
+        if (i > 0) {
+          d_tail.d_nodes[i]->upper(i).width = d_size + 1 - d_tail.d_ranks[i];
+        }
+        link_(i, d_tail.d_nodes[i], &d_head);
+      }
+      return d_size;
+    }
+
+   private:
+    skip_node_base &d_head;
+    skip_path d_tail;
+    size_type d_size = 0;
+  };
+
+  /*
+   * Search from the sentinel recording the path taken.
+   * Returns true if data is already present, it follows path.d_nodes[0].
    */
   template <class K>
-  std::pair<std::stack<iterator>, bool> find_pos_(const K &data) {
-    std::stack<iterator> history;
-    if (empty()) return {std::move(history), true};
-    auto iter = end();
-    size_t level = iter.d_node_p->links() - 1;
-    while (level > 0) {
-      auto next = iter.next(level);
-      if (next == end() || d_comp(data, *next)) {
-        history.push(iter);
-        --level;
-      } else if (d_comp(*next, data)) {
-        iter = iter.next(level);
-      } else {  // Found
-        history.push(iter);
-        return {std::move(history), false};
+  bool find_path_(const K &data, skip_path &path) {
+    auto &head = head_();
+    skip_node_base *cur = &head;
+    size_type pos = 0;
+    for (size_t level = head.links(); level-- > 0;) {
+      while (true) {
+        auto next = cur->next(level);
+        if (level > 0) prefetch_(cur->next(level - 1), level - 1);
+        if (next == &head || !d_comp(next->data(), data)) break;
+        pos += cur->width(level);
+        cur = next;
       }
+      path.d_nodes[level] = cur;
+      path.d_ranks[level] = pos;
     }
-    if (iter == end()) ++iter;
-    while (iter != end() && d_comp(*iter, data)) {
-      ++iter;
+    auto next = cur->d_next;
+    return next != &head && !d_comp(data, next->data());
+  }
+
+  /*
+   * Same as find_path_ but by position, so no comparisons are needed.
+   * With index equal to the size this finds the last node of every level.
+   */
+  static void find_path_(skip_node_base &head, size_type index,
+                         skip_path &path) noexcept {
+    skip_node_base *cur = &head;
+    size_type pos = 0;
+    for (size_t level = head.links(); level-- > 0;) {
+      while (pos + cur->width(level) <= index) {
+        pos += cur->width(level);
+        cur = cur->next(level);
+      }
+      path.d_nodes[level] = cur;
+      path.d_ranks[level] = pos;
     }
+  }
 
-    history.push(--iter);
-    ++iter;
+  /*
+   * Inserts the node directly before loc.
+   * Walks backwards from loc to find the predecessor at every level, counting
+   * how far behind the new node each one is so the widths can be fixed up.
+   */
+  void insert_node_(const iterator &loc, skip_node_base *node) {
+    auto &head = head_();
+    size_t lvl = node->links();
+    head.expand(lvl, d_size + 1);
+    auto cur = loc.d_node_p->d_prev;
+    size_type dist = 1;
+    for (size_t i = 0; i < head.links(); i++) {
+      while (cur->links() <= i) {
+        cur = cur->prev(i - 1);
+        dist += cur->width(i - 1);
+      }
+      if (i >= lvl) {
+        ++cur->upper(i).width;
+        continue;
+      }
+      if (i > 0) {
+        node->upper(i).width = cur->upper(i).width + 1 - dist;
+        cur->upper(i).width = dist;
+      }
+      link_(i, cur, node, cur->next(i));
+    }
+    ++d_size;
+  }
 
-    if (iter != end() && !d_comp(data, *iter))
-      return {std::move(history), false};
-    return {std::move(history), true};
+  /*
+   * Inserts the node after the recorded path
+   */
+  void insert_node_(skip_path &path, skip_node_base *node) {
+    auto &head = head_();
+    size_t lvl = node->links();
+    for (size_t i = head.links(); i < lvl; i++) {
+      path.d_nodes[i] = &head;
+      path.d_ranks[i] = 0;
+    }
+    head.expand(lvl, d_size + 1);
+    auto rank = path.d_ranks[0] + 1;
+    for (size_t i = 0; i < head.links(); i++) {
+      auto cur = path.d_nodes[i];
+      if (i >= lvl) {
+        ++cur->upper(i).width;
+        continue;
+      }
+      if (i > 0) {
+        auto dist = rank - path.d_ranks[i];
+        node->upper(i).width = cur->upper(i).width + 1 - dist;
+        cur->upper(i).width = dist;
+      }
+      link_(i, cur, node, cur->next(i));
+    }
+    ++d_size;
   }
 
   /*
-   * Inserts the node directly before loc
+   * Links in a node that sorts after every element at the end of the list.
+   * The last node of each level is the one the sentinel links back to, so
+   * nothing is searched: the new node takes over the width of each link into
+   * the sentinel it splits, and the links it passes under grow by one.
+   * Without back links the last nodes are found by a descent on position.
    */
-  void insert_node_(const iterator &loc, skip_node *node) {
+  void append_node_(skip_node_base *node) {
+    auto &head = head_();
     size_t lvl = node->links();
-    d_head.expand(lvl);
-    size_t level = 0;
-    auto cur = loc.prev(level);
-    for (size_t i = 0; i < lvl; i++) {
-      if (level < i) {
-        while (cur.d_node_p->links() <= i) {
-          cur = cur.prev(level);
-        }
-        ++level;
+    if constexpr (!Links::upper_prev) {
+      skip_path path;
+      find_path_(head, d_size, path);
+      return insert_node_(path, node);
+    }
+    head.expand(lvl, d_size + 1);
+    for (size_t i = 0; i < head.links(); i++) {
+      auto last = head.prev(i);
+      if (i >= lvl) {
+        ++last->upper(i).width;
+        continue;
       }
-      assert(level == i);
-      assert(i < cur.d_node_p->links());
-      link_(i, cur.d_node_p, node, cur.d_node_p->d_skips[i].second);
+      if (i > 0) node->upper(i).width = 1;
+      link_(i, last, node, &head);
     }
+    ++d_size;
   }
 
-  void insert_node_history_(skip_node *node, std::stack<iterator> history) {
+  void unlink_node_(skip_path &path, skip_node_base *node) {
+    size_t lvl = node->links();
+    for (size_t i = 0; i < head_().links(); i++) {
+      auto cur = path.d_nodes[i];
+      if (i >= lvl) {
+        --cur->upper(i).width;
+        continue;
+      }
+      assert(cur->next(i) == node);
+      if (i > 0) cur->upper(i).width += node->upper(i).width - 1;
+      link_(i, cur, node->next(i));
+    }
+    --d_size;
+  }
+
+  void unlink_node_(skip_node_base *node) {
+    if constexpr (!Links::upper_prev) {
+      skip_path path;
+      find_path_(head_(), d_size - node->distance_to_end(), path);
+      return unlink_node_(path, node);
+    }
     size_t lvl = node->links();
-    d_head.expand(lvl);
     for (size_t i = 0; i < lvl; i++) {
-      if (!history.empty()) {
-        auto &cur = history.top();
-        assert(i < cur.d_node_p->links());
-        link_(i, cur.d_node_p, node, cur.d_node_p->d_skips[i].second);
-        history.pop();
-      } else {
-        auto cur = end();
-        link_(i, cur.d_node_p, node, cur.d_node_p->d_skips[i].second);
+      if (i > 0) node->prev(i)->upper(i).width += node->upper(i).width - 1;
+      link_(i, node->prev(i), node->next(i));
+    }
+    auto cur = node->prev(lvl - 1);
+    for (size_t i = lvl; i < head_().links(); i++) {
+      while (cur->links() <= i) cur = cur->prev(i - 1);
+      --cur->upper(i).width;
+    }
+    --d_size;
+  }
+
+  skip_node_base &head_() noexcept { return d_head.d_base; }
+
+  const skip_node_base &head_() const noexcept { return d_head.d_base; }
+
+  void reset_head_() noexcept {
+    auto &head = head_();
+    head.d_level = 1;
+    head.d_prev = head.d_next = &head;
+    d_size = 0;
+  }
+
+  /*
+   * Move the towers of one sentinel onto another, repointing the neighbours
+   * at the new sentinel. from is left dangling and must be reset.
+   */
+  static void move_head_(skip_node_base &from, skip_node_base &to,
+                         size_type size) noexcept {
+    skip_path last;
+    if constexpr (!Links::upper_prev) find_path_(from, size, last);
+    to.d_level = from.d_level;
+    for (size_t i = 0; i < from.links(); i++) {
+      if (i > 0) to.upper(i).width = from.upper(i).width;
+      link_(i, Links::upper_prev ? from.prev(i) : last.d_nodes[i], &to);
+      link_(i, &to, from.next(i));
+    }
+  }
+
+  /*
+   * Find where key belongs and link in the node returned by make_node if key
+   * is not already present
+   */
+  template <class K, class MakeNode>
+  insert_type insert_unique_(const_iterator hint, const K &key,
+                             MakeNode &&make_node) {
+    auto &head = head_();
+    // A key past the back with an end hint is appended without a search
+    if (hint.d_node_p == &head &&
+        (head.d_prev == &head || d_comp(head.d_prev->data(), key))) {
+      skip_node_base *node = make_node();
+      append_node_(node);
+      return {iterator{node}, true};
+    }
+    if constexpr (Links::upper_prev) {
+      auto pos = find_pos_(iterator{hint}, key);
+      if (!pos.second) return pos;
+      skip_node_base *node = make_node();
+      insert_node_(pos.first, node);
+      return {iterator{node}, true};
+    } else {
+      skip_path path;
+      if (find_path_(key, path)) {
+        return {iterator{path.d_nodes[0]->d_next}, false};
       }
+      skip_node_base *node = make_node();
+      insert_node_(path, node);
+      return {iterator{node}, true};
     }
   }
 
-  void unlink_node_(skip_node *node) {
-    for (size_t i = 0; i < node->links(); i++) {
-      link_(i, node->d_skips[i].first, node->d_skips[i].second);
+  /*
+   * Tower height of the element at rank r of a list built in order, one level
+   * plus one for every power of the policy's 1 / p that divides r. Each level
+   * then holds exactly every 1 / p-th node of the level below.
+   */
+  static size_t sorted_level_(size_type rank) noexcept {
+    constexpr size_t fanout = detail::level_fanout<Levels>::value;
+    static_assert(fanout > 1, "a level policy must have p < 1");
+    size_t level = 1;
+    while (rank % fanout == 0 && level < Levels::max_level) {
+      rank /= fanout;
+      ++level;
+    }
+    return level;
+  }
+
+  /*
+   * Append ordered elements to an empty list in one sweep, with towers from
+   * sorted_level_() instead of random draws
+   */
+  template <class InputIt>
+  void build_sorted_(InputIt first, InputIt last) {
+    assert(empty());
+    relinker links{head_()};
+    try {
+      for (; first != last; ++first) {
+        auto rank = d_size + 1;
+        skip_node_base *node = allocate_node_(sorted_level_(rank), *first);
+        assert(links.last()->d_sentinel ||
+               d_comp(links.last()->data(), node->data()));
+        links.push(node);
+        d_size = rank;
+      }
+    } catch (...) {
+      links.finish();
+      throw;
+    }
+    links.finish();
+  }
+
+  /*
+   * Rebuild the list keeping only the elements whose presence in other
+   * differs from drop_found, the rest are destroyed
+   */
+  void filter_(const skiplist &other, bool drop_found) {
+    if (&other == this) return;
+    auto &head = head_();
+    auto &end = other.head_();
+    auto a = head.d_next;
+    const skip_node_base *b = end.d_next;
+    relinker links{head};
+    try {
+      while (a != &head) {
+        while (b != &end && d_comp(b->data(), a->data())) b = b->d_next;
+        bool found = b != &end && !d_comp(a->data(), b->data());
+        auto node = std::exchange(a, a->d_next);
+        if (found == drop_found) {
+          destroy_node_(node);
+        } else {
+          links.push(node);
+        }
+      }
+    } catch (...) {
+      links.push_rest(a, &head);
+      d_size = links.finish();
+      throw;
+    }
+    d_size = links.finish();
+  }
+
+  /*
+   * Move a path recorded for some other key over to key.
+   * Climbs only until the path brackets key, either until the recorded node
+   * at a level precedes key again or while the next node up is still before
+   * it, then descends. A key d elements away costs O(log d) instead of a
+   * descent from the sentinel.
+   * Returns true if key is already present.
+   */
+  template <class K>
+  bool seek_path_(const K &key, skip_path &path) {
+    auto &head = head_();
+    auto before = [&](const skip_node_base *node) {
+      return node != &head && d_comp(node->data(), key);
+    };
+    size_t top = 0;
+    while (path.d_nodes[top] != &head && !before(path.d_nodes[top])) {
+      if (++top == head.links()) {
+        top = head.links() - 1;
+        path.d_nodes[top] = &head;
+        path.d_ranks[top] = 0;
+      }
+    }
+    auto valid = top;  // Recorded nodes below this are past key
+    while (top + 1 < head.links() &&
+           before(path.d_nodes[top + 1]->next(top + 1))) {
+      ++top;
+    }
+    skip_node_base *cur = path.d_nodes[top];
+    size_type pos = path.d_ranks[top];
+    for (size_t level = top + 1; level-- > 0;) {
+      if (level >= valid && path.d_ranks[level] > pos) {
+        cur = path.d_nodes[level];
+        pos = path.d_ranks[level];
+      }
+      while (true) {
+        auto next = cur->next(level);
+        if (level > 0) prefetch_(cur->next(level - 1), level - 1);
+        if (!before(next)) break;
+        pos += cur->width(level);
+        cur = next;
+      }
+      path.d_nodes[level] = cur;
+      path.d_ranks[level] = pos;
+    }
+    auto next = cur->d_next;
+    return next != &head && !d_comp(key, next->data());
+  }
+
+  /*
+   * Link in nodes ordered by value in one forward pass, each search starting
+   * from where the last one ended. Nodes equivalent to an element already in
+   * the list, including one linked earlier in the pass, are destroyed.
+   */
+  void merge_sorted_(skip_node_base **first, skip_node_base **last) {
+    skip_path path;
+    std::fill_n(path.d_nodes, MAX_LEVEL, &head_());
+    std::fill_n(path.d_ranks, MAX_LEVEL, 0);
+    skip_node_base *prev = nullptr;
+    try {
+      for (; first != last; ++first) {
+        auto node = *first;
+        if ((prev && !d_comp(prev->data(), node->data())) ||
+            seek_path_(node->data(), path)) {
+          destroy_node_(node);
+          continue;
+        }
+        prev = node;
+        auto rank = path.d_ranks[0] + 1;
+        insert_node_(path, node);
+        for (size_t i = 0; i < node->links(); i++) {
+          path.d_nodes[i] = node;
+          path.d_ranks[i] = rank;
+        }
+      }
+    } catch (...) {
+      for (; first != last; ++first) destroy_node_(*first);
+      throw;
     }
   }
 
+  size_t random_level_() {
+    return std::min<size_t>(d_levels(), Levels::max_level);
+  }
+
+  /*
+   * Bytes in front of the node, the tower plus any padding needed to keep the
+   * node aligned
+   */
+  static constexpr size_t tower_offset_(size_t level) noexcept {
+    auto bytes = (level - 1) * sizeof(skip_link);
+    return (bytes + alignof(skip_node) - 1) / alignof(skip_node) *
+           alignof(skip_node);
+  }
+
+  static constexpr size_t node_units_(size_t level) noexcept {
+    return (tower_offset_(level) + sizeof(skip_node) + sizeof(node_unit) - 1) /
+           sizeof(node_unit);
+  }
+
   template <typename... Args>
-  auto allocate_node_(Args &&...args) {
-    auto node = node_alloc_traits::allocate(d_node_alloc, 1);
-    if (!node) {
+  node_ptr allocate_node_(size_t level, Args &&...args) {
+    auto units = node_units_(level);
+    auto raw = node_alloc_traits::allocate(d_node_alloc, units);
+    if (!raw) {
       throw std::bad_alloc{};
     }
+    auto bytes = reinterpret_cast<unsigned char *>(std::addressof(*raw));
+    auto node = reinterpret_cast<skip_node *>(bytes + tower_offset_(level));
     try {
-      node_alloc_traits::construct(d_node_alloc, node,
+      node_alloc_traits::construct(d_node_alloc, node, level,
                                    std::forward<Args>(args)...);
     } catch (...) {
-      node_alloc_traits::deallocate(d_node_alloc, node, 1);
+      node_alloc_traits::deallocate(d_node_alloc, raw, units);
       throw;
     }
     return node;
   }
 
-  void destroy_node_(node_ptr node) {
-    node_alloc_traits::destroy(d_node_alloc, node);
-    node_alloc_traits::deallocate(d_node_alloc, node, 1);
+  static void deallocate_node_(node_allocator_type &alloc, node_ptr node) {
+    auto level = node->links();
+    node_alloc_traits::destroy(alloc, node);
+    if constexpr (detail::is_monotonic<node_allocator_type>::value) return;
+    auto bytes = reinterpret_cast<unsigned char *>(node) - tower_offset_(level);
+    node_alloc_traits::deallocate(alloc, reinterpret_cast<node_unit *>(bytes),
+                                  node_units_(level));
+  }
+
+  void destroy_node_(skip_node_base *node) {
+    deallocate_node_(d_node_alloc, static_cast<node_ptr>(node));
+  }
+
+  /*
+   * Destroy every node without fixing links, nothing needs doing for
+   * trivial nodes in memory that is never freed one by one
+   */
+  void destroy_nodes_() {
+    if constexpr (detail::is_monotonic<node_allocator_type>::value &&
+                  std::is_trivially_destructible_v<skip_node>) {
+      return;
+    }
+    auto &head = head_();
+    for (auto node = head.d_next; node != &head;) {
+      destroy_node_(std::exchange(node, node->d_next));
+    }
+  }
+
+  /*
+   * Descend to the last node that satisfies pred and return the one after it.
+   * pred must hold for some prefix of the list and for none of the rest.
+   */
+  template <class Pred>
+  const skip_node_base *partition_point_(Pred pred) const {
+    const skip_node_base *head = &head_();
+    const skip_node_base *cur = head;
+    for (size_t level = head->links(); level-- > 0;) {
+      while (true) {
+        auto next = cur->next(level);
+        if (level > 0) prefetch_(cur->next(level - 1), level - 1);
+        if (next == head || !pred(next->data())) break;
+        cur = next;
+      }
+    }
+    return cur->d_next;
+  }
+
+  template <class InputIt>
+  std::vector<skip_node_base *> allocate_nodes_(InputIt first, InputIt last) {
+    std::vector<skip_node_base *> nodes;
+    try {
+      for (; first != last; ++first) {
+        nodes.push_back(nullptr);
+        nodes.back() = allocate_node_(random_level_(), *first);
+      }
+    } catch (...) {
+      for (auto node : nodes) {
+        if (node) destroy_node_(node);
+      }
+      throw;
+    }
+    return nodes;
+  }
+
+  /*
+   * Runs up to BATCH_LANES descents side by side, one step of each per round.
+   * Each lane prefetches the node it compares against next and then yields to
+   * the others, so by the time it comes back the miss has usually been
+   * served and the lanes' misses overlap instead of queueing. A lane's key is
+   * converted to Key once as it starts, or borrowed when it already is one.
+   */
+  static constexpr size_t BATCH_LANES = 16;
+
+  template <class As, class ForwardIt>
+  using batch_key_t = std::conditional_t<
+      std::is_void_v<As>,
+      detail::lookup_key_t<
+          Compare, typename std::iterator_traits<ForwardIt>::value_type, T>,
+      As>;
+
+  template <class Key, class ForwardIt, class OutputIt, class Wrap>
+  OutputIt find_batch_(ForwardIt first, ForwardIt last, OutputIt out,
+                       Wrap wrap) const {
+    using ref = decltype(*first);
+    constexpr bool borrow =
+        std::is_lvalue_reference_v<ref> &&
+        std::is_same_v<std::remove_cv_t<std::remove_reference_t<ref>>, Key>;
+    constexpr size_t lines = std::max<size_t>(Prefetch::lines, 1);
+    const skip_node_base *head = &head_();
+    const Key *keys[BATCH_LANES];
+    std::optional<Key> held[borrow ? 1 : BATCH_LANES];
+    const skip_node_base *cur[BATCH_LANES];
+    const skip_node_base *next[BATCH_LANES];
+    size_t level[BATCH_LANES];
+    while (first != last) {
+      size_t lanes = 0;
+      for (; lanes < BATCH_LANES && first != last; ++lanes, ++first) {
+        if constexpr (borrow) {
+          keys[lanes] = std::addressof(*first);
+        } else {
+          keys[lanes] = std::addressof(held[lanes].emplace(*first));
+        }
+        cur[lanes] = head;
+        level[lanes] = head->links() - 1;
+        next[lanes] = head->next(level[lanes]);
+        prefetch_<lines>(next[lanes], level[lanes]);
+      }
+      for (size_t active = lanes; active > 0;) {
+        for (size_t i = 0; i < lanes; i++) {
+          if (!cur[i]) continue;  // Finished, result is in next[i]
+          if (next[i] != head && d_comp(next[i]->data(), *keys[i])) {
+            cur[i] = next[i];
+          } else if (level[i]-- == 0) {
+            if (next[i] == head || d_comp(*keys[i], next[i]->data())) {
+              next[i] = head;
+            }
+            cur[i] = nullptr;
+            --active;
+            continue;
+          }
+          next[i] = cur[i]->next(level[i]);
+          prefetch_<lines>(next[i], level[i]);
+        }
+      }
+      for (size_t i = 0; i < lanes; i++) *out++ = wrap(next[i]);
+    }
+    return out;
+  }
+
+  /*
+   * Nodes a find for key compares against, counting every comparison of the
+   * descent including the ones that drop a level
+   */
+  template <class K>
+  size_t search_path_(const K &key) const {
+    const skip_node_base *head = &head_();
+    const skip_node_base *cur = head;
+    size_t steps = 0;
+    for (size_t level = head->links(); level-- > 0;) {
+      for (auto next = cur->next(level); next != head;
+           next = cur->next(level)) {
+        ++steps;
+        if (!d_comp(next->data(), key)) break;
+        cur = next;
+      }
+    }
+    return steps;
+  }
+
+  const skip_node_base *nth_(size_type n) const {
+    const skip_node_base *cur = &head_();
+    if (n >= d_size) return cur;
+    size_type pos = 0;
+    for (size_t level = cur->links(); level-- > 0;) {
+      while (pos + cur->width(level) <= n + 1) {
+        pos += cur->width(level);
+        cur = cur->next(level);
+      }
+    }
+    return cur;
   }
 
  public:
+  /*
+   * Finger for lookups that stay close to each other.
+   * Keeps the search path of the last lookup, so the next one climbs only as
+   * far as the distance between the two keys before descending again.
+   * Looking up a key d elements away from the previous one is O(log d), in
+   * either direction. Like iterators, a cursor is invalidated when the list
+   * is modified.
+   */
+  class cursor {
+   public:
+    explicit cursor(skiplist &list) noexcept : d_list_p{&list} { reset(); }
+
+    /*
+     * Forget the last position, the next lookup starts from the sentinel
+     */
+    void reset() noexcept {
+      std::fill_n(d_path.d_nodes, MAX_LEVEL, &d_list_p->head_());
+      std::fill_n(d_path.d_ranks, MAX_LEVEL, 0);
+    }
+
+    template <class K>
+    iterator find(const K &at) {
+      const detail::lookup_key_t<Compare, K, T> &key = at;
+      if (!d_list_p->seek_path_(key, d_path)) return d_list_p->end();
+      return iterator{d_path.d_nodes[0]->d_next};
+    }
+
+    template <class K>
+    iterator lower_bound(const K &at) {
+      const detail::lookup_key_t<Compare, K, T> &key = at;
+      d_list_p->seek_path_(key, d_path);
+      return iterator{d_path.d_nodes[0]->d_next};
+    }
+
+    /*
+     * Number of elements before the last key looked up
+     */
+    size_type rank() const noexcept { return d_path.d_ranks[0]; }
+
+   private:
+    skiplist *d_list_p;
+    skip_path d_path;
+  };
+
   skiplist() : skiplist{value_compare{}} {}
 
   explicit skiplist(const value_compare &cmp,
-                    const allocator_type &alloc = allocator_type{})
-      : d_comp{cmp}, d_alloc{alloc}, d_head{1} {}
+                    const allocator_type &alloc = allocator_type{},
+                    const level_policy &levels = level_policy{})
+      : d_comp{cmp}, d_alloc{alloc}, d_levels{levels} {}
 
   skiplist(const skiplist &other)
-      : d_comp{other.d_comp}, d_alloc{other.d_alloc}, d_head{1} {
-    auto it = end();
-    for (auto &e : other) {
-      it = insert(it, e).first;
-    }
+      : d_comp{other.d_comp},
+        d_alloc{alloc_traits::select_on_container_copy_construction(
+            other.d_alloc)},
+        d_levels{other.d_levels} {
+    build_sorted_(other.begin(), other.end());
   }
 
-  skiplist(const skiplist &&other) noexcept(
+  skiplist(skiplist &&other) noexcept(
       std::is_nothrow_move_constructible_v<Compare>)
       : d_comp{std::move(other.d_comp)},
         d_alloc{std::move(other.d_alloc)},
-        d_head{std::move(other.d_head)} {}
+        d_node_alloc{std::move(other.d_node_alloc)},
+        d_size{other.d_size},
+        d_levels{std::move(other.d_levels)} {
+    move_head_(other.head_(), head_(), d_size);
+    other.reset_head_();
+  }
 
   template <class InputIt>
   skiplist(InputIt first, InputIt last,
            const value_compare &cmp = value_compare(),
-           const Allocator &alloc = Allocator())
-      : skiplist{cmp, alloc} {
+           const Allocator &alloc = Allocator(),
+           const level_policy &levels = level_policy{})
+      : skiplist{cmp, alloc, levels} {
     insert(first, last);
   }
 
+  template <class InputIt>
+  skiplist(sorted_unique_t, InputIt first, InputIt last,
+           const value_compare &cmp = value_compare(),
+           const Allocator &alloc = Allocator(),
+           const level_policy &levels = level_policy{})
+      : skiplist{cmp, alloc, levels} {
+    build_sorted_(first, last);
+  }
+
   skiplist(std::initializer_list<value_type> init,
            const value_compare &cmp = value_compare(),
-           const Allocator &alloc = Allocator())
-      : skiplist{cmp, alloc} {
-    for (auto &&e : init) {
-      emplace(std::move(e));
-    }
+           const Allocator &alloc = Allocator(),
+           const level_policy &levels = level_policy{})
+      : skiplist{cmp, alloc, levels} {
+    insert(init);
   }
 
-  ~skiplist() { clear(); }
+  ~skiplist() { destroy_nodes_(); }
 
   skiplist &operator=(const skiplist &other) {
     if (this == &other) return *this;
     clear();
-    for (auto &e : other) {
-      insert(e);
-    }
+    d_comp = other.d_comp;
+    d_levels = other.d_levels;
+    build_sorted_(other.begin(), other.end());
     return *this;
   }
 
@@ -534,18 +1387,20 @@ class skiplist {
       std::allocator_traits<Allocator>::is_always_equal::value
           &&std::is_nothrow_move_assignable_v<Compare>) {
     clear();
+    d_comp = std::move(other.d_comp);
+    d_levels = std::move(other.d_levels);
     if (typename std::allocator_traits<
             allocator_type>::propagate_on_container_move_assignment()) {
       d_alloc = other.d_alloc;
+      d_node_alloc = other.d_node_alloc;
     }
-    if (d_alloc != other.d_alloc) {
-      for (auto e : other) {
-        insert(e);
-      }
+    if (d_node_alloc != other.d_node_alloc) {
+      build_sorted_(std::make_move_iterator(other.begin()),
+                    std::make_move_iterator(other.end()));
     } else {
-      d_head = std::move(other.d_head);
-      other.d_head = skip_node_base{};
-      other.d_head.expand(1);
+      move_head_(other.head_(), head_(), other.d_size);
+      d_size = other.d_size;
+      other.reset_head_();
       assert(other.empty());
     }
     return *this;
@@ -553,11 +1408,11 @@ class skiplist {
 
   /* Iterators */
   iterator begin() noexcept { return ++end(); }
-  constexpr iterator end() noexcept { return iterator{&d_head}; }
+  iterator end() noexcept { return iterator{&head_()}; }
   const_iterator begin() const noexcept { return cbegin(); }
   const_iterator end() const noexcept { return cend(); }
   const_iterator cbegin() const noexcept { return ++cend(); }
-  const_iterator cend() const noexcept { return const_iterator{&d_head}; }
+  const_iterator cend() const noexcept { return const_iterator{&head_()}; }
   reverse_iterator rbegin() noexcept { return reverse_iterator{end()}; }
   reverse_iterator rend() noexcept { return reverse_iterator{begin()}; }
   const_reverse_iterator rbegin() const noexcept { return crbegin(); }
@@ -572,37 +1427,33 @@ class skiplist {
   /* Capacity */
   bool empty() const noexcept { return begin() == end(); }
 
-  size_type size() const noexcept { return std::distance(begin(), end()); }
+  size_type size() const noexcept { return d_size; }
 
-  size_type max_size() const noexcept { return node_alloc_traits::max_size(); }
+  size_type max_size() const noexcept {
+    return node_alloc_traits::max_size(d_node_alloc) / node_units_(1);
+  }
 
   /* Modifiers */
+  /*
+   * With a monotonic allocator the nodes are only destroyed, then the blocks
+   * are freed all at once if no one else uses the arena. The allocator is
+   * kept either way.
+   */
   void clear() {
-    /*
-     * Don't bother fixing links if we're destroying the entire list
-     */
-    if (begin() != end()) {
-      auto last = begin();
-      for (auto it = ++begin(); it != end(); it++) {
-        destroy_node_(last.d_node_p);
-        last = it;
-      }
-      destroy_node_(last.d_node_p);
-      d_head = skip_node_base{};
-      d_head.expand(1);
+    if (empty()) return;
+    destroy_nodes_();
+    reset_head_();
+    if constexpr (detail::is_monotonic<node_allocator_type>::value) {
+      // d_alloc and d_node_alloc are the two copies held here
+      detail::release_unshared(d_node_alloc, 2, 0);
     }
   }
 
   insert_type insert(const_reference data) { return insert(cend(), data); }
 
   insert_type insert(const_iterator hint, const_reference data) {
-    auto pos = find_pos_(iterator{hint}, data);
-    if (!pos.second) return pos;
-
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    node_ptr node = allocate_node_(lvl, data);
-    insert_node_(pos.first, node);
-    return {iterator{node}, true};
+    return insert_unique_(
+        hint, data, [&] { return allocate_node_(random_level_(), data); });
   }
 
   insert_type insert(value_type &&data) {
@@ -610,13 +1461,9 @@ class skiplist {
   }
 
   insert_type insert(const_iterator hint, value_type &&data) {
-    auto pos = find_pos_(iterator{hint}, data);
-    if (!pos.second) return pos;
-
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    node_ptr node = allocate_node_(lvl, std::move(data));
-    insert_node_(pos.first, node);
-    return {iterator{node}, true};
+    return insert_unique_(hint, data, [&] {
+      return allocate_node_(random_level_(), std::move(data));
+    });
   }
 
   insert_return_type insert(node_type &&nh) {
@@ -624,75 +1471,132 @@ class skiplist {
     if (!nh) {
       return ret;
     }
-    auto pos = find_pos_(end(), nh.d_node_p->d_data);
-    if (!pos.second) {
-      ret.position = pos.first;
-      return ret;
-    }
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    auto node = nh.release_();
-    node->expand(lvl);
-    insert_node_(pos.first, node);
-    ret.inserted = true;
-    ret.position = iterator{node};
+    auto pos = insert_unique_(cend(), nh.d_node_p->d_data,
+                              [&] { return nh.release_(); });
+    ret.position = pos.first;
+    ret.inserted = pos.second;
     return ret;
   }
 
   iterator insert(const_iterator hint, node_type &&nh) {
     if (!nh) return end();
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    auto pos = find_pos_(iterator{hint}, nh.d_node_p->d_data);
-    if (!pos.second) {
-      return pos.first;
-    }
-    auto node = nh.release_();
-    node->expand(lvl);
-    insert_node_(pos.first, node);
-    return iterator{node};
+    return insert_unique_(hint, nh.d_node_p->d_data,
+                          [&] { return nh.release_(); })
+        .first;
   }
 
+  /*
+   * Builds all the nodes up front, sorts them once and merges them in with a
+   * single pass over the list, O(n + m log m) for m new elements.
+   * Ranges of another skiplist of this type are already sorted, as long as
+   * the comparator carries no state they are not sorted again.
+   */
   template <class InputIt>
   void insert(InputIt first, InputIt last) {
-    while (first != last) insert(*first++);
+    constexpr bool sorted = std::is_empty_v<Compare> &&
+                            (std::is_same_v<InputIt, iterator> ||
+                             std::is_same_v<InputIt, const_iterator>);
+    if constexpr (sorted) {
+      insert(sorted_unique, first, last);
+    } else {
+      auto nodes = allocate_nodes_(first, last);
+      std::stable_sort(nodes.begin(), nodes.end(),
+                       [this](skip_node_base *lhs, skip_node_base *rhs) {
+                         return d_comp(lhs->data(), rhs->data());
+                       });
+      merge_sorted_(nodes.data(), nodes.data() + nodes.size());
+    }
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  /*
+   * [first, last) must be ordered by value_comp() without duplicates.
+   * An empty list is built in linear time without any comparisons.
+   */
+  template <class InputIt>
+  void insert(sorted_unique_t, InputIt first, InputIt last) {
+    if (empty()) return build_sorted_(first, last);
+    auto nodes = allocate_nodes_(first, last);
+    merge_sorted_(nodes.data(), nodes.data() + nodes.size());
   }
 
   template <typename... Args>
   insert_type emplace(Args &&...args) {
-    auto data = value_type{std::forward<Args>(args)...};
-    auto pos = find_pos_(end(), data);
-    if (!pos.second) {
-      return pos;
-    }
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    node_ptr node = allocate_node_(lvl, std::move(data));
-    insert_node_(pos.first, node);
-    return {iterator{node}, true};
+    return insert(cend(), value_type{std::forward<Args>(args)...});
+  }
+
+  /*
+   * Search for key once and construct an element from args in its place only
+   * if it is absent. The element built from args must be equivalent to key.
+   * Nothing is constructed and args are left untouched when key is found.
+   */
+  template <class K, typename... Args>
+  insert_type lazy_emplace(const_iterator hint, const K &key, Args &&...args) {
+    return insert_unique_(hint, key, [&] {
+      return allocate_node_(random_level_(), std::forward<Args>(args)...);
+    });
   }
 
   template <typename... Args>
   iterator emplace_hint(const_iterator hint, Args &&...args) {
-    auto data = value_type{std::forward<Args>(args)...};
-    auto pos = find_pos_(iterator{hint}, data);
-    if (!pos.second) {
-      return pos.first;
-    }
-    auto lvl = std::geometric_distribution<uint8_t>{}(d_gen) + 1;
-    node_ptr node = allocate_node_(lvl, std::move(data));
-    insert_node_(pos.first, node);
-    return iterator{node};
+    return insert(hint, value_type{std::forward<Args>(args)...}).first;
   }
 
   iterator erase(const iterator &pos) {
-    auto ret = iterator{pos.d_node_p->d_skips[0].second};
+    auto ret = iterator{pos.d_node_p->d_next};
     auto node = pos.d_node_p;
     unlink_node_(node);
     destroy_node_(node);
     return ret;
   }
 
+  iterator erase(const const_iterator &pos) { return erase(pos.un_const()); }
+
+  /*
+   * Unlinks the whole range with one pair of descents, then frees the nodes
+   */
+  iterator erase(const_iterator first, const_iterator last) {
+    auto begin = const_cast<skip_node_base *>(first.d_node_p);
+    auto end = const_cast<skip_node_base *>(last.d_node_p);
+    if (begin == end) return iterator{end};
+    auto &head = head_();
+    auto from = d_size - begin->distance_to_end();
+    auto to = d_size - end->distance_to_end();
+    auto count = to - from;
+    skip_path before;
+    skip_path inside;
+    find_path_(head, from, before);
+    find_path_(head, to, inside);
+    for (size_t i = 0; i < head.links(); i++) {
+      auto cur = before.d_nodes[i];
+      if (i == 0) {
+        link_(0, cur, end);
+        continue;
+      }
+      auto next_rank = inside.d_ranks[i] + inside.d_nodes[i]->width(i);
+      cur->upper(i).width = next_rank - before.d_ranks[i] - count;
+      if (cur != inside.d_nodes[i]) link_(i, cur, inside.d_nodes[i]->next(i));
+    }
+    d_size -= count;
+    while (begin != end) destroy_node_(std::exchange(begin, begin->d_next));
+    return iterator{end};
+  }
+
   template <typename K>
   size_type erase(const K &val) {
-    auto it = find(val);
+    const detail::lookup_key_t<Compare, K, T> &key = val;
+    if constexpr (!Links::upper_prev) {
+      skip_path path;
+      if (!find_path_(key, path)) return 0;
+      auto node = path.d_nodes[0]->d_next;
+      unlink_node_(path, node);
+      destroy_node_(node);
+      return 1;
+    }
+    auto it = find(key);
     if (it != end()) {
       erase(it);
       return 1;
@@ -705,12 +1609,19 @@ class skiplist {
           &&std::__is_nothrow_swappable<Compare>::value) {
     std::swap(d_comp, other.d_comp);
     std::swap(d_alloc, other.d_alloc);
+    std::swap(d_levels, other.d_levels);
+    std::swap(d_node_alloc, other.d_node_alloc);
+    skip_head tmp;
+    move_head_(head_(), tmp.d_base, d_size);
+    move_head_(other.head_(), head_(), other.d_size);
+    move_head_(tmp.d_base, other.head_(), d_size);
+    std::swap(d_size, other.d_size);
   }
 
   node_type extract(const const_iterator &pos) {
     auto node = pos.un_const().d_node_p;
     unlink_node_(node);
-    return node_type{node, d_node_alloc};
+    return node_type{static_cast<node_ptr>(node), d_node_alloc};
   }
 
   node_type extract(const_reference data) {
@@ -719,85 +1630,401 @@ class skiplist {
     return node_type{};
   }
 
+  template <class K,
+            class = std::enable_if_t<
+                detail::is_transparent<Compare>::value &&
+                !std::is_convertible_v<const K &, const_iterator>>>
+  node_type extract(const K &key) {
+    auto res = find_pos_(end(), key);
+    if (!res.second) return extract(res.first);
+    return node_type{};
+  }
+
   template <class C2>
-  void merge(skiplist<T, C2, Allocator> &source) {
+  void merge(skiplist<T, C2, Allocator, Links, Levels, Prefetch> &source) {
     merge(std::move(source));
   }
 
+  /*
+   * Sources ordered by the same comparator are merged in one linear sweep
+   * over both level 0 chains, others fall back to inserting node by node.
+   * Nodes only change hands between equal allocators, otherwise each element
+   * is moved into a node of this list's own. Elements already present stay
+   * behind in source.
+   */
   template <class C2>
-  void merge(skiplist<T, C2, Allocator> &&source) {
+  void merge(skiplist<T, C2, Allocator, Links, Levels, Prefetch> &&source) {
+    if (d_node_alloc != source.d_node_alloc) {
+      for (auto it = source.begin(); it != source.end();) {
+        if (insert(cend(), std::move(*it)).second) {
+          it = source.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      return;
+    }
+    if constexpr (std::is_same_v<C2, Compare>) {
+      if (&source == this) return;
+      auto &head = head_();
+      auto &other = source.head_();
+      auto a = head.d_next;
+      auto b = other.d_next;
+      relinker links{head};
+      relinker rest{other};
+      try {
+        while (a != &head && b != &other) {
+          if (d_comp(b->data(), a->data())) {
+            links.push(std::exchange(b, b->d_next));
+            continue;
+          }
+          if (!d_comp(a->data(), b->data())) {
+            rest.push(std::exchange(b, b->d_next));
+          }
+          links.push(std::exchange(a, a->d_next));
+        }
+      } catch (...) {
+        links.push_rest(a, &head);
+        rest.push_rest(b, &other);
+        d_size = links.finish();
+        source.d_size = rest.finish();
+        throw;
+      }
+      // Everything left in either chain sorts after what was pushed
+      links.push_rest(a, &head);
+      links.push_rest(b, &other);
+      d_size = links.finish();
+      source.d_size = rest.finish();
+      return;
+    }
     for (auto it = source.begin(); it != source.end();) {
-      auto r = find_pos_(end(), *it);
       auto node = it.d_node_p;
       ++it;
-      if (r.second) {
+      insert_unique_(cend(), node->data(), [&] {
         source.unlink_node_(node);
-        insert_node_(r.first, node);
+        return node;
+      });
+    }
+  }
+
+  /*
+   * Set algebra against another list in O(size() + other.size()), both lists
+   * are walked together along level 0 and this list is rebuilt in the same
+   * sweep. Both must be ordered the same way.
+   */
+
+  /* Add copies of the elements of other missing from this list */
+  void set_union(const skiplist &other) {
+    if (&other == this) return;
+    auto &head = head_();
+    auto &end = other.head_();
+    auto a = head.d_next;
+    const skip_node_base *b = end.d_next;
+    relinker links{head};
+    try {
+      for (; b != &end; b = b->d_next) {
+        while (a != &head && d_comp(a->data(), b->data())) {
+          links.push(std::exchange(a, a->d_next));
+        }
+        if (a != &head && !d_comp(b->data(), a->data())) continue;
+        links.push(allocate_node_(random_level_(), b->data()));
+      }
+    } catch (...) {
+      links.push_rest(a, &head);
+      d_size = links.finish();
+      throw;
+    }
+    links.push_rest(a, &head);
+    d_size = links.finish();
+  }
+
+  /* Erase the elements not found in other */
+  void set_intersection(const skiplist &other) {
+    filter_(other, false);
+  }
+
+  /* Erase the elements found in other */
+  void set_difference(const skiplist &other) {
+    if (&other == this) return clear();
+    filter_(other, true);
+  }
+
+  /*
+   * Detach every element not less than key into a new list in O(log n),
+   * nodes are handed over without being copied
+   */
+  template <class K>
+  skiplist split(const K &at) {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    skiplist tail{d_comp, d_alloc, d_levels};
+    skip_path path{};
+    find_path_(key, path);
+    auto keep = path.d_ranks[0];
+    if (keep == d_size) return tail;
+    auto &head = head_();
+    auto &other = tail.head_();
+    skip_path last;
+    find_path_(head, d_size, last);
+    other.expand(head.links(), 0);
+    for (size_t i = 0; i < head.links(); i++) {
+      auto cur = path.d_nodes[i];
+      if (i > 0) {
+        other.upper(i).width = path.d_ranks[i] + cur->upper(i).width - keep;
+        cur->upper(i).width = keep + 1 - path.d_ranks[i];
       }
+      if (cur == last.d_nodes[i]) continue;  // Nothing moves at this level
+      link_(i, &other, cur->next(i));
+      link_(i, last.d_nodes[i], &other);
+      link_(i, cur, &head);
     }
+    tail.d_size = d_size - keep;
+    d_size = keep;
+    return tail;
+  }
+
+  /*
+   * Concatenate a list whose elements all sort before or after ours in
+   * O(log n), leaving other empty. Both lists must use equal allocators.
+   */
+  void join(skiplist &other) { join(std::move(other)); }
+
+  void join(skiplist &&other) {
+    assert(d_node_alloc == other.d_node_alloc);
+    if (&other == this || other.empty()) return;
+    if (!empty() && d_comp(*other.rbegin(), *begin())) swap(other);
+    assert(empty() || d_comp(*rbegin(), *other.begin()));
+    auto &head = head_();
+    auto &first = other.head_();
+    head.expand(first.links(), d_size + 1);
+    skip_path last;
+    skip_path other_last;
+    find_path_(head, d_size, last);
+    find_path_(first, other.d_size, other_last);
+    for (size_t i = 0; i < head.links(); i++) {
+      auto cur = last.d_nodes[i];
+      if (i >= first.links() || first.next(i) == &first) {
+        if (i > 0) cur->upper(i).width += other.d_size;
+        continue;
+      }
+      if (i > 0) {
+        cur->upper(i).width = d_size - last.d_ranks[i] + first.upper(i).width;
+      }
+      link_(i, cur, first.next(i));
+      link_(i, other_last.d_nodes[i], &head);
+    }
+    d_size += other.d_size;
+    other.reset_head_();
   }
 
   /* Lookup */
   template <class K>
   iterator find(const K &data) {
-    auto r = find_pos_(end(), data);
+    const detail::lookup_key_t<Compare, K, T> &key = data;
+    auto r = find_pos_(end(), key);
     if (!r.second) return r.first;
     return end();
   }
 
   template <class K>
   const_iterator find(const K &data) const {
-    auto r = find_pos_(end(), data);
-    if (!r.second) return r.first;
-    return end();
+    return const_cast<skiplist *>(this)->find(data);  // NOLINT
+  }
+
+  template <class K>
+  size_type count(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <class K>
+  bool contains(const K &key) const {
+    return find(key) != end();
+  }
+
+  /*
+   * Look up every key in [first, last) and write the result of find for each
+   * to out, in input order. The searches are interleaved so their cache
+   * misses overlap, which makes this much faster than a loop of find on large
+   * lists. Each key is converted once before its search, to T unless Compare
+   * is transparent, or to As when it is given.
+   */
+  template <class As = void, class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    return find_batch_<batch_key_t<As, ForwardIt>>(
+        first, last, out, [](const skip_node_base *node) {
+          return iterator{const_cast<skip_node_base *>(node)};  // NOLINT
+        });
+  }
+
+  template <class As = void, class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    return find_batch_<batch_key_t<As, ForwardIt>>(
+        first, last, out,
+        [](const skip_node_base *node) { return const_iterator{node}; });
+  }
+
+  template <class K>
+  iterator lower_bound(const K &key) {
+    return iterator{std::as_const(*this).lower_bound(key)};
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    return const_iterator{
+        partition_point_([&](const T &e) { return d_comp(e, key); })};
+  }
+
+  template <class K>
+  iterator upper_bound(const K &key) {
+    return iterator{std::as_const(*this).upper_bound(key)};
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    return const_iterator{
+        partition_point_([&](const T &e) { return !d_comp(key, e); })};
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &key) {
+    auto range = std::as_const(*this).equal_range(key);
+    return {iterator{range.first}, iterator{range.second}};
+  }
+
+  /*
+   * Keys are unique so the range is found with a single descent
+   */
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    auto first = lower_bound(key);
+    auto last = first;
+    if (last != end() && !d_comp(key, *last)) ++last;
+    return {first, last};
+  }
+
+  /* Indexing */
+  /*
+   * Element at position n, or end() if n is out of range
+   */
+  iterator nth(size_type n) { return iterator{const_iterator{nth_(n)}}; }
+
+  const_iterator nth(size_type n) const { return const_iterator{nth_(n)}; }
+
+  /*
+   * Number of elements that compare less than key
+   */
+  template <class K>
+  size_type rank(const K &at) const {
+    const detail::lookup_key_t<Compare, K, T> &key = at;
+    const skip_node_base *head = &head_();
+    const skip_node_base *cur = head;
+    size_type pos = 0;
+    for (size_t level = head->links(); level-- > 0;) {
+      for (auto next = cur->next(level);
+           next != head && d_comp(next->data(), key);
+           next = cur->next(level)) {
+        pos += cur->width(level);
+        cur = next;
+      }
+    }
+    return pos;
+  }
+
+  /*
+   * Level histogram, search path lengths and memory use. Walks the whole
+   * list once, and measures search paths by searching again for up to
+   * samples elements spread evenly over it, so nothing is counted on the
+   * normal paths.
+   */
+  skiplist_stats stats(size_type samples = 64) const {
+    skiplist_stats s;
+    s.size = d_size;
+    const skip_node_base *head = &head_();
+    size_type stride = std::max<size_type>(samples ? d_size / samples : 0, 1);
+    std::vector<const skip_node_base *> probes;
+    size_type rank = 0;
+    for (auto node = head->d_next; node != head; node = node->d_next) {
+      auto level = node->links();
+      if (s.level_histogram.size() < level) s.level_histogram.resize(level);
+      ++s.level_histogram[level - 1];
+      s.node_bytes += node_units_(level) * sizeof(node_unit);
+      if (rank++ % stride == 0 && probes.size() < samples) {
+        probes.push_back(node);
+      }
+    }
+    s.max_level = s.level_histogram.size();
+    if (d_size > 1) {
+      constexpr auto fanout = detail::level_fanout<Levels>::value;
+      s.ideal_level = std::log(static_cast<double>(d_size)) /
+                      std::log(static_cast<double>(fanout));
+    }
+    size_t steps = 0;
+    for (auto node : probes) {
+      auto path = search_path_(node->data());
+      steps += path;
+      s.max_search_path = std::max(s.max_search_path, path);
+    }
+    if (!probes.empty()) {
+      s.mean_search_path = static_cast<double>(steps) / probes.size();
+    }
+    s.total_bytes = sizeof(*this) + s.node_bytes;
+    if (d_size) {
+      s.bytes_per_element = static_cast<double>(s.total_bytes) / d_size;
+    }
+    return s;
   }
 
   /* Observers */
   value_compare value_comp() const { return d_comp; }
 
+  allocator_type get_allocator() const noexcept { return d_alloc; }
+
  private:
   value_compare d_comp;
   allocator_type d_alloc;
-  node_allocator_type d_node_alloc;
-  skip_node_base d_head;
-  std::mt19937 d_gen{std::random_device{}()};
+  node_allocator_type d_node_alloc{d_alloc};
+  skip_head d_head;
+  size_type d_size = 0;
+  Levels d_levels;
 };
 
-template <class T, class Compare, class Alloc>
-bool operator==(const skiplist<T, Compare, Alloc> &lhs,
-                const skiplist<T, Compare, Alloc> &rhs) {
-  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
-                    lhs.value_comp());
+template <class T, class... Policies>
+bool operator==(const skiplist<T, Policies...> &lhs,
+                const skiplist<T, Policies...> &rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
 }
 
-template <class T, class Compare, class Alloc>
-bool operator!=(const skiplist<T, Compare, Alloc> &lhs,
-                const skiplist<T, Compare, Alloc> &rhs) {
+template <class T, class... Policies>
+bool operator!=(const skiplist<T, Policies...> &lhs,
+                const skiplist<T, Policies...> &rhs) {
   return !(lhs == rhs);
 }
 
-template <class T, class Compare, class Alloc>
-bool operator<(const skiplist<T, Compare, Alloc> &lhs,
-               const skiplist<T, Compare, Alloc> &rhs) {
+template <class T, class... Policies>
+bool operator<(const skiplist<T, Policies...> &lhs,
+               const skiplist<T, Policies...> &rhs) {
   return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
                                       rhs.end(), lhs.value_comp());
 }
 
-template <class T, class Compare, class Alloc>
-bool operator<=(const skiplist<T, Compare, Alloc> &lhs,
-                const skiplist<T, Compare, Alloc> &rhs) {
+template <class T, class... Policies>
+bool operator<=(const skiplist<T, Policies...> &lhs,
+                const skiplist<T, Policies...> &rhs) {
   return (lhs < rhs) || (lhs == rhs);
 }
 
-template <class T, class Compare, class Alloc>
-bool operator>(const skiplist<T, Compare, Alloc> &lhs,
-               const skiplist<T, Compare, Alloc> &rhs) {
+template <class T, class... Policies>
+bool operator>(const skiplist<T, Policies...> &lhs,
+               const skiplist<T, Policies...> &rhs) {
   return rhs < lhs;
 }
 
-template <class T, class Compare, class Alloc>
-bool operator>=(const skiplist<T, Compare, Alloc> &lhs,
-                const skiplist<T, Compare, Alloc> &rhs) {
+template <class T, class... Policies>
+bool operator>=(const skiplist<T, Policies...> &lhs,
+                const skiplist<T, Policies...> &rhs) {
   return rhs <= lhs;
 }
 
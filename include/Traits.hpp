@@ -0,0 +1,32 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include <type_traits>
+
+namespace wijagels {
+/*
+ * Marks input that is already ordered by the container's comparator and free
+ * of duplicates, so it can be taken in without comparing
+ */
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+namespace detail {
+/*
+ * Lookups by another type only reach the comparator as is when it declares
+ * is_transparent, otherwise the argument is converted to Key once up front
+ * rather than on every comparison of the search
+ */
+template <class Compare, class = void>
+struct is_transparent : std::false_type {};
+
+template <class Compare>
+struct is_transparent<Compare, std::void_t<typename Compare::is_transparent>>
+    : std::true_type {};
+
+template <class Compare, class K, class Key>
+using lookup_key_t =
+    std::conditional_t<is_transparent<Compare>::value, K, Key>;
+}  // namespace detail
+}  // namespace wijagels
@@ -0,0 +1,721 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "Traits.hpp"
+#include "Vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wijagels {
+namespace detail {
+/*
+ * Control byte of a hash table slot, either EMPTY or the low 7 bits of the
+ * hash of the element in it
+ */
+using ctrl_t = std::int8_t;
+static constexpr ctrl_t CTRL_EMPTY = -128;
+
+#if defined(__SSE2__)
+/*
+ * Sixteen control bytes compared at once, a set bit i in a mask means byte i
+ * matched
+ */
+class ctrl_group {
+ public:
+  static constexpr std::size_t WIDTH = 16;
+  using mask_type = std::uint32_t;
+
+  explicit ctrl_group(const ctrl_t *pos) noexcept
+      : d_ctrl{_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))} {}
+
+  mask_type match(ctrl_t h2) const noexcept {
+    return static_cast<mask_type>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), d_ctrl)));
+  }
+
+  /* EMPTY is the only control byte with the sign bit set */
+  mask_type match_empty() const noexcept {
+    return static_cast<mask_type>(_mm_movemask_epi8(d_ctrl));
+  }
+
+  static std::size_t lowest(mask_type mask) noexcept {
+    return static_cast<std::size_t>(__builtin_ctz(mask));
+  }
+
+ private:
+  __m128i d_ctrl;
+};
+#else
+/*
+ * Portable fallback, eight control bytes in a word with the result in the
+ * high bit of each byte. match can report a false positive right after a
+ * true one, always on a full slot, which the key comparison rejects.
+ */
+class ctrl_group {
+  static constexpr std::uint64_t LSBS = 0x0101010101010101;
+  static constexpr std::uint64_t MSBS = 0x8080808080808080;
+
+ public:
+  static constexpr std::size_t WIDTH = 8;
+  using mask_type = std::uint64_t;
+
+  explicit ctrl_group(const ctrl_t *pos) noexcept {
+    std::memcpy(&d_ctrl, pos, sizeof(d_ctrl));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    d_ctrl = __builtin_bswap64(d_ctrl);
+#endif
+  }
+
+  mask_type match(ctrl_t h2) const noexcept {
+    auto x = d_ctrl ^ (LSBS * static_cast<std::uint8_t>(h2));
+    return (x - LSBS) & ~x & MSBS;
+  }
+
+  mask_type match_empty() const noexcept { return d_ctrl & MSBS; }
+
+  static std::size_t lowest(mask_type mask) noexcept {
+    return static_cast<std::size_t>(__builtin_ctzll(mask)) >> 3;
+  }
+
+ private:
+  std::uint64_t d_ctrl;
+};
+#endif
+
+/*
+ * Hashes like std::hash<int> are the identity, so the result is mixed
+ * before its bits pick a home slot and a fingerprint
+ */
+inline std::uint64_t mix_hash(std::uint64_t h) noexcept {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 m = h;
+  m *= 0x9e3779b97f4a7c15;
+  return static_cast<std::uint64_t>(m >> 64) ^ static_cast<std::uint64_t>(m);
+#else
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccd;
+  return h ^ (h >> 33);
+#endif
+}
+
+/*
+ * The table of an open addressing hash map without the elements: a control
+ * byte per slot and a Slot saying where the element is. Slot must have a
+ * d_hash member, which insert() fills with the hash bits that picked the
+ * home slot, so resizing and erasing never hash a key again.
+ * Probes walk the table linearly a group of control bytes at a time.
+ * Erasing shifts the rest of the probe run back instead of leaving a
+ * tombstone, so lookups never slow down from churn.
+ */
+template <class Slot, class Allocator>
+class probe_index {
+  using alloc_traits = std::allocator_traits<Allocator>;
+  using ctrl_vector =
+      vector<ctrl_t, typename alloc_traits::template rebind_alloc<ctrl_t>>;
+  using slot_vector =
+      vector<Slot, typename alloc_traits::template rebind_alloc<Slot>>;
+
+ public:
+  using size_type = std::size_t;
+
+  /* Table slots per group probe */
+  static constexpr size_type GROUP = ctrl_group::WIDTH;
+  static constexpr size_type npos = ~size_type{0};
+
+  explicit probe_index(const Allocator &alloc)
+      : d_ctrl(typename ctrl_vector::allocator_type{alloc}),
+        d_slots(typename slot_vector::allocator_type{alloc}) {}
+
+  /* Seven eighths of the slots may be full before the table must grow */
+  static constexpr size_type max_load(size_type capacity) noexcept {
+    return capacity - capacity / 8;
+  }
+
+  size_type capacity() const noexcept { return d_slots.size(); }
+
+  Slot &operator[](size_type s) noexcept { return d_slots[s]; }
+
+  const Slot &operator[](size_type s) const noexcept { return d_slots[s]; }
+
+  /*
+   * The slot in hash's probe run that pred accepts, or npos. pred only sees
+   * slots whose fingerprint matches.
+   */
+  template <class Pred>
+  size_type find(std::uint64_t hash, Pred pred) const {
+    if (d_slots.empty()) return npos;
+    auto mask = mask_();
+    auto h2 = h2_(hash);
+    for (size_type pos = h1_(hash) & mask;; pos = (pos + GROUP) & mask) {
+      ctrl_group g{d_ctrl.data() + pos};
+      for (auto m = g.match(h2); m; m &= m - 1) {
+        auto s = (pos + ctrl_group::lowest(m)) & mask;
+        if (pred(d_slots[s])) return s;
+      }
+      if (g.match_empty()) return npos;
+    }
+  }
+
+  /* Fill the first empty slot of hash's probe run, there must be room */
+  size_type insert(std::uint64_t hash, Slot slot) noexcept {
+    slot.d_hash = h1_(hash);
+    auto s = find_empty_(slot.d_hash);
+    set_ctrl_(s, h2_(hash));
+    d_slots[s] = slot;
+    return s;
+  }
+
+  /*
+   * Empty slot s, then walk the rest of its probe run and move back every
+   * slot whose home is not between the gap and itself, so that no run has
+   * a hole in it
+   */
+  void erase(size_type s) noexcept {
+    auto mask = mask_();
+    auto gap = s;
+    for (auto i = (s + 1) & mask; d_ctrl[i] != CTRL_EMPTY; i = (i + 1) & mask) {
+      auto home = d_slots[i].d_hash & mask;
+      if (((i - home) & mask) >= ((i - gap) & mask)) {
+        set_ctrl_(gap, d_ctrl[i]);
+        d_slots[gap] = d_slots[i];
+        gap = i;
+      }
+    }
+    set_ctrl_(gap, CTRL_EMPTY);
+  }
+
+  /* Rebuild with capacity slots, a power of two of at least GROUP */
+  void resize(size_type capacity) {
+    ctrl_vector ctrl(d_ctrl.get_allocator());
+    slot_vector slots(d_slots.get_allocator());
+    ctrl.resize(capacity + GROUP - 1, CTRL_EMPTY);
+    slots.resize(capacity, Slot{});
+    d_ctrl.swap(ctrl);
+    d_slots.swap(slots);
+    for (size_type i = 0; i < slots.size(); i++) {
+      if (ctrl[i] == CTRL_EMPTY) continue;
+      auto s = find_empty_(slots[i].d_hash);
+      set_ctrl_(s, ctrl[i]);
+      d_slots[s] = slots[i];
+    }
+  }
+
+  void clear() noexcept {
+    std::fill_n(d_ctrl.data(), d_ctrl.size(), CTRL_EMPTY);
+  }
+
+  void swap(probe_index &other) noexcept {
+    d_ctrl.swap(other.d_ctrl);
+    d_slots.swap(other.d_slots);
+  }
+
+ private:
+  static std::uint32_t h1_(std::uint64_t hash) noexcept {
+    return static_cast<std::uint32_t>(hash >> 32);
+  }
+
+  static ctrl_t h2_(std::uint64_t hash) noexcept {
+    return static_cast<ctrl_t>(hash & 0x7f);
+  }
+
+  size_type mask_() const noexcept { return capacity() - 1; }
+
+  /* Slots past the end of the table mirror the first GROUP - 1 */
+  void set_ctrl_(size_type i, ctrl_t h) noexcept {
+    d_ctrl[i] = h;
+    if (i < GROUP - 1) d_ctrl[capacity() + i] = h;
+  }
+
+  /* First empty slot of the probe run that starts at h1's home */
+  size_type find_empty_(std::uint32_t h1) const noexcept {
+    auto mask = mask_();
+    for (size_type pos = h1 & mask;; pos = (pos + GROUP) & mask) {
+      auto m = ctrl_group{d_ctrl.data() + pos}.match_empty();
+      if (m) return (pos + ctrl_group::lowest(m)) & mask;
+    }
+  }
+
+  ctrl_vector d_ctrl;
+  slot_vector d_slots;
+};
+}  // namespace detail
+
+/*
+ * Open addressing hash map in the style of SwissTable.
+ * Elements live densely in a vector, in insertion order until an erase
+ * moves the last one into the gap, with each element's hash kept in a
+ * parallel vector so that gap can be pointed at without hashing the moved
+ * key again. The table beside it holds a control byte per slot and, for
+ * full slots, the element's index and hash. Probes
+ * walk the table linearly a group of control bytes at a time, comparing
+ * the group against the 7 bit fingerprint of the hash with SIMD, so keys
+ * are only compared on a fingerprint hit.
+ * Erasing shifts the rest of the probe run back instead of leaving a
+ * tombstone, so lookups never slow down from churn, and the table only
+ * grows with the number of elements.
+ * Iterators are vector iterators. Inserts invalidate them on growth, an
+ * erase moves only the last element, which Key and T must be able to do
+ * without throwing.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>>
+class unordered_map {
+  using alloc_traits = std::allocator_traits<Allocator>;
+  using values_type = vector<std::pair<const Key, T>, Allocator>;
+  using hashes_type =
+      vector<std::uint64_t,
+             typename alloc_traits::template rebind_alloc<std::uint64_t>>;
+
+ public:
+  /* Aliases */
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = typename alloc_traits::pointer;
+  using const_pointer = typename alloc_traits::const_pointer;
+  using iterator = typename values_type::iterator;
+  using const_iterator = typename values_type::const_iterator;
+
+ private:
+  /* Where a full slot's element is, and the hash bits its home came from */
+  struct slot {
+    std::uint32_t d_index;
+    std::uint32_t d_hash;
+  };
+
+  using table_type = detail::probe_index<slot, Allocator>;
+
+ public:
+  /* Table slots per group probe */
+  static constexpr size_type GROUP = table_type::GROUP;
+
+ private:
+
+  template <class K>
+  using lookup_key_t =
+      std::conditional_t<detail::is_transparent<Hash>::value &&
+                             detail::is_transparent<KeyEqual>::value,
+                         K, Key>;
+
+  /* Key overloads that would otherwise catch iterators stay out of the way */
+  template <class K>
+  using transparent_key_t =
+      std::enable_if_t<detail::is_transparent<Hash>::value &&
+                       detail::is_transparent<KeyEqual>::value &&
+                       !std::is_convertible_v<const K &, const_iterator>>;
+
+ public:
+  /* Constructors */
+  unordered_map() : unordered_map(0) {}
+
+  explicit unordered_map(size_type bucket_count, const Hash &hash = Hash{},
+                         const KeyEqual &equal = KeyEqual{},
+                         const Allocator &alloc = Allocator{})
+      : d_hash{hash},
+        d_equal{equal},
+        d_values(alloc),
+        d_hashes(typename hashes_type::allocator_type{alloc}),
+        d_table(alloc) {
+    if (bucket_count) rehash(bucket_count);
+  }
+
+  explicit unordered_map(const Allocator &alloc)
+      : unordered_map{0, Hash{}, KeyEqual{}, alloc} {}
+
+  template <class InputIt>
+  unordered_map(InputIt first, InputIt last, size_type bucket_count = 0,
+                const Hash &hash = Hash{}, const KeyEqual &equal = KeyEqual{},
+                const Allocator &alloc = Allocator{})
+      : unordered_map{bucket_count, hash, equal, alloc} {
+    insert(first, last);
+  }
+
+  unordered_map(std::initializer_list<value_type> init,
+                size_type bucket_count = 0, const Hash &hash = Hash{},
+                const KeyEqual &equal = KeyEqual{},
+                const Allocator &alloc = Allocator{})
+      : unordered_map{init.begin(), init.end(), bucket_count, hash, equal,
+                      alloc} {}
+
+  unordered_map(const unordered_map &) = default;
+  unordered_map(unordered_map &&) noexcept = default;
+
+  /* Destructor */
+  ~unordered_map() = default;
+
+  /* Assignment */
+  unordered_map &operator=(const unordered_map &) = default;
+  unordered_map &operator=(unordered_map &&) noexcept = default;
+
+  unordered_map &operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    insert(ilist);
+    return *this;
+  }
+
+  /* Allocator */
+  allocator_type get_allocator() const { return d_values.get_allocator(); }
+
+  /* Element access */
+  T &at(const Key &key) {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range{"Key not found"};
+    return it->second;
+  }
+
+  const T &at(const Key &key) const {
+    auto it = find(key);
+    if (it == end()) throw std::out_of_range{"Key not found"};
+    return it->second;
+  }
+
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+  T &operator[](Key &&key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  /* Iterators */
+  iterator begin() noexcept { return d_values.begin(); }
+  iterator end() noexcept { return d_values.end(); }
+  const_iterator begin() const noexcept { return d_values.cbegin(); }
+  const_iterator end() const noexcept { return d_values.cend(); }
+  const_iterator cbegin() const noexcept { return d_values.cbegin(); }
+  const_iterator cend() const noexcept { return d_values.cend(); }
+
+  /* Capacity */
+  bool empty() const noexcept { return d_values.empty(); }
+  size_type size() const noexcept { return d_values.size(); }
+  size_type max_size() const noexcept {
+    return std::min<size_type>(d_values.max_size(), UINT32_MAX);
+  }
+
+  /* Modifiers */
+  void clear() noexcept {
+    d_values.clear();
+    d_hashes.clear();
+    d_table.clear();
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return try_emplace_(value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return try_emplace_(value.first, std::move(value.second));
+  }
+
+  iterator insert(const_iterator, const value_type &value) {
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator, value_type &&value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) insert(*first);
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    std::pair<Key, T> value(std::forward<Args>(args)...);
+    return try_emplace_(std::move(value.first), std::move(value.second));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator, Args &&...args) {
+    return emplace(std::forward<Args>(args)...).first;
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type &k, Args &&...args) {
+    return try_emplace_(k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type &&k, Args &&...args) {
+    return try_emplace_(std::move(k), std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator, const key_type &k, Args &&...args) {
+    return try_emplace_(k, std::forward<Args>(args)...).first;
+  }
+
+  template <class... Args>
+  iterator try_emplace(const_iterator, key_type &&k, Args &&...args) {
+    return try_emplace_(std::move(k), std::forward<Args>(args)...).first;
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type &k, M &&obj) {
+    return insert_or_assign_(k, std::forward<M>(obj));
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type &&k, M &&obj) {
+    return insert_or_assign_(std::move(k), std::forward<M>(obj));
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator, const key_type &k, M &&obj) {
+    return insert_or_assign_(k, std::forward<M>(obj)).first;
+  }
+
+  template <class M>
+  iterator insert_or_assign(const_iterator, key_type &&k, M &&obj) {
+    return insert_or_assign_(std::move(k), std::forward<M>(obj)).first;
+  }
+
+  /*
+   * The last element moves into the erased one's place, so erasing while
+   * iterating goes on from the returned iterator without skipping anything
+   */
+  iterator erase(const_iterator pos) {
+    auto index = static_cast<size_type>(pos - cbegin());
+    erase_slot_(find_slot_(index));
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator{pos}); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto from = static_cast<size_type>(first - cbegin());
+    for (auto i = static_cast<size_type>(last - cbegin()); i-- > from;) {
+      erase_slot_(find_slot_(i));
+    }
+    return begin() + static_cast<difference_type>(from);
+  }
+
+  size_type erase(const key_type &key) { return erase_(key); }
+
+  template <class K, class = transparent_key_t<K>>
+  size_type erase(const K &x) {
+    return erase_(x);
+  }
+
+  void swap(unordered_map &other) noexcept(
+      std::is_nothrow_swappable_v<Hash>
+          &&std::is_nothrow_swappable_v<KeyEqual>) {
+    std::swap(d_hash, other.d_hash);
+    std::swap(d_equal, other.d_equal);
+    d_values.swap(other.d_values);
+    d_hashes.swap(other.d_hashes);
+    d_table.swap(other.d_table);
+  }
+
+  /* Lookup */
+  template <class K>
+  size_type count(const K &x) const {
+    return find(x) != end();
+  }
+
+  template <class K>
+  bool contains(const K &x) const {
+    return find(x) != end();
+  }
+
+  template <class K>
+  iterator find(const K &x) {
+    const lookup_key_t<K> &key = x;
+    auto s = find_key_(key, hash_(key));
+    if (s == table_type::npos) return end();
+    return begin() + d_table[s].d_index;
+  }
+
+  template <class K>
+  const_iterator find(const K &x) const {
+    return const_cast<unordered_map *>(this)->find(x);  // NOLINT
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range(const K &x) {
+    auto it = find(x);
+    return {it, it == end() ? it : std::next(it)};
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range(const K &x) const {
+    auto it = find(x);
+    return {it, it == end() ? it : std::next(it)};
+  }
+
+  /* Bucket interface */
+  size_type bucket_count() const noexcept { return d_table.capacity(); }
+
+  /* Hash policy */
+  float load_factor() const noexcept {
+    return empty() ? 0.0F
+                   : static_cast<float>(size()) /
+                         static_cast<float>(bucket_count());
+  }
+
+  float max_load_factor() const noexcept { return 0.875F; }
+
+  /*
+   * Resize the table to at least count slots, and enough for size()
+   */
+  void rehash(size_type count) {
+    size_type capacity = GROUP;
+    while (capacity < count || table_type::max_load(capacity) < size()) {
+      capacity *= 2;
+    }
+    if (capacity != bucket_count()) d_table.resize(capacity);
+  }
+
+  /*
+   * Make room for count elements without growing the table or the vector
+   */
+  void reserve(size_type count) {
+    d_values.reserve(count);
+    d_hashes.reserve(count);
+    if (count > table_type::max_load(bucket_count())) {
+      size_type capacity = std::max(bucket_count(), GROUP);
+      while (table_type::max_load(capacity) < count) capacity *= 2;
+      d_table.resize(capacity);
+    }
+  }
+
+  /* Observers */
+  hasher hash_function() const { return d_hash; }
+
+  key_equal key_eq() const { return d_equal; }
+
+ private:
+  template <class K>
+  std::uint64_t hash_(const K &key) const {
+    return detail::mix_hash(d_hash(key));
+  }
+
+  template <class K>
+  size_type find_key_(const K &key, std::uint64_t hash) const {
+    return d_table.find(hash, [&](const slot &s) {
+      return d_equal(d_values[s.d_index].first, key);
+    });
+  }
+
+  /* The slot that points at element index */
+  size_type find_slot_(size_type index) const noexcept {
+    return d_table.find(d_hashes[index],
+                        [index](const slot &s) { return s.d_index == index; });
+  }
+
+  /*
+   * k is only moved from, into the new element, once the search has missed
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_(K &&k, Args &&...args) {
+    const Key &key = k;
+    auto hash = hash_(key);
+    auto s = find_key_(key, hash);
+    if (s != table_type::npos) return {begin() + d_table[s].d_index, false};
+    if (size() >= table_type::max_load(bucket_count())) {
+      d_table.resize(bucket_count() ? bucket_count() * 2 : GROUP);
+    }
+    d_hashes.push_back(hash);
+    try {
+      d_values.emplace_back(
+          std::piecewise_construct, std::forward_as_tuple(std::forward<K>(k)),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+    } catch (...) {
+      d_hashes.pop_back();
+      throw;
+    }
+    d_table.insert(hash, slot{static_cast<std::uint32_t>(size() - 1), 0});
+    return {end() - 1, true};
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_(K &&k, M &&obj) {
+    auto res = try_emplace_(std::forward<K>(k), std::forward<M>(obj));
+    if (!res.second) res.first->second = std::forward<M>(obj);
+    return res;
+  }
+
+  template <class K>
+  size_type erase_(const K &x) {
+    const lookup_key_t<K> &key = x;
+    auto s = find_key_(key, hash_(key));
+    if (s == table_type::npos) return 0;
+    erase_slot_(s);
+    return 1;
+  }
+
+  /*
+   * Empty slot s, and take its element away by moving the last one over it.
+   * The key is const, so the element is rebuilt rather than assigned, and
+   * the move must not throw or the gap would be left destroyed.
+   */
+  void erase_slot_(size_type s) noexcept {
+    static_assert(std::is_nothrow_move_constructible_v<Key> &&
+                      std::is_nothrow_move_constructible_v<T>,
+                  "erasing moves the last element into the gap");
+    auto index = d_table[s].d_index;
+    d_table.erase(s);
+    auto last = size() - 1;
+    if (index != last) {
+      d_table[find_slot_(last)].d_index = index;
+      d_hashes[index] = d_hashes[last];
+      // The last element is about to be destroyed, so its key can be moved
+      auto alloc = d_values.get_allocator();
+      auto &from = d_values[last];
+      auto *to = std::addressof(d_values[index]);
+      alloc_traits::destroy(alloc, to);
+      alloc_traits::construct(alloc, to,
+                              std::move(const_cast<Key &>(from.first)),
+                              std::move(from.second));
+    }
+    d_values.pop_back();
+    d_hashes.pop_back();
+  }
+
+  Hash d_hash;
+  KeyEqual d_equal;
+  values_type d_values;
+  hashes_type d_hashes;
+  table_type d_table;
+};
+
+template <class Key, class T, class Hash, class KeyEqual, class Alloc>
+bool operator==(const unordered_map<Key, T, Hash, KeyEqual, Alloc> &lhs,
+                const unordered_map<Key, T, Hash, KeyEqual, Alloc> &rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  for (const auto &e : lhs) {
+    auto it = rhs.find(e.first);
+    if (it == rhs.end() || !(it->second == e.second)) return false;
+  }
+  return true;
+}
+
+template <class Key, class T, class Hash, class KeyEqual, class Alloc>
+bool operator!=(const unordered_map<Key, T, Hash, KeyEqual, Alloc> &lhs,
+                const unordered_map<Key, T, Hash, KeyEqual, Alloc> &rhs) {
+  return !(lhs == rhs);
+}
+}  // namespace wijagels
@@ -581,16 +581,20 @@ class vector {
   void resize(size_type sz, const T &c) {
     if (sz < d_size) {
       for (size_type i = sz; i < d_size; ++i) {
-        destroy_one(&d_buffer_p[i]);
+        destroy_one_(&d_buffer_p[i]);
       }
+      d_size = sz;
       return;
     }
+    reserve(sz);
     while (d_size < sz) {
       push_back(c);
     }
   }
 
-  void reserve(size_type n) { change_capacity_(n); }
+  void reserve(size_type n) {
+    if (n > capacity()) change_capacity_(n);
+  }
 
   void shrink_to_fit() {
     if (size() < capacity() / 2) {
@@ -0,0 +1,451 @@
+// Copyright 2017 William Jagels
+#pragma once
+#include "SkipList.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace wijagels {
+/*
+ * Ordered set that keeps every write as a new version stamped with a sequence
+ * number, in the manner of LevelDB's memtable.
+ * Versions of an element sit next to each other in one skiplist, newest
+ * first, and erasure writes a tombstone instead of unlinking anything.
+ * snapshot() pins the current sequence and returns a read view that only
+ * sees the versions that were current at that point, while writes go on.
+ * Versions no reader can see any more are dropped as soon as the element is
+ * written again, and by gc() for elements that were not.
+ * Like skiplist this is not thread safe, writers and readers must be
+ * serialized by the caller.
+ */
+template <typename T, class Compare = std::less<T>,
+          class Allocator = std::allocator<T>>
+class versioned_skiplist {
+ public:
+  /* Aliases */
+  using value_type = T;
+  using value_compare = Compare;
+  using size_type = std::size_t;
+  using sequence_type = std::uint64_t;
+  using const_reference = const value_type &;
+
+  /* Readers at this sequence see every write */
+  static constexpr sequence_type LATEST =
+      std::numeric_limits<sequence_type>::max();
+
+ private:
+  struct entry {
+    T d_value;
+    sequence_type d_seq;
+    bool d_tombstone;
+  };
+
+  /* Search key for the newest version of key at or before d_seq */
+  template <class K>
+  struct probe {
+    const K &d_key;
+    sequence_type d_seq;
+  };
+
+  /* Orders by value, then newest version first */
+  struct entry_compare {
+    using is_transparent = void;  // Searches go by probe
+    Compare d_comp;
+
+    bool operator()(const entry &lhs, const entry &rhs) const {
+      if (d_comp(lhs.d_value, rhs.d_value)) return true;
+      return !d_comp(rhs.d_value, lhs.d_value) && lhs.d_seq > rhs.d_seq;
+    }
+
+    template <class K>
+    bool operator()(const entry &lhs, const probe<K> &rhs) const {
+      if (d_comp(lhs.d_value, rhs.d_key)) return true;
+      return !d_comp(rhs.d_key, lhs.d_value) && lhs.d_seq > rhs.d_seq;
+    }
+
+    template <class K>
+    bool operator()(const probe<K> &lhs, const entry &rhs) const {
+      if (d_comp(lhs.d_key, rhs.d_value)) return true;
+      return !d_comp(rhs.d_value, lhs.d_key) && lhs.d_seq > rhs.d_seq;
+    }
+  };
+
+  using entry_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<entry>;
+  using list_type = skiplist<entry, entry_compare, entry_allocator>;
+  using list_iterator = typename list_type::iterator;
+  using list_const_iterator = typename list_type::const_iterator;
+
+ public:
+  /*
+   * Visits the elements visible at one sequence number, skipping newer
+   * versions, older shadowed versions and erased elements
+   */
+  class const_iterator {
+    friend versioned_skiplist;
+    const versioned_skiplist *d_owner_p;
+    list_const_iterator d_it;
+    sequence_type d_seq;
+
+    const_iterator(const versioned_skiplist *owner, list_const_iterator it,
+                   sequence_type seq)
+        : d_owner_p{owner}, d_it{it}, d_seq{seq} {}
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+    using pointer = const T *;
+    using reference = const T &;
+    using iterator_category = std::forward_iterator_tag;
+
+    const_iterator() noexcept : d_owner_p{nullptr}, d_it{}, d_seq{0} {}
+
+    reference operator*() const { return d_it->d_value; }
+
+    pointer operator->() const { return std::addressof(d_it->d_value); }
+
+    const_iterator &operator++() {
+      d_it = d_owner_p->visible_(d_owner_p->skip_versions_(d_it), d_seq);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      return d_it == other.d_it;
+    }
+
+    bool operator!=(const const_iterator &other) const {
+      return d_it != other.d_it;
+    }
+  };
+  using iterator = const_iterator;
+
+  /*
+   * Read view pinned at the sequence number it was taken at.
+   * Copies share the pin, the versions it sees are kept until the last copy
+   * is gone. Must not outlive the list.
+   */
+  class snapshot_type {
+    friend versioned_skiplist;
+    versioned_skiplist *d_owner_p;
+    sequence_type d_seq;
+
+    snapshot_type(versioned_skiplist *owner, sequence_type seq)
+        : d_owner_p{owner}, d_seq{seq} {
+      d_owner_p->pin_(d_seq);
+    }
+
+   public:
+    snapshot_type(const snapshot_type &other)
+        : snapshot_type{other.d_owner_p, other.d_seq} {}
+
+    snapshot_type &operator=(const snapshot_type &other) {
+      if (this == &other) return *this;
+      other.d_owner_p->pin_(other.d_seq);
+      d_owner_p->unpin_(d_seq);
+      d_owner_p = other.d_owner_p;
+      d_seq = other.d_seq;
+      return *this;
+    }
+
+    ~snapshot_type() { d_owner_p->unpin_(d_seq); }
+
+    sequence_type sequence() const noexcept { return d_seq; }
+
+    const_iterator begin() const { return d_owner_p->begin_(d_seq); }
+    const_iterator end() const { return d_owner_p->end(); }
+
+    template <class K>
+    const_iterator find(const K &key) const {
+      return d_owner_p->find_(key, d_seq);
+    }
+
+    template <class K>
+    bool contains(const K &key) const {
+      return find(key) != end();
+    }
+
+    template <class K>
+    const_iterator lower_bound(const K &key) const {
+      return d_owner_p->lower_bound_(key, d_seq);
+    }
+
+    template <class K>
+    const_iterator upper_bound(const K &key) const {
+      return d_owner_p->upper_bound_(key, d_seq);
+    }
+  };
+
+ private:
+  bool same_key_(const entry &lhs, const entry &rhs) const {
+    return !d_comp(lhs.d_value, rhs.d_value);
+  }
+
+  /* First entry of the next element */
+  list_const_iterator skip_versions_(list_const_iterator it) const {
+    auto &first = *it;
+    for (++it; it != d_list.end() && same_key_(first, *it);) ++it;
+    return it;
+  }
+
+  /* First entry at or after it that a reader at seq sees */
+  list_const_iterator visible_(list_const_iterator it,
+                               sequence_type seq) const {
+    while (it != d_list.end()) {
+      if (it->d_seq > seq) {
+        ++it;  // Too new, the next one is older or another element
+      } else if (it->d_tombstone) {
+        it = skip_versions_(it);
+      } else {
+        break;
+      }
+    }
+    return it;
+  }
+
+  const_iterator begin_(sequence_type seq) const {
+    return const_iterator{this, visible_(d_list.begin(), seq), seq};
+  }
+
+  template <class K>
+  const_iterator find_(const K &key, sequence_type seq) const {
+    auto it = d_list.lower_bound(probe<K>{key, seq});
+    if (it == d_list.end() || it->d_tombstone || d_comp(key, it->d_value)) {
+      return end();
+    }
+    return const_iterator{this, it, seq};
+  }
+
+  template <class K>
+  const_iterator lower_bound_(const K &key, sequence_type seq) const {
+    auto it = d_list.lower_bound(probe<K>{key, seq});
+    return const_iterator{this, visible_(it, seq), seq};
+  }
+
+  /* Sequence numbers start at 1, so (key, 0) sorts after all of key */
+  template <class K>
+  const_iterator upper_bound_(const K &key, sequence_type seq) const {
+    auto it = d_list.lower_bound(probe<K>{key, 0});
+    return const_iterator{this, visible_(it, seq), seq};
+  }
+
+  void pin_(sequence_type seq) {
+    ++d_snapshots[seq];
+    d_gc_horizon = std::min(d_gc_horizon, seq);
+  }
+
+  /*
+   * Sweep once shadowed versions outnumber the live elements, but only if
+   * the sweep can free what the last one could not: the oldest reader has
+   * moved on since, or the list has doubled. A long lived snapshot then
+   * costs an amortized sweep rather than one per release of a newer one.
+   */
+  void unpin_(sequence_type seq) {
+    auto it = d_snapshots.find(seq);
+    if (--it->second) return;
+    d_snapshots.erase(it);
+    if (d_list.size() <= 2 * d_live) return;
+    if (oldest_reader_() > d_gc_horizon || d_list.size() >= 2 * d_gc_size) {
+      gc();
+    }
+  }
+
+  /* Sequence of the oldest snapshot, LATEST without any */
+  sequence_type oldest_reader_() const {
+    return d_snapshots.empty() ? LATEST : d_snapshots.begin()->first;
+  }
+
+  /* Whether some reader sees the version written at seq, replaced at next */
+  bool visible_to_reader_(sequence_type seq, sequence_type next) const {
+    auto it = d_snapshots.lower_bound(seq);
+    return it != d_snapshots.end() && it->first < next;
+  }
+
+  /*
+   * Drop the versions of an element that no reader can see, it points at
+   * the newest one. Returns the first entry of the next element.
+   * The newest version is what new readers see so it stays, unless it and
+   * everything kept below it are tombstones, which no reader can tell apart
+   * from the element being absent.
+   */
+  list_iterator prune_(list_iterator it) {
+    auto first = it;
+    auto next = it->d_seq;
+    auto dead = d_list.end();  // Start of the trailing run of tombstones
+    for (++it; it != d_list.end() && same_key_(*first, *it);) {
+      if (!visible_to_reader_(it->d_seq, next)) {
+        next = it->d_seq;
+        it = d_list.erase(it);
+        continue;
+      }
+      next = it->d_seq;
+      if (!it->d_tombstone) {
+        dead = d_list.end();
+      } else if (dead == d_list.end()) {
+        dead = it;
+      }
+      ++it;
+    }
+    auto older = std::next(first);
+    if (first->d_tombstone && (older == it || dead == older)) dead = first;
+    if (dead != d_list.end()) d_list.erase(dead, it);
+    return it;
+  }
+
+ public:
+  /* Constructors */
+  versioned_skiplist() : versioned_skiplist{Compare{}} {}
+
+  explicit versioned_skiplist(const Compare &comp,
+                              const Allocator &alloc = Allocator{})
+      : d_comp{comp}, d_list{entry_compare{comp}, entry_allocator{alloc}} {}
+
+  versioned_skiplist(std::initializer_list<value_type> init,
+                     const Compare &comp = Compare{},
+                     const Allocator &alloc = Allocator{})
+      : versioned_skiplist{comp, alloc} {
+    for (auto &e : init) insert(e);
+  }
+
+  /* Snapshots point back at the list, so it stays put */
+  versioned_skiplist(const versioned_skiplist &) = delete;
+  versioned_skiplist &operator=(const versioned_skiplist &) = delete;
+
+  ~versioned_skiplist() = default;
+
+  /* Iterators, over the latest versions */
+  const_iterator begin() const { return begin_(LATEST); }
+  const_iterator end() const {
+    return const_iterator{this, d_list.end(), LATEST};
+  }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  /* Capacity */
+  bool empty() const noexcept { return d_live == 0; }
+
+  /* Elements visible to new readers */
+  size_type size() const noexcept { return d_live; }
+
+  /* Entries stored, including old versions and tombstones */
+  size_type version_count() const noexcept { return d_list.size(); }
+
+  /* Modifiers */
+
+  /*
+   * Write a new version of value, replacing any equivalent element for new
+   * readers. Returns true if no equivalent element was visible before.
+   * Iterators over the latest versions that point at the replaced element
+   * are invalidated, iterators of snapshots are not.
+   */
+  bool insert(const value_type &value) {
+    return write_(entry{value, d_seq + 1, false});
+  }
+
+  bool insert(value_type &&value) {
+    return write_(entry{std::move(value), d_seq + 1, false});
+  }
+
+  /*
+   * Write a tombstone for key, returns the number of elements erased.
+   * Snapshots taken before still see the element.
+   */
+  template <class K>
+  size_type erase(const K &key) {
+    auto it = find_(key, LATEST);
+    if (it == end()) return 0;
+    write_(entry{*it, d_seq + 1, true});
+    return 1;
+  }
+
+  /*
+   * Drop every version no reader can see any more.
+   * Returns the number of entries removed.
+   */
+  size_type gc() {
+    auto before = d_list.size();
+    for (auto it = d_list.begin(); it != d_list.end();) it = prune_(it);
+    d_gc_horizon = oldest_reader_();
+    d_gc_size = d_list.size();
+    return before - d_list.size();
+  }
+
+  void clear() {
+    d_list.clear();
+    d_live = 0;
+    d_gc_size = 0;
+  }
+
+  /* Read view of the current state */
+  snapshot_type snapshot() { return snapshot_type{this, d_seq}; }
+
+  /* Lookup, at the latest version */
+  template <class K>
+  const_iterator find(const K &key) const {
+    return find_(key, LATEST);
+  }
+
+  template <class K>
+  bool contains(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <class K>
+  size_type count(const K &key) const {
+    return contains(key);
+  }
+
+  template <class K>
+  const_iterator lower_bound(const K &key) const {
+    return lower_bound_(key, LATEST);
+  }
+
+  template <class K>
+  const_iterator upper_bound(const K &key) const {
+    return upper_bound_(key, LATEST);
+  }
+
+  /* Observers */
+  value_compare value_comp() const { return d_comp; }
+
+  /* Sequence number of the last write */
+  sequence_type sequence() const noexcept { return d_seq; }
+
+ private:
+  bool write_(entry &&e) {
+    auto tombstone = e.d_tombstone;
+    auto it = d_list.insert(std::move(e)).first;
+    ++d_seq;
+    auto older = std::next(it);
+    bool existed = older != d_list.end() && same_key_(*it, *older) &&
+                   !older->d_tombstone;
+    if (!tombstone && !existed) ++d_live;
+    if (tombstone) --d_live;
+    prune_(it);
+    return !existed;
+  }
+
+  Compare d_comp;
+  list_type d_list;
+  sequence_type d_seq = 0;
+  size_type d_live = 0;
+  std::map<sequence_type, size_type> d_snapshots;
+  // Oldest sequence a reader has held, and the entries left, since the last
+  // sweep
+  sequence_type d_gc_horizon = LATEST;
+  size_type d_gc_size = 0;
+};
+
+}  // namespace wijagels
@@ -0,0 +1,276 @@
+#include "BlockSkipList.hpp"
+#include "Map.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using test_helpers::same_contents;
+using wijagels::block_skiplist;
+
+namespace {
+/* Small blocks so a few hundred elements already split and merge a lot */
+template <typename T>
+using small_block_skiplist = block_skiplist<T, std::less<T>, std::allocator<T>,
+                                            wijagels::block_lines<1>>;
+
+/* Counts the blocks a list holds, every allocation is one */
+long g_live_allocations = 0;
+
+template <typename T>
+struct counting_allocator {
+  using value_type = T;
+
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &) {}  // NOLINT
+
+  T *allocate(size_t n) {
+    g_live_allocations++;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *p, size_t n) {
+    g_live_allocations--;
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const counting_allocator<U> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const counting_allocator<U> &) const {
+    return false;
+  }
+};
+}  // namespace
+
+TEST(block_skiplist_test, insert_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  std::mt19937 gen{};
+  for (int i = 0; i < 2000; i++) {
+    int key = static_cast<int>(gen() % 1000);
+    auto pos = list.insert(key);
+    EXPECT_EQ(pos.second, result.insert(key).second);
+    EXPECT_EQ(*pos.first, key);
+  }
+  EXPECT_TRUE(same_contents(list, result));
+}
+
+TEST(block_skiplist_test, ascending_insert_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  for (int i = 0; i < 1000; i++) {
+    list.insert(list.end(), i);
+    result.insert(i);
+  }
+  EXPECT_TRUE(same_contents(list, result));
+  EXPECT_EQ(*list.nth(999), 999);
+}
+
+TEST(block_skiplist_test, erase_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  for (int i = 0; i < 1000; i++) {
+    list.insert(i);
+    result.insert(i);
+  }
+  std::mt19937 gen{};
+  for (int i = 0; i < 900; i++) {
+    auto n = gen() % result.size();
+    auto it = list.erase(list.nth(n));
+    auto expected = result.erase(std::next(result.begin(), n));
+    if (expected == result.end()) {
+      EXPECT_TRUE(it == list.end());
+    } else {
+      EXPECT_EQ(*it, *expected);
+    }
+  }
+  EXPECT_TRUE(same_contents(list, result));
+  EXPECT_EQ(list.erase(*result.begin()), 1);
+  EXPECT_EQ(list.erase(-1), 0);
+}
+
+TEST(block_skiplist_test, range_erase_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  for (int i = 0; i < 500; i++) {
+    list.insert(i);
+    result.insert(i);
+  }
+  auto it = list.erase(list.find(10), list.find(400));
+  EXPECT_EQ(*it, 400);
+  result.erase(result.find(10), result.find(400));
+  EXPECT_TRUE(same_contents(list, result));
+  it = list.erase(list.find(420), list.end());
+  EXPECT_TRUE(it == list.end());
+  result.erase(result.find(420), result.end());
+  EXPECT_TRUE(same_contents(list, result));
+}
+
+TEST(block_skiplist_test, range_erase_merge_test) {  // NOLINT
+  using list_type = block_skiplist<int, std::less<int>, counting_allocator<int>,
+                                   wijagels::block_lines<1>>;
+  static_assert(list_type::CAPACITY == 16);
+  std::vector<int> nums(64);
+  std::iota(nums.begin(), nums.end(), 0);
+  std::set<int> result{nums.begin(), nums.end()};
+  {
+    // Four full blocks, the range leaves one element of the first and eight
+    // of the third, which fit in one block together
+    list_type list{wijagels::sorted_unique, nums.begin(), nums.end()};
+    auto blocks = g_live_allocations;
+    auto it = list.erase(list.find(1), list.find(40));
+    EXPECT_EQ(*it, 40);
+    result.erase(result.find(1), result.find(40));
+    EXPECT_TRUE(same_contents(list, result));
+    EXPECT_EQ(g_live_allocations, blocks - 2);
+    EXPECT_EQ(list.rank(63), 24);
+  }
+  EXPECT_EQ(g_live_allocations, 0);
+}
+
+TEST(block_skiplist_test, index_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  std::mt19937 gen{};
+  for (int i = 0; i < 1000; i++) {
+    int key = static_cast<int>(gen() % 4000);
+    list.insert(key);
+    result.insert(key);
+  }
+  size_t i = 0;
+  for (auto e : result) {
+    EXPECT_EQ(*list.nth(i), e);
+    EXPECT_EQ(list.rank(e), i);
+    EXPECT_EQ(distance(list.begin(), list.find(e)), i);
+    ++i;
+  }
+  EXPECT_TRUE(list.nth(i) == list.end());
+}
+
+TEST(block_skiplist_test, bounds_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  for (int i = 0; i < 600; i += 3) {
+    list.insert(i);
+    result.insert(i);
+  }
+  for (int key = -1; key < 602; key++) {
+    auto lower = result.lower_bound(key);
+    auto upper = result.upper_bound(key);
+    if (lower == result.end()) {
+      EXPECT_TRUE(list.lower_bound(key) == list.end());
+    } else {
+      EXPECT_EQ(*list.lower_bound(key), *lower);
+    }
+    if (upper == result.end()) {
+      EXPECT_TRUE(list.upper_bound(key) == list.end());
+    } else {
+      EXPECT_EQ(*list.upper_bound(key), *upper);
+    }
+    EXPECT_EQ(list.find(key) != list.end(), result.count(key) == 1);
+  }
+}
+
+TEST(block_skiplist_test, copy_move_swap_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  std::set<int> result;
+  for (int i = 0; i < 300; i++) {
+    list.insert(i * 7 % 300);
+    result.insert(i);
+  }
+  auto copy = list;
+  EXPECT_TRUE(same_contents(copy, result));
+  auto moved = std::move(copy);
+  EXPECT_TRUE(same_contents(moved, result));
+  EXPECT_TRUE(copy.empty());
+  copy.insert(1);
+  copy.swap(moved);
+  EXPECT_TRUE(same_contents(copy, result));
+  EXPECT_TRUE(same_contents(moved, {1}));
+  EXPECT_TRUE(copy == list);
+}
+
+TEST(block_skiplist_test, set_algebra_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  small_block_skiplist<int> other;
+  for (int i = 0; i < 200; i++) {
+    list.insert(i * 2);
+    other.insert(i * 3);
+  }
+  auto both = list;
+  both.set_union(other);
+  EXPECT_EQ(both.size(), 200 + 200 - 67);
+  auto common = list;
+  common.set_intersection(other);
+  EXPECT_EQ(common.size(), 67);
+  EXPECT_EQ(*common.nth(1), 6);
+  auto rest = list;
+  rest.set_difference(other);
+  EXPECT_EQ(rest.size(), 200 - 67);
+  list.merge(other);
+  EXPECT_TRUE(list == both);
+  EXPECT_EQ(other.size(), 67);
+}
+
+TEST(block_skiplist_test, split_join_test) {  // NOLINT
+  small_block_skiplist<int> list;
+  for (int i = 0; i < 300; i++) list.insert(i);
+  auto tail = list.split(100);
+  EXPECT_EQ(list.size(), 100);
+  EXPECT_EQ(tail.size(), 200);
+  EXPECT_EQ(*tail.begin(), 100);
+  tail.join(list);
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(tail.size(), 300);
+  EXPECT_EQ(tail.rank(150), 150);
+}
+
+TEST(block_skiplist_test, string_test) {  // NOLINT
+  block_skiplist<std::string> list;
+  std::set<std::string> result;
+  for (int i = 0; i < 1000; i++) {
+    auto key = std::to_string(i * 7919 % 1009);
+    list.insert(key);
+    result.insert(key);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    auto key = std::to_string(i * 7919 % 1009);
+    EXPECT_EQ(list.erase(key), result.erase(key));
+  }
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), result.begin(),
+                         result.end()));
+  auto nh = list.extract(list.begin());
+  EXPECT_FALSE(nh.empty());
+  EXPECT_EQ(list.size(), result.size() - 1);
+  EXPECT_TRUE(list.insert(std::move(nh)).inserted);
+  EXPECT_EQ(*list.begin(), *result.begin());
+}
+
+TEST(block_skiplist_test, map_container_test) {  // NOLINT
+  using block_map =
+      wijagels::map<int, int, std::less<int>,
+                    std::allocator<std::pair<const int, int>>, block_skiplist>;
+  block_map m{{2, 4}, {6, 8}};
+  m[4] = 16;
+  m.try_emplace(1, 1);
+  m.insert_or_assign(6, 36);
+  EXPECT_EQ(m.size(), 4);
+  EXPECT_EQ(m.at(6), 36);
+  EXPECT_EQ(m.nth(2)->first, 4);
+  EXPECT_EQ(m.rank(5), 3);
+  auto nh = m.extract(m.find(2));
+  EXPECT_EQ(nh.key(), 2);
+  EXPECT_EQ(nh.mapped(), 4);
+  m.insert(std::move(nh));
+  EXPECT_EQ(m.at(2), 4);
+  m.erase(1);
+  EXPECT_EQ(m.begin()->first, 2);
+}
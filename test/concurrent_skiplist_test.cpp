@@ -0,0 +1,118 @@
+#include "ConcurrentSkipList.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using wijagels::concurrent_skiplist;
+
+namespace {
+template <typename T, class Compare>
+std::vector<T> contents(concurrent_skiplist<T, Compare> &list) {
+  std::vector<T> out;
+  list.for_each([&out](const T &e) { out.push_back(e); });
+  return out;
+}
+
+unsigned thread_count() {
+  return std::max(4u, std::thread::hardware_concurrency());
+}
+}  // namespace
+
+TEST(concurrent_skiplist_test, basic_test) {  // NOLINT
+  concurrent_skiplist<int> list{5, 1, 4, 2, 3};
+  EXPECT_EQ(5, list.size());
+  EXPECT_FALSE(list.insert(3));
+  EXPECT_TRUE(list.contains(4));
+  EXPECT_FALSE(list.contains(6));
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), contents(list));
+  EXPECT_TRUE(list.erase(3));
+  EXPECT_FALSE(list.erase(3));
+  EXPECT_FALSE(list.contains(3));
+  EXPECT_EQ(4, list.size());
+  EXPECT_EQ(std::vector<int>({1, 2, 4, 5}), contents(list));
+  EXPECT_TRUE(list.insert(3));
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), contents(list));
+}
+
+TEST(concurrent_skiplist_test, find_test) {  // NOLINT
+  concurrent_skiplist<std::string, std::less<>> list;
+  list.emplace("foo");
+  list.insert(std::string{"bar"});
+  EXPECT_EQ("foo", list.find("foo").value());
+  EXPECT_FALSE(list.find("baz").has_value());
+  EXPECT_TRUE(list.erase("bar"));
+  EXPECT_FALSE(list.find("bar").has_value());
+}
+
+TEST(concurrent_skiplist_test, concurrent_insert_test) {  // NOLINT
+  concurrent_skiplist<int> list;
+  const int per_thread = 10000;
+  auto threads = thread_count();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&list, t, threads] {
+      // Interleave keys so every thread contends on the same region
+      for (int i = 0; i < per_thread; i++) list.insert(i * threads + t);
+    });
+  }
+  for (auto &w : workers) w.join();
+  ASSERT_EQ(per_thread * threads, list.size());
+  auto elements = contents(list);
+  ASSERT_EQ(per_thread * threads, elements.size());
+  for (size_t i = 0; i < elements.size(); i++) ASSERT_EQ(i, elements[i]);
+}
+
+TEST(concurrent_skiplist_test, concurrent_duplicate_test) {  // NOLINT
+  concurrent_skiplist<int> list;
+  std::atomic<int> inserted{0};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < thread_count(); t++) {
+    workers.emplace_back([&] {
+      for (int i = 0; i < 5000; i++) inserted += list.insert(i);
+    });
+  }
+  for (auto &w : workers) w.join();
+  EXPECT_EQ(5000, inserted);
+  EXPECT_EQ(5000, list.size());
+}
+
+TEST(concurrent_skiplist_test, concurrent_mixed_test) {  // NOLINT
+  concurrent_skiplist<int> list;
+  const int range = 512;
+  std::vector<std::thread> workers;
+  std::vector<int> balance(thread_count() * range);
+  for (unsigned t = 0; t < thread_count(); t++) {
+    workers.emplace_back([&list, &balance, t] {
+      std::mt19937 gen{t};
+      std::uniform_int_distribution<> key{0, range - 1};
+      std::uniform_int_distribution<> op{0, 2};
+      for (int i = 0; i < 20000; i++) {
+        auto k = key(gen);
+        switch (op(gen)) {
+          case 0:
+            balance[t * range + k] += list.insert(k);
+            break;
+          case 1:
+            balance[t * range + k] -= list.erase(k);
+            break;
+          default:
+            list.contains(k);
+        }
+      }
+    });
+  }
+  for (auto &w : workers) w.join();
+  // Successful inserts minus successful erases must match what is left
+  std::set<int> expected;
+  for (int k = 0; k < range; k++) {
+    int net = 0;
+    for (unsigned t = 0; t < thread_count(); t++) net += balance[t * range + k];
+    ASSERT_TRUE(net == 0 || net == 1);
+    if (net) expected.insert(k);
+  }
+  EXPECT_EQ(expected.size(), list.size());
+  EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), contents(list));
+}
@@ -0,0 +1,256 @@
+#include "FlatMap.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using test_helpers::same_contents;
+using wijagels::flat_map;
+
+namespace {
+/* Copies throw once the countdown runs out, moves are not noexcept */
+struct fragile {
+  static int s_copies_left;
+  int d_value;
+
+  explicit fragile(int value) : d_value{value} {}
+  fragile(const fragile &other) : d_value{other.d_value} {
+    if (s_copies_left-- == 0) throw std::runtime_error{"copy"};
+  }
+  fragile(fragile &&other) : d_value{other.d_value} {  // NOLINT
+    other.d_value = -1;
+  }
+  fragile &operator=(const fragile &) = default;
+  fragile &operator=(fragile &&) = default;
+};
+int fragile::s_copies_left = -1;
+
+/* Throws once the countdown runs out */
+struct fragile_less {
+  static int s_compares_left;
+  bool operator()(const std::string &lhs, const std::string &rhs) const {
+    if (s_compares_left-- == 0) throw std::runtime_error{"compare"};
+    return lhs < rhs;
+  }
+};
+int fragile_less::s_compares_left = -1;
+}  // namespace
+
+TEST(flat_map_test, insert_test) {  // NOLINT
+  flat_map<int, int> m;
+  EXPECT_TRUE(m.insert({3, 9}).second);
+  EXPECT_TRUE(m.insert({1, 1}).second);
+  EXPECT_FALSE(m.insert({3, 0}).second);
+  EXPECT_TRUE(m.emplace(2, 4).second);
+  EXPECT_EQ(m.size(), 3);
+  EXPECT_EQ(m.at(3), 9);
+  EXPECT_EQ(m.begin()->first, 1);
+  EXPECT_EQ((--m.end())->second, 9);
+  ASSERT_THROW(m.at(4), std::out_of_range);
+  auto hint = m.insert(m.end(), {5, 25});
+  EXPECT_EQ(hint->first, 5);
+  hint = m.insert(m.begin(), {4, 16});  // Wrong hint
+  EXPECT_EQ(hint->first, 4);
+  EXPECT_EQ(m.nth(3)->first, 4);
+}
+
+TEST(flat_map_test, index_test) {  // NOLINT
+  flat_map<std::string, int> m;
+  ++m["b"];
+  ++m["a"];
+  ++m["b"];
+  EXPECT_EQ(m.at("a"), 1);
+  EXPECT_EQ(m.at("b"), 2);
+  std::string key = "c";
+  m[std::move(key)] = 3;
+  EXPECT_EQ(m.keys()[2], "c");
+  EXPECT_EQ(m.values()[2], 3);
+}
+
+TEST(flat_map_test, upsert_test) {  // NOLINT
+  flat_map<int, std::string> m;
+  EXPECT_TRUE(m.try_emplace(1, 3, 'x').second);
+  EXPECT_FALSE(m.try_emplace(1, "y").second);
+  EXPECT_EQ(m.at(1), "xxx");
+  EXPECT_FALSE(m.insert_or_assign(1, "z").second);
+  EXPECT_EQ(m.at(1), "z");
+  auto it = m.insert_or_assign(m.end(), 2, "w");
+  EXPECT_EQ(it->second, "w");
+  it->second = "v";
+  EXPECT_EQ(m.at(2), "v");
+}
+
+TEST(flat_map_test, bulk_load_test) {  // NOLINT
+  std::vector<std::pair<int, int>> input{{5, 0}, {1, 0}, {3, 0}, {1, 1}};
+  flat_map<int, int> m{input.begin(), input.end()};
+  EXPECT_EQ(m.size(), 3);
+  EXPECT_EQ(m.at(1), 0);  // First of equal keys wins
+  EXPECT_TRUE(std::is_sorted(m.keys().begin(), m.keys().end()));
+  flat_map<int, int> sorted{wijagels::sorted_unique, m.begin(), m.end()};
+  EXPECT_TRUE(sorted == m);
+}
+
+TEST(flat_map_test, insert_range_test) {  // NOLINT
+  flat_map<int, int> m{{2, 2}, {4, 4}, {6, 6}};
+  std::vector<std::pair<int, int>> batch{{5, 5}, {4, 0}, {1, 1}, {5, 0}};
+  m.insert_range(batch);
+  std::map<int, int> result{{1, 1}, {2, 2}, {4, 4}, {5, 5}, {6, 6}};
+  EXPECT_TRUE(same_contents(m, result));
+  std::vector<std::pair<int, int>> tail{{9, 9}, {8, 8}};
+  m.insert_range(tail);
+  result.insert(tail.begin(), tail.end());
+  EXPECT_TRUE(same_contents(m, result));
+}
+
+TEST(flat_map_test, merge_throw_test) {  // NOLINT
+  flat_map<int, fragile> m;
+  for (int i = 0; i < 8; i += 2) m.try_emplace(i, i);
+  std::vector<std::pair<int, fragile>> batch;
+  for (int i = 1; i < 6; i += 2) batch.emplace_back(i, fragile{i});
+  // The batch copies go through, copying the map's elements over throws
+  fragile::s_copies_left = 5;
+  EXPECT_THROW(m.insert(batch.begin(), batch.end()), std::runtime_error);
+  fragile::s_copies_left = -1;
+  ASSERT_EQ(m.size(), 4);
+  for (auto e : m) EXPECT_EQ(e.first, e.second.d_value);
+  m.insert(batch.begin(), batch.end());
+  EXPECT_EQ(m.size(), 7);
+  for (auto e : m) EXPECT_EQ(e.first, e.second.d_value);
+}
+
+TEST(flat_map_test, merge_compare_throw_test) {  // NOLINT
+  // Keys that move without throwing, so the present elements are moved
+  flat_map<std::string, std::string, fragile_less> m;
+  for (char c : std::string{"bdfh"}) m.try_emplace(std::string(40, c), "x");
+  std::vector<std::pair<std::string, std::string>> batch{
+      {std::string(40, 'a'), "y"},
+      {std::string(40, 'c'), "y"},
+      {std::string(40, 'g'), "y"}};
+  fragile_less::s_compares_left = 4;
+  EXPECT_THROW(m.insert(wijagels::sorted_unique, batch.begin(), batch.end()),
+               std::runtime_error);
+  fragile_less::s_compares_left = -1;
+  ASSERT_EQ(m.size(), 4);
+  std::string expected = "bdfh";
+  for (size_t i = 0; i < m.size(); i++) {
+    EXPECT_EQ(m.keys()[i], std::string(40, expected[i]));
+    EXPECT_EQ(m.values()[i], "x");
+  }
+  m.insert(wijagels::sorted_unique, batch.begin(), batch.end());
+  EXPECT_EQ(m.size(), 7);
+  EXPECT_EQ(m.keys()[0], std::string(40, 'a'));
+}
+
+TEST(flat_map_test, compare_test) {  // NOLINT
+  flat_map<int, int> a{{1, 0}, {2, 5}};
+  flat_map<int, int> b{{1, 0}, {3, 0}};
+  EXPECT_TRUE(a < b);
+  EXPECT_FALSE(b < a);
+  // Ordered by the map's own comparator, on keys
+  flat_map<int, int, std::greater<>> c{{1, 0}};
+  flat_map<int, int, std::greater<>> d{{2, 0}};
+  EXPECT_TRUE(d < c);
+  EXPECT_FALSE(c < d);
+  // Equal keys fall back to the mapped values, in step with ==
+  a.erase(2);
+  b.erase(3);
+  b[1] = 9;
+  EXPECT_TRUE(a < b);
+  EXPECT_FALSE(b < a);
+  EXPECT_FALSE(a <= b && a >= b);
+  b[1] = 0;
+  EXPECT_TRUE(a == b);
+  EXPECT_TRUE(a <= b && a >= b);
+  EXPECT_FALSE(a < b);
+  b[2] = 0;
+  EXPECT_TRUE(a < b);
+}
+
+TEST(flat_map_test, erase_test) {  // NOLINT
+  flat_map<int, int> m{{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  auto it = m.erase(m.find(2), m.find(4));
+  EXPECT_EQ(it->first, 4);
+  EXPECT_EQ(m.erase(1), 1);
+  EXPECT_EQ(m.erase(1), 0);
+  it = m.erase(m.begin());
+  EXPECT_EQ(it, m.end());
+  EXPECT_TRUE(m.empty());
+}
+
+TEST(flat_map_test, bounds_test) {  // NOLINT
+  flat_map<int, int> m{{10, 0}, {20, 0}, {30, 0}};
+  EXPECT_EQ(m.lower_bound(20)->first, 20);
+  EXPECT_EQ(m.upper_bound(20)->first, 30);
+  EXPECT_EQ(m.lower_bound(5)->first, 10);
+  EXPECT_EQ(m.upper_bound(30), m.end());
+  auto range = m.equal_range(25);
+  EXPECT_EQ(range.first, range.second);
+  range = m.equal_range(30);
+  EXPECT_EQ(std::distance(range.first, range.second), 1);
+  EXPECT_EQ(m.rank(25), 2);
+  EXPECT_EQ(m.count(10), 1);
+  EXPECT_FALSE(m.contains(11));
+  flat_map<int, int> empty;
+  EXPECT_EQ(empty.lower_bound(1), empty.end());
+  EXPECT_EQ(empty.find(1), empty.end());
+}
+
+TEST(flat_map_test, transparent_test) {  // NOLINT
+  flat_map<std::string, int, std::less<>> m{{"apple", 1}, {"banana", 2}};
+  std::string_view key = "banana";
+  EXPECT_EQ(m.find(key)->second, 2);
+  EXPECT_EQ(m.lower_bound("b")->first, "banana");
+  EXPECT_EQ(m.erase(key), 1);
+  EXPECT_EQ(m.size(), 1);
+}
+
+TEST(flat_map_test, iterator_test) {  // NOLINT
+  flat_map<int, int> m{{1, 1}, {2, 4}, {3, 9}};
+  const auto &c = m;
+  flat_map<int, int>::const_iterator it = m.begin();
+  EXPECT_EQ(it, c.begin());
+  EXPECT_EQ(c.end() - it, 3);
+  EXPECT_EQ(it[2].second, 9);
+  EXPECT_EQ(m.rbegin()->first, 3);
+  std::vector<int> keys;
+  for (auto rit = c.rbegin(); rit != c.rend(); ++rit) {
+    keys.push_back(rit->first);
+  }
+  EXPECT_EQ(keys, (std::vector<int>{3, 2, 1}));
+}
+
+TEST(flat_map_test, random_test) {  // NOLINT
+  std::mt19937 gen{7};
+  std::uniform_int_distribution<int> dist{0, 500};
+  flat_map<int, int> m;
+  std::map<int, int> result;
+  for (int round = 0; round < 50; round++) {
+    std::vector<std::pair<int, int>> batch;
+    for (int i = 0; i < 20; i++) batch.emplace_back(dist(gen), round);
+    m.insert(batch.begin(), batch.end());
+    result.insert(batch.begin(), batch.end());
+    for (int i = 0; i < 10; i++) {
+      int key = dist(gen);
+      EXPECT_EQ(m.erase(key), result.erase(key));
+      m.try_emplace(key + 1, round);
+      result.try_emplace(key + 1, round);
+    }
+    ASSERT_TRUE(same_contents(m, result));
+  }
+  for (int key = -1; key <= 502; key++) {
+    auto lb = result.lower_bound(key);
+    auto it = m.lower_bound(key);
+    if (lb == result.end()) {
+      EXPECT_EQ(it, m.end());
+    } else {
+      EXPECT_EQ(it->first, lb->first);
+    }
+    EXPECT_EQ(m.upper_bound(key) - m.begin(),
+              std::distance(result.begin(), result.upper_bound(key)));
+  }
+}
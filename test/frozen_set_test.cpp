@@ -0,0 +1,105 @@
+#include "FrozenSet.hpp"
+#include "Map.hpp"
+#include "SkipList.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using wijagels::frozen_set;
+
+namespace {
+/* Every bound of every key in and around the set against std::set */
+template <class Set>
+bool same_lookups(const Set &set, const std::set<int> &result) {
+  if (!std::equal(set.begin(), set.end(), result.begin(), result.end())) {
+    return false;
+  }
+  int lo = result.empty() ? 0 : *result.begin() - 2;
+  int hi = result.empty() ? 0 : *result.rbegin() + 2;
+  for (int k = lo; k <= hi; k++) {
+    auto lower = std::distance(result.begin(), result.lower_bound(k));
+    auto upper = std::distance(result.begin(), result.upper_bound(k));
+    if (set.lower_bound(k) - set.begin() != lower) return false;
+    if (set.upper_bound(k) - set.begin() != upper) return false;
+    if (set.contains(k) != (result.count(k) == 1)) return false;
+  }
+  return true;
+}
+}  // namespace
+
+TEST(frozen_set_test, lookup_test) {  // NOLINT
+  std::mt19937 gen{5};
+  for (size_t size : {0, 1, 15, 16, 17, 100, 1000, 5000}) {
+    std::vector<int> input;
+    for (size_t i = 0; i < size; i++) input.push_back(gen() % (3 * size));
+    std::set<int> result{input.begin(), input.end()};
+    frozen_set<int> set{input.begin(), input.end()};
+    EXPECT_EQ(set.size(), result.size());
+    EXPECT_TRUE(same_lookups(set, result)) << size;
+  }
+  frozen_set<int> empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(empty.find(3) == empty.end());
+}
+
+TEST(frozen_set_test, large_element_test) {  // NOLINT
+  std::vector<std::string> words{"pear", "fig", "apple", "fig", "kiwi"};
+  frozen_set<std::string> set{words.begin(), words.end()};
+  EXPECT_EQ(set.size(), 4);
+  EXPECT_EQ(*set.begin(), "apple");
+  EXPECT_EQ(*set.lower_bound("g"), "kiwi");
+  EXPECT_TRUE(set.find("plum") == set.end());
+  EXPECT_EQ(set.rank("pear"), 3);
+  EXPECT_EQ(*set.rbegin(), "pear");
+}
+
+TEST(frozen_set_test, freeze_test) {  // NOLINT
+  std::set<int> result;
+  wijagels::skiplist<int> list;
+  for (int i = 0; i < 3000; i += 3) {
+    list.insert(i);
+    result.insert(i);
+  }
+  auto set = wijagels::freeze(list);
+  EXPECT_TRUE(same_lookups(set, result));
+  EXPECT_EQ(*set.nth(10), 30);
+
+  wijagels::map<int, std::string> m{{1, "one"}, {2, "two"}, {3, "three"}};
+  auto frozen = wijagels::freeze(m);
+  EXPECT_EQ(frozen.find(2)->second, "two");
+  EXPECT_TRUE(frozen.find(4) == frozen.end());
+  EXPECT_EQ(frozen.upper_bound(1)->first, 2);
+}
+
+TEST(frozen_set_test, file_test) {  // NOLINT
+  std::set<int> result;
+  for (int i = 0; i < 10000; i += 7) result.insert(i);
+  auto path = ::testing::TempDir() + "frozen_set_test.bin";
+  {
+    frozen_set<int> set{result.begin(), result.end()};
+    set.write(path);
+  }
+  auto mapped = frozen_set<int>::map_file(path);
+  EXPECT_TRUE(same_lookups(mapped, result));
+  auto copy = mapped;
+  mapped = frozen_set<int>{};
+  EXPECT_TRUE(same_lookups(copy, result));
+  EXPECT_THROW(frozen_set<long>::map_file(path), std::runtime_error);
+
+  wijagels::map<int, double> m{{1, 0.5}, {4, 2.0}};
+  auto map_path = ::testing::TempDir() + "frozen_map_test.bin";
+  wijagels::freeze(m).write(map_path);
+  auto frozen = wijagels::map<int, double>::frozen_type::map_file(
+      map_path, m.value_comp());
+  EXPECT_EQ(frozen.find(4)->second, 2.0);
+
+  auto bad_path = ::testing::TempDir() + "frozen_bad_test.bin";
+  std::ofstream{bad_path} << "garbage";
+  EXPECT_THROW(frozen_set<int>::map_file(bad_path), std::runtime_error);
+  EXPECT_THROW(frozen_set<int>::map_file(path + ".missing"),
+               std::system_error);
+}
@@ -0,0 +1,222 @@
+#include "IndexedMap.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using test_helpers::colliding_hash;
+using test_helpers::string_hash;
+using wijagels::indexed_map;
+
+namespace {
+/* Throws once the countdown runs out */
+struct fragile_less {
+  static int s_compares_left;
+  bool operator()(int lhs, int rhs) const {
+    if (s_compares_left-- == 0) throw std::runtime_error{"compare"};
+    return lhs < rhs;
+  }
+};
+int fragile_less::s_compares_left = -1;
+
+/* The index must lead every key back to the very node the ordered walk saw */
+template <class Map>
+bool same_nodes(const Map &m, const std::map<int, int> &result) {
+  if (!test_helpers::same_contents(m, result)) return false;
+  for (const auto &e : m) {
+    if (&*m.find(e.first) != &e) return false;
+  }
+  return true;
+}
+}  // namespace
+
+TEST(indexed_map_test, insert_test) {  // NOLINT
+  indexed_map<int, int> m;
+  EXPECT_EQ(m.find(1), m.end());
+  EXPECT_TRUE(m.insert({3, 9}).second);
+  EXPECT_TRUE(m.insert({1, 1}).second);
+  EXPECT_FALSE(m.insert({3, 0}).second);
+  EXPECT_TRUE(m.emplace(2, 4).second);
+  EXPECT_EQ(m.size(), 3);
+  EXPECT_EQ(m.at(3), 9);
+  EXPECT_EQ(m.begin()->first, 1);
+  EXPECT_EQ(m.rbegin()->first, 3);
+  ASSERT_THROW(m.at(4), std::out_of_range);
+  for (int i = 0; i < 1000; i++) m[i] += i;
+  EXPECT_EQ(m.size(), 1000);
+  EXPECT_EQ(m.at(3), 12);
+  EXPECT_EQ(m.nth(500)->first, 500);
+  EXPECT_LE(m.load_factor(), m.max_load_factor());
+}
+
+TEST(indexed_map_test, bulk_insert_test) {  // NOLINT
+  std::mt19937 gen{11};
+  std::uniform_int_distribution<int> dist{0, 3000};
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < 1000; i++) batch.emplace_back(dist(gen), i);
+  indexed_map<int, int> m{{5, -1}};
+  std::map<int, int> result{{5, -1}};
+  m.insert(batch.begin(), batch.end());  // Bulk, the map is smaller
+  result.insert(batch.begin(), batch.end());
+  EXPECT_TRUE(same_nodes(m, result));
+  batch.resize(10);
+  for (auto &p : batch) p = {dist(gen) + 5000, 0};
+  m.insert(batch.begin(), batch.end());  // One at a time
+  result.insert(batch.begin(), batch.end());
+  EXPECT_TRUE(same_nodes(m, result));
+}
+
+TEST(indexed_map_test, bulk_insert_throw_test) {  // NOLINT
+  indexed_map<int, int, std::hash<int>, std::equal_to<int>, fragile_less> m;
+  for (int i = 0; i < 100; i += 2) m.emplace(i, i);
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 1; i < 300; i += 2) batch.emplace_back(i, i);
+  // Late enough that the merge has linked part of the batch
+  fragile_less::s_compares_left = 1200;
+  EXPECT_THROW(m.insert(batch.begin(), batch.end()), std::runtime_error);
+  fragile_less::s_compares_left = -1;
+  EXPECT_GT(m.size(), 50);
+  // Whatever made it in is indexed
+  for (auto it = m.begin(); it != m.end(); ++it) {
+    ASSERT_EQ(m.find(it->first), it);
+  }
+  while (!m.empty()) m.erase(m.begin());
+  EXPECT_EQ(m.find(1), m.end());
+}
+
+TEST(indexed_map_test, upsert_test) {  // NOLINT
+  indexed_map<std::string, std::string> m;
+  EXPECT_TRUE(m.try_emplace("a", 3, 'x').second);
+  EXPECT_FALSE(m.try_emplace("a", "y").second);
+  EXPECT_EQ(m.at("a"), "xxx");
+  EXPECT_FALSE(m.insert_or_assign("a", "z").second);
+  EXPECT_EQ(m.at("a"), "z");
+  std::string key = "kept on a hit";
+  m.try_emplace(key, "1");
+  m.try_emplace(std::move(key), "2");
+  EXPECT_EQ(key, "kept on a hit");  // NOLINT
+  EXPECT_EQ(m.at(key), "1");
+}
+
+TEST(indexed_map_test, erase_test) {  // NOLINT
+  indexed_map<int, int> m;
+  for (int i = 0; i < 100; i++) m.emplace(i, i);
+  EXPECT_EQ(m.erase(50), 1);
+  EXPECT_EQ(m.erase(50), 0);
+  for (auto it = m.begin(); it != m.end();) {
+    if (it->first % 2) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(m.size(), 49);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(m.contains(i), i % 2 == 0 && i != 50);
+  }
+  auto it = m.erase(m.lower_bound(20), m.lower_bound(60));
+  EXPECT_EQ(it->first, 60);
+  EXPECT_EQ(m.size(), 30);
+  EXPECT_FALSE(m.contains(40));
+  EXPECT_TRUE(m.contains(60));
+  m.erase(m.begin(), m.end());
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.find(0), m.end());
+}
+
+TEST(indexed_map_test, range_test) {  // NOLINT
+  indexed_map<int, int> m{{10, 0}, {20, 1}, {30, 2}, {40, 3}};
+  EXPECT_EQ(m.lower_bound(20)->first, 20);
+  EXPECT_EQ(m.upper_bound(20)->first, 30);
+  EXPECT_EQ(m.upper_bound(40), m.end());
+  EXPECT_EQ(m.rank(25), 2);
+  int sum = 0;
+  for (auto it = m.lower_bound(15); it != m.upper_bound(35); ++it) {
+    sum += it->second;
+  }
+  EXPECT_EQ(sum, 3);
+  auto range = m.equal_range(25);
+  EXPECT_EQ(range.first, range.second);
+  range = m.equal_range(30);
+  EXPECT_EQ(std::distance(range.first, range.second), 1);
+}
+
+TEST(indexed_map_test, collision_test) {  // NOLINT
+  indexed_map<int, int, colliding_hash> m;
+  std::map<int, int> result;
+  std::mt19937 gen{3};
+  std::uniform_int_distribution<int> dist{0, 40};
+  for (int i = 0; i < 2000; i++) {
+    int key = dist(gen);
+    if (gen() % 2) {
+      EXPECT_EQ(m.erase(key), result.erase(key));
+    } else {
+      EXPECT_EQ(m.try_emplace(key, i).second,
+                result.try_emplace(key, i).second);
+    }
+    ASSERT_TRUE(same_nodes(m, result));
+  }
+}
+
+TEST(indexed_map_test, random_test) {  // NOLINT
+  indexed_map<int, int> m;
+  std::map<int, int> result;
+  std::mt19937 gen{5};
+  std::uniform_int_distribution<int> dist{0, 5000};
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 1000; i++) {
+      int key = dist(gen);
+      m[key] = round;
+      result[key] = round;
+    }
+    for (int i = 0; i < 800; i++) {
+      int key = dist(gen);
+      EXPECT_EQ(m.erase(key), result.erase(key));
+    }
+    ASSERT_TRUE(same_nodes(m, result));
+  }
+  auto copy = m;
+  EXPECT_TRUE(same_nodes(copy, result));
+  EXPECT_TRUE(copy == m);
+  copy[-1] = 0;
+  EXPECT_TRUE(copy != m);
+  indexed_map<int, int> moved{std::move(copy)};
+  EXPECT_EQ(moved.at(-1), 0);
+  copy = m;
+  copy.swap(moved);
+  EXPECT_TRUE(copy != m);
+  EXPECT_TRUE(moved == m);
+  m.clear();
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.find(1), m.end());
+  m[1] = 1;
+  EXPECT_EQ(m.size(), 1);
+}
+
+TEST(indexed_map_test, reserve_test) {  // NOLINT
+  indexed_map<int, int> m;
+  m.reserve(1000);
+  auto buckets = m.bucket_count();
+  EXPECT_GE(buckets * m.max_load_factor(), 1000);
+  for (int i = 0; i < 1000; i++) m.emplace(i, i);
+  EXPECT_EQ(m.bucket_count(), buckets);
+  m.rehash(0);
+  EXPECT_EQ(m.bucket_count(), buckets);
+  EXPECT_EQ(m.at(500), 500);
+}
+
+TEST(indexed_map_test, transparent_test) {  // NOLINT
+  indexed_map<std::string, int, string_hash, std::equal_to<>, std::less<>> m{
+      {"apple", 1}, {"banana", 2}};
+  std::string_view key = "banana";
+  EXPECT_EQ(m.find(key)->second, 2);
+  EXPECT_TRUE(m.contains("apple"));
+  EXPECT_EQ(m.lower_bound("b")->first, "banana");
+  EXPECT_EQ(m.erase(key), 1);
+  EXPECT_EQ(m.size(), 1);
+}
@@ -1,5 +1,9 @@
 #include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "List.hpp"
 #include "Map.hpp"
@@ -103,3 +107,224 @@ TEST(map_test, insert_or_assign_test) {  // NOLINT
   EXPECT_EQ(m.find(1)->first, 1);
   EXPECT_EQ(m.find(1)->second, 4);
 }
+
+TEST(map_test, index_access_test) {  // NOLINT
+  map<int, int> m{{2, 4}, {6, 8}, {4, 16}};
+  EXPECT_EQ(m.size(), 3);
+  EXPECT_EQ(m.nth(1)->first, 4);
+  EXPECT_TRUE(m.nth(3) == m.end());
+  EXPECT_EQ(m.rank(5), 2);
+  EXPECT_EQ(m.rank(0), 0);
+  m.erase(m.find(2));
+  EXPECT_EQ(m.nth(0)->first, 4);
+  EXPECT_EQ(m.rank(6), 1);
+}
+
+TEST(map_test, bounds_test) {  // NOLINT
+  map<int, int> m{{2, 4}, {4, 16}, {6, 36}};
+  EXPECT_EQ(m.lower_bound(3)->first, 4);
+  EXPECT_EQ(m.lower_bound(4)->first, 4);
+  EXPECT_EQ(m.upper_bound(4)->first, 6);
+  EXPECT_EQ(m.upper_bound(1)->first, 2);
+  EXPECT_TRUE(m.lower_bound(7) == m.end());
+  auto range = m.equal_range(5);
+  EXPECT_TRUE(range.first == range.second);
+  EXPECT_EQ(range.first->first, 6);
+  range = m.equal_range(6);
+  EXPECT_EQ(range.first->second, 36);
+  EXPECT_TRUE(range.second == m.end());
+}
+
+TEST(map_test, range_insert_test) {  // NOLINT
+  std::vector<std::pair<int, int>> batch{{5, 0}, {1, 1}, {3, 2}, {5, 3}};
+  map<int, int> m{{4, 4}, {1, 5}};
+  m.insert(batch.begin(), batch.end());
+  EXPECT_EQ(m.size(), 4);
+  EXPECT_EQ(m.at(1), 5);
+  EXPECT_EQ(m.at(5), 0);
+  EXPECT_EQ(m.nth(1)->first, 3);
+  m = {{9, 9}, {8, 8}};
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(m.begin()->first, 8);
+}
+
+TEST(map_test, find_batch_test) {  // NOLINT
+  map<int, int> m{{2, 4}, {4, 16}, {6, 36}};
+  std::vector<int> keys{6, 1, 2, 7};
+  std::vector<map<int, int>::iterator> found;
+  m.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  ASSERT_EQ(found.size(), 4);
+  EXPECT_EQ(found[0]->second, 36);
+  EXPECT_TRUE(found[1] == m.end());
+  EXPECT_EQ(found[2]->second, 4);
+  EXPECT_TRUE(found[3] == m.end());
+}
+
+TEST(map_test, find_batch_convert_test) {  // NOLINT
+  using test_helpers::counted_key;
+  map<std::string, int> m;
+  for (int i = 0; i < 1000; i++) m.emplace(std::to_string(i), i);
+  std::vector<counted_key> keys{{"7"}, {"x"}, {"999"}};
+  std::vector<map<std::string, int>::const_iterator> found;
+  const auto &cm = m;
+  counted_key::s_conversions = 0;
+  cm.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  EXPECT_EQ(counted_key::s_conversions, keys.size());
+  ASSERT_EQ(found.size(), 3);
+  EXPECT_EQ(found[0]->second, 7);
+  EXPECT_TRUE(found[1] == m.cend());
+  EXPECT_EQ(found[2]->second, 999);
+}
+
+TEST(map_test, set_algebra_test) {  // NOLINT
+  map<int, int> m{{1, 1}, {3, 3}, {5, 5}};
+  map<int, int> other{{3, 0}, {4, 0}};
+  m.set_union(other);
+  EXPECT_EQ(m.size(), 4);
+  EXPECT_EQ(m.at(3), 3);
+  EXPECT_EQ(m.at(4), 0);
+  m.set_difference(map<int, int>{{1, 0}});
+  EXPECT_EQ(m.begin()->first, 3);
+  m.set_intersection(other);
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(m.nth(1)->first, 4);
+  map<int, int> source{{4, 9}, {6, 9}};
+  m.merge(source);
+  EXPECT_EQ(m.size(), 3);
+  EXPECT_EQ(m.at(4), 0);
+  EXPECT_EQ(source.size(), 1);
+  EXPECT_EQ(source.at(4), 9);
+}
+
+TEST(map_test, range_erase_test) {  // NOLINT
+  map<int, int> m{{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  auto it = m.erase(m.find(2), m.find(4));
+  EXPECT_EQ(it->first, 4);
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(m.nth(1)->first, 4);
+}
+
+TEST(map_test, split_join_test) {  // NOLINT
+  map<int, int> m{{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  auto tail = m.split(3);
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(tail.size(), 2);
+  EXPECT_EQ(tail.begin()->first, 3);
+  tail.join(m);
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(tail.size(), 4);
+  EXPECT_EQ(tail.nth(0)->first, 1);
+  EXPECT_EQ(tail.rank(4), 3);
+}
+
+TEST(map_test, stats_test) {  // NOLINT
+  map<int, int> m{{1, 1}, {2, 2}, {3, 3}};
+  auto s = m.stats();
+  EXPECT_EQ(s.size, 3);
+  EXPECT_GT(s.bytes_per_element, sizeof(std::pair<const int, int>));
+  EXPECT_GE(s.max_search_path, 1);
+}
+
+namespace {
+/* Counts how many times a mapped value gets built */
+struct tracked {
+  static int s_built;
+  explicit tracked(int v = 0) : d_value{v} { ++s_built; }
+  tracked(const tracked &other) : d_value{other.d_value} { ++s_built; }
+  tracked &operator=(const tracked &) = default;
+  int d_value;
+};
+int tracked::s_built = 0;
+}  // namespace
+
+TEST(map_test, single_construction_upsert_test) {  // NOLINT
+  map<int, tracked> m;
+  tracked::s_built = 0;
+  m.try_emplace(1, 5);
+  EXPECT_EQ(tracked::s_built, 1);
+  m.try_emplace(1, 6);
+  EXPECT_EQ(tracked::s_built, 1);
+  EXPECT_EQ(m.at(1).d_value, 5);
+  m[2].d_value = 7;
+  m[2].d_value += 1;
+  EXPECT_EQ(tracked::s_built, 2);
+  tracked value{9};
+  m.insert_or_assign(2, value);
+  EXPECT_EQ(tracked::s_built, 3);
+  EXPECT_EQ(m.at(2).d_value, 9);
+  m.insert_or_assign(m.end(), 3, value);
+  EXPECT_EQ(tracked::s_built, 4);
+  std::string key = "moved only on a miss";
+  map<std::string, int> names;
+  names.try_emplace(key, 1);
+  names.try_emplace(std::move(key), 2);
+  EXPECT_EQ(key, "moved only on a miss");  // NOLINT
+  EXPECT_EQ(names.at(key), 1);
+}
+
+namespace {
+std::size_t g_allocations = 0;
+
+/* std::allocator that counts the allocations made through it */
+template <class T>
+struct counting_allocator {
+  using value_type = T;
+  counting_allocator() = default;
+  template <class U>
+  counting_allocator(const counting_allocator<U> &) {}  // NOLINT
+  T *allocate(std::size_t n) {
+    ++g_allocations;
+    return std::allocator<T>{}.allocate(n);
+  }
+  void deallocate(T *p, std::size_t n) { std::allocator<T>{}.deallocate(p, n); }
+  bool operator==(const counting_allocator &) const { return true; }
+  bool operator!=(const counting_allocator &) const { return false; }
+};
+
+using counted_string =
+    std::basic_string<char, std::char_traits<char>, counting_allocator<char>>;
+}  // namespace
+
+TEST(map_test, transparent_lookup_test) {  // NOLINT
+  const counted_string prefix = "a key long enough to live on the heap/";
+  map<counted_string, int, std::less<>> m;
+  for (int i = 0; i < 100; i++) {
+    m.emplace(prefix + std::to_string(i).c_str(), i);
+  }
+  std::string_view hit = "a key long enough to live on the heap/42";
+  const char *miss = "a key long enough to live on the heap/zzz";
+  const counted_string seven = prefix + "7";
+  auto before = g_allocations;
+  EXPECT_EQ(m.find(hit)->second, 42);
+  EXPECT_EQ(m.find(miss), m.end());
+  EXPECT_EQ(m.count(hit), 1);
+  EXPECT_EQ(m.lower_bound(hit)->second, 42);
+  EXPECT_EQ(m.upper_bound(miss), m.end());
+  EXPECT_EQ(m.equal_range(hit).first->second, 42);
+  EXPECT_EQ(m.rank(miss), m.size());
+  EXPECT_EQ(m.erase(hit), 1);
+  EXPECT_EQ(m.erase(miss), 0);
+  auto node = m.extract(std::string_view{seven});
+  EXPECT_TRUE(node.key() == seven);
+  EXPECT_EQ(g_allocations, before);
+  EXPECT_EQ(m.size(), 98);
+
+  // Without is_transparent the key is converted once per call
+  map<counted_string, int> plain{m.begin(), m.end()};
+  before = g_allocations;
+  EXPECT_EQ(plain.find(miss), plain.end());
+  EXPECT_EQ(g_allocations, before + 1);
+}
+
+TEST(map_test, swap_test) {  // NOLINT
+  map<int, int> a{{1, 1}, {2, 2}};
+  map<int, int> b{{3, 3}};
+  a.swap(b);
+  EXPECT_EQ(a.size(), 1);
+  EXPECT_EQ(b.at(2), 2);
+  a = std::move(b);
+  EXPECT_EQ(a.size(), 2);
+  map<int, int>::const_iterator first = a.begin();
+  EXPECT_EQ(a.erase(first)->first, 2);
+  EXPECT_EQ(a.count(1), 0);
+}
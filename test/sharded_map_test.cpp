@@ -0,0 +1,117 @@
+#include "ShardedMap.hpp"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using wijagels::sharded_map;
+
+namespace {
+template <class Map>
+std::vector<std::pair<int, int>> contents(const Map &m) {
+  std::vector<std::pair<int, int>> out;
+  m.for_each([&out](const auto &e) { out.emplace_back(e.first, e.second); });
+  return out;
+}
+}  // namespace
+
+TEST(sharded_map_test, basic_test) {  // NOLINT
+  sharded_map<int, int> m{4};
+  EXPECT_EQ(4, m.shard_count());
+  EXPECT_TRUE(m.insert({2, 20}));
+  EXPECT_TRUE(m.try_emplace(1, 10));
+  EXPECT_FALSE(m.insert({2, 0}));
+  EXPECT_EQ(2, m.size());
+  EXPECT_EQ(20, m.find(2).value());
+  EXPECT_FALSE(m.find(3).has_value());
+  EXPECT_FALSE(m.insert_or_assign(2, 21));
+  EXPECT_EQ(21, m.find(2).value());
+  EXPECT_TRUE(m.visit(1, [](auto &e) { e.second++; }));
+  EXPECT_FALSE(m.visit(3, [](auto &) {}));
+  const std::vector<std::pair<int, int>> expected{{1, 11}, {2, 21}};
+  EXPECT_EQ(expected, contents(m));
+  EXPECT_EQ(1, m.erase(1));
+  EXPECT_EQ(0, m.erase(1));
+  EXPECT_EQ(1, m.count(2));
+  m.clear();
+  EXPECT_TRUE(m.empty());
+}
+
+TEST(sharded_map_test, rebalance_test) {  // NOLINT
+  // Ascending keys keep landing in one shard until the ranges are recomputed
+  sharded_map<int, int> m{8};
+  const int n = 100000;
+  for (int i = 0; i < n; i++) m.try_emplace(i, -i);
+  EXPECT_EQ(n, m.size());
+  auto elements = contents(m);
+  ASSERT_EQ(n, elements.size());
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(i, elements[i].first);
+    ASSERT_EQ(-i, elements[i].second);
+  }
+  for (int i = 0; i < n; i += 7) ASSERT_TRUE(m.contains(i));
+  EXPECT_FALSE(m.contains(n));
+  EXPECT_FALSE(m.contains(-1));
+}
+
+TEST(sharded_map_test, concurrent_test) {  // NOLINT
+  sharded_map<int, int> m;
+  const unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+  const int per_thread = 20000;
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&m, t, threads] {
+      std::mt19937 gen{t};
+      for (int i = 0; i < per_thread; i++) {
+        int k = i * threads + t;
+        m.try_emplace(k, 0);
+        m.visit(k, [](auto &e) { e.second++; });
+        if (gen() % 4 == 0) m.erase(k);
+      }
+    });
+  }
+  for (auto &w : workers) w.join();
+  auto elements = contents(m);
+  EXPECT_EQ(m.size(), elements.size());
+  for (size_t i = 1; i < elements.size(); i++) {
+    ASSERT_LT(elements[i - 1].first, elements[i].first);
+  }
+  for (auto &e : elements) ASSERT_EQ(1, e.second);
+}
+
+TEST(sharded_map_test, concurrent_rebalance_test) {  // NOLINT
+  // Ascending keys keep moving the bounds while lookups are routed by them
+  sharded_map<int, int> m{4};
+  const int writers = 3;
+  const int per_writer = 30000;
+  std::atomic<int> done[writers] = {};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < writers; t++) {
+    workers.emplace_back([&m, &done, t] {
+      for (int i = 0; i < per_writer; i++) {
+        m.try_emplace(i * writers + t, t);
+        done[t].store(i + 1, std::memory_order_release);
+      }
+    });
+  }
+  std::mt19937 gen{1};
+  bool finished = false;
+  while (!finished) {
+    finished = true;
+    for (int t = 0; t < writers; t++) {
+      int count = done[t].load(std::memory_order_acquire);
+      finished = finished && count == per_writer;
+      if (count == 0) continue;
+      int k = static_cast<int>(gen() % count) * writers + t;
+      ASSERT_EQ(t, m.find(k).value_or(-1));
+    }
+  }
+  for (auto &w : workers) w.join();
+  EXPECT_EQ(writers * per_writer, m.size());
+  auto elements = contents(m);
+  ASSERT_EQ(writers * per_writer, elements.size());
+  for (int i = 0; i < writers * per_writer; i++) {
+    ASSERT_EQ(i, elements[i].first);
+  }
+}
@@ -1,6 +1,14 @@
 #include "SkipList.hpp"
+#include "Allocator.hpp"
 #include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <cmath>
+#include <numeric>
+#include <random>
 #include <set>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using wijagels::skiplist;
 
@@ -127,6 +135,10 @@ TEST(skiplist_test, erase_test) {  // NOLINT
   s.erase(s.begin());
   nums.erase(nums.begin());
   EXPECT_TRUE(std::equal(s.begin(), s.end(), nums.begin(), nums.end()));
+  skiplist<int>::const_iterator last = s.cend();
+  EXPECT_EQ(s.erase(--last), s.end());
+  nums.erase(--nums.end());
+  EXPECT_TRUE(std::equal(s.begin(), s.end(), nums.begin(), nums.end()));
 }
 
 TEST(skiplist_test, extract_test) {  // NOLINT
@@ -219,3 +231,756 @@ TEST(skiplist_test, move_test) {  // NOLINT
   EXPECT_TRUE(
       std::equal(list.begin(), list.end(), result.begin(), result.end()));
 }
+
+TEST(skiplist_test, nth_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  ASSERT_EQ(list.size(), result.size());
+  size_t i = 0;
+  for (auto e : result) {
+    EXPECT_EQ(*list.nth(i++), e);
+  }
+  EXPECT_TRUE(list.nth(result.size()) == list.end());
+  const auto &clist = list;
+  EXPECT_EQ(*clist.nth(0), *result.begin());
+}
+
+TEST(skiplist_test, rank_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  for (int k = 0; k < 10001; k += 7) {
+    auto expected = std::distance(result.begin(), result.lower_bound(k));
+    EXPECT_EQ(list.rank(k), static_cast<size_t>(expected));
+  }
+}
+
+TEST(skiplist_test, distance_test) {  // NOLINT
+  skiplist<int> list{g_rand_list};
+  EXPECT_EQ(distance(list.begin(), list.end()), list.size());
+  EXPECT_EQ(distance(list.cbegin(), list.cend()), list.size());
+  auto it = list.begin();
+  for (size_t i = 0; i < list.size(); i += 13) {
+    EXPECT_EQ(distance(list.begin(), list.nth(i)), i);
+    EXPECT_EQ(distance(list.nth(i), list.end()), list.size() - i);
+  }
+  EXPECT_EQ(distance(it, it), 0);
+}
+
+TEST(skiplist_test, index_mutation_test) {  // NOLINT
+  std::uniform_int_distribution<int> distrib{1, 5000};
+  std::mt19937 gen{42};
+  std::set<int> result;
+  skiplist<int> list;
+  for (size_t i = 0; i < 20000; i++) {
+    auto k = distrib(gen);
+    if (i % 3 == 0) {
+      EXPECT_EQ(list.erase(k), result.erase(k));
+    } else {
+      list.insert(k);
+      result.insert(k);
+    }
+  }
+  ASSERT_EQ(list.size(), result.size());
+  size_t i = 0;
+  for (auto e : result) {
+    ASSERT_EQ(*list.nth(i), e);
+    ASSERT_EQ(list.rank(e), i);
+    ++i;
+  }
+  auto nh = list.extract(list.nth(10));
+  EXPECT_EQ(list.size(), result.size() - 1);
+  EXPECT_EQ(*list.nth(10), *std::next(result.begin(), 11));
+  list.insert(std::move(nh));
+  EXPECT_EQ(*list.nth(10), *std::next(result.begin(), 10));
+}
+
+TEST(skiplist_test, move_construct_test) {  // NOLINT
+  skiplist<int> list{g_rand_list};
+  skiplist<int> result{g_rand_list};
+  skiplist<int> moved{std::move(list)};
+  EXPECT_TRUE(list.empty());
+  EXPECT_TRUE(moved == result);
+  EXPECT_EQ(*moved.nth(moved.size() - 1), *result.rbegin());
+  moved.insert(-1);
+  EXPECT_EQ(*moved.begin(), -1);
+}
+
+TEST(skiplist_test, swap_test) {  // NOLINT
+  skiplist<int> list1{g_rand_list};
+  skiplist<int> list2{1, 2, 3};
+  skiplist<int> result1{g_rand_list};
+  skiplist<int> result2{1, 2, 3};
+  list1.swap(list2);
+  EXPECT_TRUE(list1 == result2);
+  EXPECT_TRUE(list2 == result1);
+  EXPECT_EQ(list1.size(), 3);
+  EXPECT_EQ(distance(list2.begin(), list2.end()), result1.size());
+  skiplist<int> empty;
+  empty.swap(list1);
+  EXPECT_TRUE(list1.empty());
+  EXPECT_TRUE(empty == result2);
+}
+
+struct alignas(64) overaligned {
+  overaligned(int n) : data{n} {}
+  friend bool operator<(const overaligned &lhs, const overaligned &rhs) {
+    return lhs.data < rhs.data;
+  }
+  int data;
+};
+
+TEST(skiplist_test, overaligned_test) {  // NOLINT
+  skiplist<overaligned> list;
+  for (auto e : g_rand_list) {
+    auto it = list.insert(e).first;
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&*it) % alignof(overaligned), 0);
+  }
+  EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+}
+
+template <typename T>
+using forward_skiplist =
+    skiplist<T, std::less<T>, std::allocator<T>, wijagels::forward_links>;
+
+TEST(skiplist_test, forward_links_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  forward_skiplist<int> list{g_rand_list};
+  EXPECT_TRUE(
+      std::equal(list.begin(), list.end(), result.begin(), result.end()));
+  EXPECT_TRUE(
+      std::equal(list.rbegin(), list.rend(), result.rbegin(), result.rend()));
+  list.insert(list.begin(), 10001);
+  result.insert(10001);
+  list.insert(list.find(5000), 4999);
+  result.insert(4999);
+  EXPECT_TRUE(
+      std::equal(list.begin(), list.end(), result.begin(), result.end()));
+}
+
+TEST(skiplist_test, forward_links_mutation_test) {  // NOLINT
+  std::uniform_int_distribution<int> distrib{1, 5000};
+  std::mt19937 gen{7};
+  std::set<int> result;
+  forward_skiplist<int> list;
+  for (size_t i = 0; i < 20000; i++) {
+    auto k = distrib(gen);
+    switch (i % 4) {
+      case 0:
+        EXPECT_EQ(list.erase(k), result.erase(k));
+        break;
+      case 1: {
+        auto it = list.find(k);
+        if (it != list.end()) list.erase(it);
+        result.erase(k);
+        break;
+      }
+      default:
+        list.insert(k);
+        result.insert(k);
+    }
+  }
+  ASSERT_EQ(list.size(), result.size());
+  size_t i = 0;
+  for (auto e : result) {
+    ASSERT_EQ(*list.nth(i), e);
+    ASSERT_EQ(list.rank(e), i);
+    ++i;
+  }
+  EXPECT_EQ(distance(list.begin(), list.end()), result.size());
+  auto nh = list.extract(list.nth(10));
+  list.insert(std::move(nh));
+  EXPECT_TRUE(
+      std::equal(list.begin(), list.end(), result.begin(), result.end()));
+}
+
+TEST(skiplist_test, forward_links_move_test) {  // NOLINT
+  std::initializer_list<int> result1{1, 2, 3, 4, 5, 6, 7};
+  forward_skiplist<int> list1{1, 2, 3, 5};
+  forward_skiplist<int> list2{1, 2, 4, 6, 7};
+  list1.merge(list2);
+  EXPECT_TRUE(
+      std::equal(list1.begin(), list1.end(), result1.begin(), result1.end()));
+  EXPECT_EQ(list2.size(), 2);
+  forward_skiplist<int> big{g_rand_list};
+  forward_skiplist<int> result{g_rand_list};
+  big.swap(list1);
+  EXPECT_TRUE(list1 == result);
+  forward_skiplist<int> moved{std::move(list1)};
+  EXPECT_TRUE(moved == result);
+  moved.insert(100000);
+  EXPECT_EQ(*moved.rbegin(), 100000);
+  EXPECT_EQ(*moved.nth(moved.size() - 1), 100000);
+  list1 = std::move(moved);
+  list1.insert(100001);
+  EXPECT_EQ(*list1.rbegin(), 100001);
+  EXPECT_EQ(list1.size(), result.size() + 2);
+}
+
+TEST(skiplist_test, bounds_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  const auto &clist = list;
+  for (int k = -1; k < 10002; k += 3) {
+    EXPECT_EQ(distance(list.begin(), list.lower_bound(k)),
+              std::distance(result.begin(), result.lower_bound(k)));
+    EXPECT_EQ(distance(list.begin(), list.upper_bound(k)),
+              std::distance(result.begin(), result.upper_bound(k)));
+    auto range = clist.equal_range(k);
+    EXPECT_EQ(distance(range.first, range.second), result.count(k));
+    EXPECT_TRUE(range.first == clist.lower_bound(k));
+  }
+  EXPECT_TRUE(list.lower_bound(10001) == list.end());
+  EXPECT_TRUE(list.upper_bound(-1) == list.begin());
+}
+
+TEST(skiplist_test, heterogeneous_bounds_test) {  // NOLINT
+  skiplist<int, std::less<>> list{1, 3, 5, 7};
+  EXPECT_EQ(*list.lower_bound(4.5), 5);
+  EXPECT_EQ(*list.upper_bound(5.0), 7);
+  EXPECT_EQ(*list.lower_bound(5L), 5);
+  EXPECT_TRUE(list.upper_bound(7.5) == list.end());
+}
+
+TEST(skiplist_test, sorted_build_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{wijagels::sorted_unique, result.begin(), result.end()};
+  EXPECT_EQ(list.size(), result.size());
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), result.begin()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), result.rbegin()));
+  size_t i = 0;
+  for (auto e : result) {
+    EXPECT_EQ(*list.nth(i), e);
+    EXPECT_EQ(list.rank(e), i++);
+  }
+  skiplist<int> copy{list};
+  EXPECT_TRUE(copy == list);
+  copy.insert(-5);
+  copy.erase(*result.rbegin());
+  copy.insert(20000);
+  EXPECT_EQ(*copy.nth(0), -5);
+  EXPECT_EQ(*copy.nth(copy.size() - 1), 20000);
+  EXPECT_EQ(copy.size(), list.size() + 1);
+  EXPECT_EQ(distance(copy.begin(), copy.end()), copy.size());
+
+  skiplist<int> assigned;
+  assigned.insert(copy.begin(), copy.end());
+  EXPECT_TRUE(assigned == copy);
+  assigned = list;
+  EXPECT_TRUE(assigned == list);
+  assigned.insert(wijagels::sorted_unique, copy.begin(), copy.end());
+  EXPECT_EQ(assigned.size(), list.size() + 2);
+}
+
+TEST(skiplist_test, forward_links_sorted_build_test) {  // NOLINT
+  std::vector<int> sorted(1000);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  forward_skiplist<int> list{wijagels::sorted_unique, sorted.begin(),
+                             sorted.end()};
+  for (int i = 0; i < 1000; i++) EXPECT_EQ(*list.nth(i), i);
+  for (int i = 0; i < 1000; i += 2) list.erase(i);
+  for (int i = 1; i < 1000; i += 2) EXPECT_EQ(list.rank(i), i / 2);
+  forward_skiplist<int> copy{list};
+  EXPECT_TRUE(copy == list);
+  EXPECT_EQ(*copy.lower_bound(500), 501);
+}
+
+TEST(skiplist_test, batch_insert_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{1, 100, 10000, 5000};
+  result.insert({1, 100, 10000, 5000});
+  std::vector<int> batch = g_rand_list;
+  batch.insert(batch.end(), g_rand_list);  // Duplicates within the batch
+  list.insert(batch.begin(), batch.end());
+  EXPECT_EQ(list.size(), result.size());
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), result.begin()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), result.rbegin()));
+  size_t i = 0;
+  for (auto e : result) EXPECT_EQ(list.rank(e), i++);
+
+  forward_skiplist<int> flist{5, 3, 1};
+  flist.insert(batch.begin(), batch.end());
+  std::set<int> fresult = g_rand_list;
+  fresult.insert({5, 3, 1});
+  EXPECT_EQ(flist.size(), fresult.size());
+  EXPECT_TRUE(std::equal(flist.begin(), flist.end(), fresult.begin()));
+  for (auto e : fresult) EXPECT_EQ(*flist.nth(flist.rank(e)), e);
+}
+
+TEST(skiplist_test, batch_insert_keeps_first_test) {  // NOLINT
+  using pair = std::pair<int, int>;
+  auto by_first = [](const pair &lhs, const pair &rhs) {
+    return lhs.first < rhs.first;
+  };
+  skiplist<pair, decltype(by_first)> list{{{2, 0}, {1, 0}, {2, 1}, {1, 1}},
+                                          by_first};
+  ASSERT_EQ(list.size(), 2);
+  EXPECT_EQ(list.begin()->second, 0);
+  EXPECT_EQ(list.rbegin()->second, 0);
+}
+
+TEST(skiplist_test, cursor_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  skiplist<int>::cursor finger{list};
+  std::mt19937 gen{};
+  std::uniform_int_distribution<> step{-300, 400};
+  for (int k = -50, i = 0; i < 2000; i++, k += step(gen)) {
+    auto expected = result.lower_bound(k);
+    auto it = finger.lower_bound(k);
+    ASSERT_EQ(finger.rank(), std::distance(result.begin(), expected));
+    ASSERT_EQ(distance(list.begin(), it), finger.rank());
+    if (expected == result.end()) {
+      ASSERT_TRUE(it == list.end());
+    } else {
+      ASSERT_EQ(*it, *expected);
+    }
+    ASSERT_EQ(finger.find(k) != list.end(), result.count(k) == 1);
+  }
+  finger.find(9999);
+  EXPECT_EQ(*finger.find(5), 5);
+  EXPECT_TRUE(finger.find(-1) == list.end());
+
+  forward_skiplist<int> flist{g_rand_list};
+  forward_skiplist<int>::cursor ffinger{flist};
+  for (int k = 10000; k > 0; k -= 37) {
+    ASSERT_EQ(ffinger.find(k) != flist.end(), result.count(k) == 1);
+  }
+  flist.insert(-3);
+  ffinger.reset();
+  EXPECT_EQ(*ffinger.find(-3), -3);
+}
+
+TEST(skiplist_test, level_policy_test) {  // NOLINT
+  wijagels::geometric_levels<> half;
+  wijagels::geometric_levels<> same;
+  wijagels::geometric_levels<2> quarter;
+  size_t ones = 0;
+  size_t quarter_ones = 0;
+  for (int i = 0; i < (1 << 16); i++) {
+    auto level = half();
+    ASSERT_EQ(level, same());
+    ASSERT_GE(level, 1);
+    ASSERT_LE(level, 32);
+    ones += level == 1;
+    quarter_ones += quarter() == 1;
+  }
+  EXPECT_NEAR(ones / double{1 << 16}, 0.5, 0.02);
+  EXPECT_NEAR(quarter_ones / double{1 << 16}, 0.75, 0.02);
+  wijagels::geometric_levels<1, 3> capped;
+  for (int i = 0; i < 1000; i++) ASSERT_LE(capped(), 3);
+}
+
+namespace {
+struct flat_levels {
+  static constexpr size_t max_level = 1;
+  size_t operator()() const noexcept { return 1; }
+};
+}  // namespace
+
+TEST(skiplist_test, custom_level_policy_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int, std::less<>, std::allocator<int>, wijagels::bidirectional_links,
+           wijagels::geometric_levels<2>>
+      quarter{g_rand_list};
+  skiplist<int, std::less<>, std::allocator<int>, wijagels::forward_links,
+           flat_levels>
+      flat{g_rand_list};
+  EXPECT_TRUE(std::equal(quarter.begin(), quarter.end(), result.begin(),
+                         result.end()));
+  EXPECT_TRUE(
+      std::equal(flat.begin(), flat.end(), result.begin(), result.end()));
+  size_t i = 0;
+  for (auto e : result) {
+    EXPECT_EQ(*quarter.nth(i), e);
+    EXPECT_EQ(flat.rank(e), i++);
+  }
+  for (int k = 0; k < 10000; k += 3) {
+    EXPECT_EQ(quarter.erase(k), result.count(k));
+    EXPECT_EQ(flat.erase(k), result.count(k));
+  }
+  EXPECT_TRUE(
+      std::equal(quarter.begin(), quarter.end(), flat.begin(), flat.end()));
+  // Policies without a probability count as p = 1/2
+  auto s = flat.stats();
+  EXPECT_EQ(s.max_level, 1);
+  EXPECT_DOUBLE_EQ(s.ideal_level, std::log2(static_cast<double>(s.size)));
+}
+
+TEST(skiplist_test, prefetch_policy_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int, std::less<>, std::allocator<int>, wijagels::forward_links,
+           wijagels::geometric_levels<>, wijagels::prefetch_nodes<2>>
+      list{g_rand_list};
+  for (int k = -1; k < 10002; k += 7) {
+    EXPECT_EQ(list.find(k) != list.end(), result.count(k) == 1);
+    EXPECT_EQ(list.rank(k),
+              std::distance(result.begin(), result.lower_bound(k)));
+    EXPECT_EQ(list.insert(k).second, result.insert(k).second);
+  }
+  EXPECT_TRUE(
+      std::equal(list.begin(), list.end(), result.begin(), result.end()));
+}
+
+TEST(skiplist_test, find_batch_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  std::vector<int> keys;
+  for (int k = 10005; k > -5; k -= 3) keys.push_back(k);
+  std::vector<skiplist<int>::iterator> found;
+  list.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  ASSERT_EQ(found.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (result.count(keys[i])) {
+      ASSERT_TRUE(found[i] != list.end());
+      ASSERT_EQ(*found[i], keys[i]);
+    } else {
+      ASSERT_TRUE(found[i] == list.end());
+    }
+  }
+  const auto &clist = list;
+  std::vector<skiplist<int>::const_iterator> cfound(3, clist.end());
+  std::vector<int> few{5, 6, 4};
+  EXPECT_TRUE(clist.find_batch(few.begin(), few.end(), cfound.begin()) ==
+              cfound.end());
+  EXPECT_TRUE(cfound[0] == clist.find(5));
+  EXPECT_TRUE(cfound[1] == clist.find(6));
+  EXPECT_TRUE(cfound[2] == clist.find(4));
+
+  skiplist<int> empty;
+  std::vector<skiplist<int>::iterator> none;
+  empty.find_batch(few.begin(), few.end(), std::back_inserter(none));
+  ASSERT_EQ(none.size(), 3);
+  EXPECT_TRUE(none[0] == empty.end());
+}
+
+TEST(skiplist_test, find_batch_convert_test) {  // NOLINT
+  using test_helpers::counted_key;
+  skiplist<std::string> list;
+  for (int i = 0; i < 1000; i++) list.insert(std::to_string(i));
+  std::vector<counted_key> keys{{"7"}, {"x"}, {"999"}, {"10"}};
+  std::vector<skiplist<std::string>::iterator> found;
+  counted_key::s_conversions = 0;
+  list.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  EXPECT_EQ(counted_key::s_conversions, keys.size());
+  ASSERT_EQ(found.size(), 4);
+  EXPECT_EQ(*found[0], "7");
+  EXPECT_TRUE(found[1] == list.end());
+  EXPECT_EQ(*found[2], "999");
+  EXPECT_EQ(*found[3], "10");
+}
+
+namespace {
+/* Check every link and width by comparing ranks and walks against result */
+template <class List>
+bool same_contents(const List &list, const std::set<int> &result) {
+  if (list.size() != result.size()) return false;
+  if (!std::equal(list.rbegin(), list.rend(), result.rbegin(), result.rend())) {
+    return false;
+  }
+  size_t i = 0;
+  for (auto k : result) {
+    if (*list.nth(i++) != k || list.rank(k) != i - 1) return false;
+  }
+  return true;
+}
+}  // namespace
+
+TEST(skiplist_test, set_algebra_test) {  // NOLINT
+  std::mt19937 gen{7};
+  std::uniform_int_distribution<int> dist{0, 3000};
+  std::set<int> a;
+  std::set<int> b;
+  for (int i = 0; i < 1000; i++) {
+    a.insert(dist(gen));
+    b.insert(dist(gen));
+  }
+  std::set<int> expected;
+
+  skiplist<int> merged{a.begin(), a.end()};
+  skiplist<int> source{b.begin(), b.end()};
+  merged.merge(source);
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                 std::inserter(expected, expected.end()));
+  EXPECT_TRUE(same_contents(merged, expected));
+  std::set<int> left;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::inserter(left, left.end()));
+  EXPECT_TRUE(same_contents(source, left));
+
+  skiplist<int> list{a.begin(), a.end()};
+  skiplist<int> other{b.begin(), b.end()};
+  list.set_union(other);
+  EXPECT_TRUE(same_contents(list, expected));
+  EXPECT_TRUE(same_contents(other, b));
+
+  list = skiplist<int>{a.begin(), a.end()};
+  list.set_intersection(other);
+  EXPECT_TRUE(same_contents(list, left));
+
+  expected.clear();
+  std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                      std::inserter(expected, expected.end()));
+  list = skiplist<int>{a.begin(), a.end()};
+  list.set_difference(other);
+  EXPECT_TRUE(same_contents(list, expected));
+  list.insert(-1);
+  EXPECT_EQ(*list.begin(), -1);
+
+  list.set_difference(list);
+  EXPECT_TRUE(list.empty());
+  forward_skiplist<int> flist{a.begin(), a.end()};
+  forward_skiplist<int> fother{b.begin(), b.end()};
+  flist.set_intersection(fother);
+  EXPECT_TRUE(same_contents(flist, left));
+}
+
+TEST(skiplist_test, range_erase_test) {  // NOLINT
+  std::set<int> result = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  auto it = list.erase(list.nth(100), list.nth(400));
+  result.erase(std::next(result.begin(), 100), std::next(result.begin(), 400));
+  EXPECT_TRUE(it == list.nth(100));
+  EXPECT_TRUE(same_contents(list, result));
+  EXPECT_TRUE(list.erase(list.begin(), list.begin()) == list.begin());
+  list.erase(list.nth(50), list.end());
+  result.erase(std::next(result.begin(), 50), result.end());
+  EXPECT_TRUE(same_contents(list, result));
+  list.erase(list.begin(), list.end());
+  EXPECT_TRUE(list.empty());
+  list.insert(3);
+  EXPECT_EQ(list.rank(3), 0);
+
+  forward_skiplist<int> flist{g_rand_list};
+  flist.erase(flist.nth(10), flist.nth(300));
+  result = g_rand_list;
+  result.erase(std::next(result.begin(), 10), std::next(result.begin(), 300));
+  EXPECT_TRUE(same_contents(flist, result));
+}
+
+TEST(skiplist_test, split_join_test) {  // NOLINT
+  const std::set<int> sorted = g_rand_list;
+  skiplist<int> list{g_rand_list};
+  auto pivot = *list.nth(sorted.size() / 3);
+  auto tail = list.split(pivot);
+  std::set<int> head_result{sorted.begin(), sorted.find(pivot)};
+  std::set<int> tail_result{sorted.find(pivot), sorted.end()};
+  EXPECT_TRUE(same_contents(list, head_result));
+  EXPECT_TRUE(same_contents(tail, tail_result));
+  EXPECT_TRUE(list.split(pivot).empty());
+  tail.insert(pivot - 1);
+  tail.erase(pivot - 1);
+
+  tail.join(list);
+  EXPECT_TRUE(list.empty());
+  EXPECT_TRUE(same_contents(tail, sorted));
+  list.join(tail);
+  EXPECT_TRUE(same_contents(list, sorted));
+
+  auto all = list.split(*list.begin());
+  EXPECT_TRUE(list.empty());
+  EXPECT_TRUE(same_contents(all, sorted));
+  auto rest = all.split(*all.rbegin() + 1);
+  EXPECT_TRUE(rest.empty());
+  rest.insert(*all.rbegin() + 1);
+  all.join(rest);
+  EXPECT_EQ(all.size(), sorted.size() + 1);
+  EXPECT_EQ(all.rank(*all.rbegin()), sorted.size());
+
+  forward_skiplist<int> flist{g_rand_list};
+  auto ftail = flist.split(pivot);
+  EXPECT_TRUE(same_contents(flist, head_result));
+  EXPECT_TRUE(same_contents(ftail, tail_result));
+  flist.join(ftail);
+  EXPECT_TRUE(same_contents(flist, sorted));
+}
+
+TEST(skiplist_test, arena_test) {  // NOLINT
+  using arena_list = skiplist<int, std::less<>, wijagels::arena_allocator<int>>;
+  arena_list list{g_rand_list, std::less<>{},
+                  wijagels::arena_allocator<int>{1024}};
+  auto &arena = list.get_allocator().resource();
+  EXPECT_GT(arena.block_count(), 1);
+  std::set<int> result = g_rand_list;
+  for (int k = 0; k < 5000; k += 7) {
+    EXPECT_EQ(list.erase(k), result.erase(k));
+  }
+  EXPECT_TRUE(same_contents(list, result));
+  arena_list copy{list};
+  EXPECT_TRUE(copy.get_allocator() != list.get_allocator());
+  EXPECT_TRUE(same_contents(copy, result));
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  // The arena the list was given stays, emptied in place
+  EXPECT_EQ(&list.get_allocator().resource(), &arena);
+  EXPECT_EQ(arena.block_count(), 0);
+  list.insert(3);
+  EXPECT_EQ(*list.begin(), 3);
+  EXPECT_EQ(arena.block_count(), 1);
+  // A shared arena is left alone, its other user still lives in it
+  arena_list neighbour{{1, 2}, std::less<>{}, list.get_allocator()};
+  list.clear();
+  EXPECT_EQ(arena.block_count(), 1);
+  EXPECT_EQ(*neighbour.begin(), 1);
+
+  // Elements that need destroying still get it
+  skiplist<std::string, std::less<>, wijagels::arena_allocator<std::string>>
+      strings;
+  for (int i = 0; i < 100; i++) strings.insert(std::string(64, 'a' + i % 26));
+  EXPECT_EQ(strings.size(), 26);
+  strings.erase(std::string(64, 'a'));
+  // A node handle keeps its arena alive past clear()
+  auto nh = strings.extract(strings.begin());
+  strings.clear();
+  EXPECT_FALSE(nh.empty());
+
+  // Merging copies the elements over, source's arena can go away after
+  arena_list merged{{1, 3, 5}, std::less<>{}, wijagels::arena_allocator<int>{}};
+  {
+    arena_list source{{0, 1, 2, 3, 4, 6}};
+    merged.merge(source);
+    EXPECT_EQ(source.size(), 2);
+    EXPECT_EQ(*source.begin(), 1);
+  }
+  std::vector<int> expected{0, 1, 2, 3, 4, 5, 6};
+  EXPECT_TRUE(std::equal(merged.begin(), merged.end(), expected.begin(),
+                         expected.end()));
+  merged.insert(7);
+  EXPECT_EQ(merged.size(), 8);
+}
+
+TEST(skiplist_test, stats_test) {  // NOLINT
+  skiplist<int> list;
+  auto empty = list.stats();
+  EXPECT_EQ(empty.size, 0);
+  EXPECT_EQ(empty.max_level, 0);
+  EXPECT_EQ(empty.node_bytes, 0);
+  for (int i = 0; i < 4096; i++) list.insert(i);
+  auto s = list.stats(128);
+  EXPECT_EQ(s.size, 4096);
+  size_t nodes = 0;
+  for (auto count : s.level_histogram) nodes += count;
+  EXPECT_EQ(nodes, 4096);
+  EXPECT_EQ(s.max_level, s.level_histogram.size());
+  // About half the nodes stop at each level
+  EXPECT_GT(s.level_histogram[0], 1500);
+  EXPECT_LT(s.level_histogram[0], 2600);
+  EXPECT_DOUBLE_EQ(s.ideal_level, 12);
+  EXPECT_GE(s.max_level, 8);
+  EXPECT_LE(s.max_level, 24);
+  EXPECT_GT(s.mean_search_path, 1);
+  EXPECT_LE(s.mean_search_path, s.max_search_path);
+  EXPECT_GE(s.node_bytes, 4096 * sizeof(int));
+  EXPECT_EQ(s.total_bytes, s.node_bytes + sizeof(list));
+  EXPECT_DOUBLE_EQ(s.bytes_per_element, s.total_bytes / 4096.0);
+}
+
+TEST(skiplist_test, sorted_build_policy_test) {  // NOLINT
+  std::vector<int> nums(4096);
+  std::iota(nums.begin(), nums.end(), 0);
+  skiplist<int, std::less<>, std::allocator<int>, wijagels::bidirectional_links,
+           wijagels::geometric_levels<2>>
+      quarter{wijagels::sorted_unique, nums.begin(), nums.end()};
+  auto copy = quarter;
+  // Every fourth node of a level is promoted, 4^6 = 4096 reaches level 7
+  auto s = copy.stats();
+  ASSERT_EQ(s.level_histogram.size(), 7);
+  EXPECT_EQ(s.level_histogram[0], 3072);
+  EXPECT_EQ(s.level_histogram[1], 768);
+  EXPECT_EQ(s.level_histogram[6], 1);
+  skiplist<int, std::less<>, std::allocator<int>, wijagels::bidirectional_links,
+           wijagels::geometric_levels<1, 3>>
+      capped{wijagels::sorted_unique, nums.begin(), nums.end()};
+  s = skiplist<int, std::less<>, std::allocator<int>,
+               wijagels::bidirectional_links,
+               wijagels::geometric_levels<1, 3>>{capped}
+          .stats();
+  ASSERT_EQ(s.max_level, 3);
+  EXPECT_EQ(s.level_histogram[2], 1024);
+  EXPECT_EQ(*copy.nth(1234), 1234);
+  EXPECT_EQ(*capped.nth(4095), 4095);
+}
+
+TEST(skiplist_test, level_seed_test) {  // NOLINT
+  using levels = wijagels::geometric_levels<>;
+  skiplist<int> a{std::less<int>{}, std::allocator<int>{}, levels{7}};
+  skiplist<int> b{std::less<int>{}, std::allocator<int>{}, levels{7}};
+  skiplist<int> c{std::less<int>{}, std::allocator<int>{}, levels{8}};
+  for (int i = 0; i < 1000; i++) {
+    a.insert(i);
+    b.insert(i);
+    c.insert(i);
+  }
+  EXPECT_EQ(a.stats().level_histogram, b.stats().level_histogram);
+  EXPECT_NE(a.stats().level_histogram, c.stats().level_histogram);
+  // The copy draws the same heights the original would have drawn next
+  auto added = [](std::vector<size_t> before, std::vector<size_t> after) {
+    before.resize(after.size());
+    for (size_t i = 0; i < after.size(); i++) after[i] -= before[i];
+    while (!after.empty() && !after.back()) after.pop_back();
+    return after;
+  };
+  auto copy = a;
+  auto copied = copy.stats().level_histogram;
+  for (int i = 1000; i < 2000; i++) {
+    copy.insert(i);
+    b.insert(i);
+  }
+  EXPECT_EQ(added(copied, copy.stats().level_histogram),
+            added(a.stats().level_histogram, b.stats().level_histogram));
+}
+
+TEST(skiplist_test, append_test) {  // NOLINT
+  skiplist<int> list;
+  forward_skiplist<int> forward;
+  std::set<int> result;
+  for (int i = 0; i < 2000; i += 2) {
+    EXPECT_EQ(*list.insert(list.end(), i).first, i);
+    forward.insert(forward.end(), i);
+    result.insert(i);
+  }
+  // Appends after erasing from the back and inserting in the middle
+  list.erase(1998);
+  forward.erase(1998);
+  result.erase(1998);
+  for (int i = 1; i < 100; i += 2) {
+    list.insert(i);
+    forward.insert(i);
+    result.insert(i);
+  }
+  for (int i = 1998; i < 2100; i++) {
+    list.insert(list.cend(), i);
+    forward.emplace_hint(forward.cend(), i);
+    result.insert(i);
+  }
+  EXPECT_FALSE(list.insert(list.end(), 2099).second);
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), result.begin(),
+                         result.end()));
+  EXPECT_TRUE(std::equal(forward.begin(), forward.end(), result.begin(),
+                         result.end()));
+  size_t i = 0;
+  for (auto e : result) {
+    EXPECT_EQ(*list.nth(i), e);
+    EXPECT_EQ(*forward.nth(i), e);
+    EXPECT_EQ(list.rank(e), i);
+    ++i;
+  }
+}
+
+TEST(skiplist_test, transparent_lookup_test) {  // NOLINT
+  skiplist<std::string, std::less<>> list{"apple", "banana", "cherry"};
+  std::string_view key = "banana";
+  EXPECT_EQ(list.count(key), 1);
+  EXPECT_TRUE(list.contains("cherry"));
+  EXPECT_FALSE(list.contains("durian"));
+  EXPECT_EQ(*list.lower_bound(key), "banana");
+  EXPECT_EQ(list.rank(key), 1);
+  auto node = list.extract(key);
+  EXPECT_FALSE(node.empty());
+  EXPECT_EQ(list.size(), 2);
+  EXPECT_TRUE(list.extract(key).empty());
+  EXPECT_EQ(list.erase(std::string_view{"apple"}), 1);
+  // Converted to std::string once, then compared as usual
+  skiplist<std::string> plain{"apple", "banana"};
+  EXPECT_EQ(plain.count("banana"), 1);
+  EXPECT_EQ(plain.erase("apple"), 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+ * Fixtures shared by the container tests, each compares against a standard
+ * container holding what the one under test should
+ */
+namespace test_helpers {
+/* Sends every key to the same home slot, so every probe run is one run */
+struct colliding_hash {
+  std::size_t operator()(int) const { return 42; }
+};
+
+/* Transparent, so string_view and const char * lookups skip the string */
+struct string_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+/* Converts to std::string, counting every conversion */
+struct counted_key {
+  static inline int s_conversions = 0;
+  const char *d_str;
+
+  operator std::string() const {  // NOLINT
+    s_conversions++;
+    return d_str;
+  }
+};
+
+/* Same keys as result, in the same order walked either way */
+template <class List>
+bool same_contents(const List &list, const std::set<int> &result) {
+  if (list.size() != result.size()) return false;
+  if (!std::equal(list.begin(), list.end(), result.begin(), result.end())) {
+    return false;
+  }
+  return std::equal(list.rbegin(), list.rend(), result.rbegin(),
+                    result.rend());
+}
+
+/* Same pairs as result in any order, each found by a lookup of its key */
+template <class Map>
+bool same_mapping(const Map &m, const std::unordered_map<int, int> &result) {
+  if (m.size() != result.size()) return false;
+  for (const auto &e : result) {
+    auto it = m.find(e.first);
+    if (it == m.end() || it->second != e.second) return false;
+  }
+  return true;
+}
+
+/* Same pairs as result, in the same order and each found by a lookup */
+template <class Map>
+bool same_contents(const Map &m, const std::map<int, int> &result) {
+  if (m.size() != result.size()) return false;
+  auto it = result.begin();
+  for (auto e : m) {
+    if (e.first != it->first || e.second != it->second) return false;
+    ++it;
+  }
+  for (const auto &e : result) {
+    auto found = m.find(e.first);
+    if (found == m.end() || found->second != e.second) return false;
+  }
+  return true;
+}
+}  // namespace test_helpers
@@ -0,0 +1,167 @@
+#include "UnorderedMap.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using test_helpers::colliding_hash;
+using test_helpers::same_mapping;
+using test_helpers::string_hash;
+using wijagels::unordered_map;
+
+namespace {
+/* Counts its calls, to check which operations hash a key */
+struct counting_hash {
+  static inline int s_calls = 0;
+  size_t operator()(int key) const {
+    s_calls++;
+    return std::hash<int>{}(key);
+  }
+};
+}  // namespace
+
+TEST(unordered_map_test, insert_test) {  // NOLINT
+  unordered_map<int, int> m;
+  EXPECT_EQ(m.find(1), m.end());
+  EXPECT_TRUE(m.insert({1, 1}).second);
+  EXPECT_FALSE(m.insert({1, 2}).second);
+  EXPECT_TRUE(m.emplace(2, 4).second);
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(m.at(1), 1);
+  EXPECT_EQ(m.count(2), 1);
+  EXPECT_FALSE(m.contains(3));
+  ASSERT_THROW(m.at(3), std::out_of_range);
+  for (int i = 0; i < 1000; i++) m[i] += i;
+  EXPECT_EQ(m.size(), 1000);
+  EXPECT_EQ(m.at(1), 2);
+  EXPECT_EQ(m.at(999), 999);
+  EXPECT_LE(m.load_factor(), m.max_load_factor());
+}
+
+TEST(unordered_map_test, upsert_test) {  // NOLINT
+  unordered_map<std::string, std::string> m;
+  EXPECT_TRUE(m.try_emplace("a", 3, 'x').second);
+  EXPECT_FALSE(m.try_emplace("a", "y").second);
+  EXPECT_EQ(m.at("a"), "xxx");
+  EXPECT_FALSE(m.insert_or_assign("a", "z").second);
+  EXPECT_EQ(m.at("a"), "z");
+  std::string key = "kept on a hit";
+  m.try_emplace(key, "1");
+  m.try_emplace(std::move(key), "2");
+  EXPECT_EQ(key, "kept on a hit");  // NOLINT
+  EXPECT_EQ(m.at(key), "1");
+}
+
+TEST(unordered_map_test, erase_test) {  // NOLINT
+  unordered_map<int, int> m;
+  for (int i = 0; i < 100; i++) m.emplace(i, i);
+  EXPECT_EQ(m.erase(50), 1);
+  EXPECT_EQ(m.erase(50), 0);
+  for (auto it = m.begin(); it != m.end();) {
+    if (it->first % 2) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(m.size(), 49);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(m.contains(i), i % 2 == 0 && i != 50);
+  }
+  m.erase(m.begin(), m.end());
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.find(0), m.end());
+}
+
+TEST(unordered_map_test, erase_no_hash_test) {  // NOLINT
+  unordered_map<int, std::string, counting_hash> m;
+  for (int i = 0; i < 100; i++) m.emplace(i, std::to_string(i));
+  counting_hash::s_calls = 0;
+  for (auto it = m.begin(); it != m.end();) {
+    if (it->first % 3) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  m.erase(m.begin(), m.begin() + 5);
+  m.rehash(1024);
+  EXPECT_EQ(counting_hash::s_calls, 0);
+  EXPECT_EQ(m.size(), 29);
+  for (const auto &e : m) EXPECT_EQ(e.second, std::to_string(e.first));
+  for (int i = 1; i < 100; i += 3) EXPECT_FALSE(m.contains(i));
+}
+
+TEST(unordered_map_test, collision_test) {  // NOLINT
+  unordered_map<int, int, colliding_hash> m;
+  std::unordered_map<int, int> result;
+  std::mt19937 gen{3};
+  std::uniform_int_distribution<int> dist{0, 40};
+  for (int i = 0; i < 2000; i++) {
+    int key = dist(gen);
+    if (gen() % 2) {
+      EXPECT_EQ(m.erase(key), result.erase(key));
+    } else {
+      EXPECT_EQ(m.try_emplace(key, i).second,
+                result.try_emplace(key, i).second);
+    }
+    ASSERT_TRUE(same_mapping(m, result));
+  }
+}
+
+TEST(unordered_map_test, random_test) {  // NOLINT
+  unordered_map<int, int> m;
+  std::unordered_map<int, int> result;
+  std::mt19937 gen{5};
+  std::uniform_int_distribution<int> dist{0, 5000};
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 1000; i++) {
+      int key = dist(gen);
+      m[key] = round;
+      result[key] = round;
+    }
+    for (int i = 0; i < 800; i++) {
+      int key = dist(gen);
+      EXPECT_EQ(m.erase(key), result.erase(key));
+    }
+    ASSERT_TRUE(same_mapping(m, result));
+  }
+  auto copy = m;
+  EXPECT_TRUE(copy == m);
+  copy[-1] = 0;
+  EXPECT_TRUE(copy != m);
+  m.clear();
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.find(1), m.end());
+  m[1] = 1;
+  EXPECT_EQ(m.size(), 1);
+}
+
+TEST(unordered_map_test, reserve_test) {  // NOLINT
+  unordered_map<int, int> m;
+  m.reserve(1000);
+  auto buckets = m.bucket_count();
+  auto first = m.begin();
+  EXPECT_GE(buckets * m.max_load_factor(), 1000);
+  for (int i = 0; i < 1000; i++) m.emplace(i, i);
+  EXPECT_EQ(m.bucket_count(), buckets);
+  EXPECT_TRUE(m.begin() == first);
+  m.rehash(0);
+  EXPECT_EQ(m.bucket_count(), buckets);
+  EXPECT_EQ(m.at(500), 500);
+}
+
+TEST(unordered_map_test, transparent_test) {  // NOLINT
+  unordered_map<std::string, int, string_hash, std::equal_to<>> m;
+  m.emplace("apple", 1);
+  m.emplace("banana", 2);
+  std::string_view key = "banana";
+  EXPECT_EQ(m.find(key)->second, 2);
+  EXPECT_TRUE(m.contains("apple"));
+  EXPECT_EQ(m.erase(key), 1);
+  EXPECT_EQ(m.size(), 1);
+}
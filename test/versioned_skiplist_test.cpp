@@ -0,0 +1,146 @@
+#include "VersionedSkipList.hpp"
+#include "gtest/gtest.h"
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+using wijagels::versioned_skiplist;
+
+namespace {
+/* Orders pairs by key only so a write replaces the mapped value */
+struct by_key {
+  bool operator()(const std::pair<int, int> &lhs,
+                  const std::pair<int, int> &rhs) const {
+    return lhs.first < rhs.first;
+  }
+};
+
+/* Counts its calls, to tell when a sweep walked the list */
+struct counting_less {
+  static inline int s_compares = 0;
+  bool operator()(int lhs, int rhs) const {
+    s_compares++;
+    return lhs < rhs;
+  }
+};
+
+template <class View>
+std::vector<int> contents(const View &view) {
+  return std::vector<int>(view.begin(), view.end());
+}
+}  // namespace
+
+TEST(versioned_skiplist_test, basic_test) {  // NOLINT
+  versioned_skiplist<int> list{5, 1, 4, 2, 3};
+  EXPECT_EQ(5, list.size());
+  EXPECT_FALSE(list.insert(3));
+  EXPECT_TRUE(list.contains(4));
+  EXPECT_EQ(1, list.erase(4));
+  EXPECT_EQ(0, list.erase(4));
+  EXPECT_FALSE(list.contains(4));
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 5}), contents(list));
+  EXPECT_EQ(*list.lower_bound(4), 5);
+  EXPECT_EQ(*list.upper_bound(3), 5);
+  EXPECT_TRUE(list.upper_bound(5) == list.end());
+  // Nobody can see the old versions, so nothing but the elements is kept
+  EXPECT_EQ(4, list.version_count());
+}
+
+TEST(versioned_skiplist_test, snapshot_test) {  // NOLINT
+  versioned_skiplist<int> list{1, 2, 3};
+  {
+    auto snap = list.snapshot();
+    list.erase(2);
+    list.insert(4);
+    list.insert(0);
+    EXPECT_EQ(std::vector<int>({0, 1, 3, 4}), contents(list));
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), contents(snap));
+    EXPECT_TRUE(snap.contains(2));
+    EXPECT_FALSE(snap.contains(4));
+    EXPECT_EQ(*snap.lower_bound(0), 1);
+    EXPECT_EQ(*snap.upper_bound(2), 3);
+    EXPECT_TRUE(snap.upper_bound(3) == snap.end());
+    auto copy = snap;
+    list.insert(2);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), contents(copy));
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), contents(list));
+  }
+  // Releasing the snapshot lets the shadowed versions go
+  list.gc();
+  EXPECT_EQ(list.size(), list.version_count());
+}
+
+TEST(versioned_skiplist_test, unpin_sweep_test) {  // NOLINT
+  versioned_skiplist<int, counting_less> list;
+  for (int i = 0; i < 100; i++) list.insert(i);
+  {
+    auto old = list.snapshot();
+    for (int i = 10; i < 100; i++) list.erase(i);
+    EXPECT_EQ(list.version_count(), 190);
+    list.gc();
+    // The old snapshot still holds every shadowed version, so releasing
+    // newer ones has nothing to sweep
+    counting_less::s_compares = 0;
+    for (int i = 0; i < 100; i++) list.snapshot();
+    EXPECT_EQ(counting_less::s_compares, 0);
+    EXPECT_EQ(list.version_count(), 190);
+    EXPECT_EQ(contents(old).size(), 100);
+  }
+  // Releasing the oldest reader moves the horizon, which does sweep
+  EXPECT_EQ(list.version_count(), 10);
+  {
+    auto snap = list.snapshot();
+    for (int i = 0; i < 10; i++) list.erase(i);
+  }
+  EXPECT_EQ(list.version_count(), 0);
+}
+
+TEST(versioned_skiplist_test, update_test) {  // NOLINT
+  versioned_skiplist<std::pair<int, int>, by_key> map;
+  map.insert({1, 10});
+  map.insert({2, 20});
+  auto before = map.snapshot();
+  EXPECT_FALSE(map.insert({1, 11}));
+  auto middle = map.snapshot();
+  map.insert({1, 12});
+  map.erase(std::pair<int, int>{2, 0});
+  EXPECT_EQ(map.find(std::pair<int, int>{1, 0})->second, 12);
+  EXPECT_EQ(middle.find(std::pair<int, int>{1, 0})->second, 11);
+  EXPECT_EQ(before.find(std::pair<int, int>{1, 0})->second, 10);
+  EXPECT_EQ(middle.find(std::pair<int, int>{2, 0})->second, 20);
+  EXPECT_FALSE(map.contains(std::pair<int, int>{2, 0}));
+  EXPECT_EQ(1, map.size());
+  EXPECT_EQ(5, map.version_count());
+  EXPECT_EQ(0, map.gc());
+}
+
+TEST(versioned_skiplist_test, random_test) {  // NOLINT
+  std::mt19937 gen{3};
+  std::uniform_int_distribution<int> key{0, 200};
+  versioned_skiplist<int> list;
+  std::set<int> latest;
+  std::vector<std::pair<versioned_skiplist<int>::snapshot_type, std::set<int>>>
+      views;
+  for (int round = 0; round < 2000; round++) {
+    auto k = key(gen);
+    if (gen() % 3) {
+      EXPECT_EQ(list.insert(k), latest.insert(k).second);
+    } else {
+      EXPECT_EQ(list.erase(k), latest.erase(k));
+    }
+    if (round % 100 == 0) views.emplace_back(list.snapshot(), latest);
+    if (round % 300 == 0 && !views.empty()) {
+      views.erase(views.begin() + gen() % views.size());
+    }
+  }
+  EXPECT_EQ(std::vector<int>(latest.begin(), latest.end()), contents(list));
+  EXPECT_EQ(latest.size(), list.size());
+  for (auto &view : views) {
+    EXPECT_EQ(std::vector<int>(view.second.begin(), view.second.end()),
+              contents(view.first));
+  }
+  views.clear();
+  list.gc();
+  EXPECT_EQ(list.size(), list.version_count());
+}